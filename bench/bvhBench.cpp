@@ -0,0 +1,181 @@
+//build, refit and query times of the scene BVH over 10k to 1M random boxes. Frustum culls and
+//ray casts are checked against a linear pass over every box. Build with `make bvhbench`, run
+//    bench/bvhBench [--queries N]
+
+#include "bvh.hpp"
+#include "frustumCull.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool insideFrustum(const Frustum &frustum, const Aabb &box) {
+    for(const glm::vec4 &plane : frustum.planes) {
+        glm::vec3 positive(plane.x >= 0.f ? box.max.x : box.min.x, plane.y >= 0.f ? box.max.y : box.min.y, plane.z >= 0.f ? box.max.z : box.min.z);
+        if(glm::dot(glm::vec3(plane), positive) + plane.w < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static float rayEntry(const glm::vec3 &origin, const glm::vec3 &direction, const Aabb &box) {
+    float near = 0.f;
+    float far = std::numeric_limits<float>::max();
+    for(int axis = 0; axis < 3; axis++) {
+        float t0 = (box.min[axis] - origin[axis]) / direction[axis];
+        float t1 = (box.max[axis] - origin[axis]) / direction[axis];
+        near = std::fmax(near, std::fmin(t0, t1));
+        far = std::fmin(far, std::fmax(t0, t1));
+    }
+    return near <= far ? near : -1.f;
+}
+
+int main(int argc, char** argv) {
+
+    uint32_t queries = 1000;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            queries = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else {
+            std::fprintf(stderr, "usage: %s [--queries N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    glm::mat4 projection = glm::perspective(45.f, 800.f / 600.f, 0.1f, 100.f);
+    projection[1][1] *= -1;
+
+    std::printf("%-8s %6s %5s %9s %9s %9s %9s %9s %11s %11s\n", "objects", "nodes", "depth", "build ms", "refit ms", "1% refit",
+                "cull ms", "linear ms", "rays/s", "linear/s");
+
+    for(uint32_t count : {10000u, 100000u, 1000000u}) {
+
+        //same density at every size, about one box per 10 cubic units
+        float side = 2.15f * std::cbrt(static_cast<float>(count));
+        std::mt19937 rng(count);
+        std::uniform_real_distribution<float> position(-0.5f * side, 0.5f * side);
+        std::uniform_real_distribution<float> size(0.25f, 1.f);
+        std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+        std::vector<Aabb> boxes(count);
+        for(Aabb &box : boxes) {
+            glm::vec3 center(position(rng), position(rng), position(rng));
+            glm::vec3 half(size(rng), size(rng), size(rng));
+            box = {center - half, center + half};
+        }
+
+        Bvh bvh;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bvh.build(boxes);
+        double buildMs = msSince(start);
+
+        //every object moves a little, then one in a hundred
+        for(uint32_t i = 0; i < count; i++) {
+            glm::vec3 offset(jitter(rng), jitter(rng), jitter(rng));
+            boxes[i] = {boxes[i].min + offset, boxes[i].max + offset};
+            bvh.setBounds(i, boxes[i]);
+        }
+        start = std::chrono::steady_clock::now();
+        bvh.refit();
+        double refitMs = msSince(start);
+
+        std::uniform_int_distribution<uint32_t> pick(0, count - 1);
+        for(uint32_t i = 0; i < count / 100; i++) {
+            uint32_t object = pick(rng);
+            glm::vec3 offset(jitter(rng), jitter(rng), jitter(rng));
+            boxes[object] = {boxes[object].min + offset, boxes[object].max + offset};
+            bvh.setBounds(object, boxes[object]);
+        }
+        start = std::chrono::steady_clock::now();
+        bvh.refit();
+        double partialRefitMs = msSince(start);
+
+        //frustum culls from the centre in random directions
+        uint32_t cullQueries = std::max(1u, queries / 10);
+        std::vector<uint32_t> visible;
+        std::vector<uint32_t> linearVisible;
+        double cullMs = 0.0;
+        double linearMs = 0.0;
+        for(uint32_t q = 0; q < cullQueries; q++) {
+            glm::vec3 forward = glm::normalize(glm::vec3(unit(rng), 0.5f * unit(rng), unit(rng)));
+            glm::mat4 view = glm::lookAt(glm::vec3(0.f), forward, glm::vec3(0.f, 1.f, 0.f));
+            Frustum frustum = extractFrustum(projection * view);
+
+            start = std::chrono::steady_clock::now();
+            bvh.cullFrustum(frustum, visible);
+            cullMs += msSince(start) / cullQueries;
+
+            start = std::chrono::steady_clock::now();
+            linearVisible.clear();
+            for(uint32_t i = 0; i < count; i++) {
+                if(insideFrustum(frustum, boxes[i])) {
+                    linearVisible.push_back(i);
+                }
+            }
+            linearMs += msSince(start) / cullQueries;
+
+            std::sort(visible.begin(), visible.end());
+            if(visible != linearVisible) {
+                std::fprintf(stderr, "frustum cull disagrees with the linear pass at %u objects\n", count);
+                return 1;
+            }
+        }
+
+        //rays from the centre, the first few checked against every box
+        std::vector<glm::vec3> directions(queries);
+        for(glm::vec3 &direction : directions) {
+            direction = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)));
+        }
+        uint32_t hits = 0;
+        start = std::chrono::steady_clock::now();
+        for(const glm::vec3 &direction : directions) {
+            uint32_t object;
+            float distance;
+            hits += bvh.raycast(glm::vec3(0.f), direction, nullptr, object, distance);
+        }
+        double rayMs = msSince(start);
+
+        uint32_t linearRays = std::min<uint32_t>(queries, 20);
+        start = std::chrono::steady_clock::now();
+        for(uint32_t q = 0; q < linearRays; q++) {
+            float best = std::numeric_limits<float>::max();
+            for(uint32_t i = 0; i < count; i++) {
+                float t = rayEntry(glm::vec3(0.f), directions[q], boxes[i]);
+                if(t >= 0.f && t < best) {
+                    best = t;
+                }
+            }
+            uint32_t object;
+            float distance = -1.f;
+            bool hit = bvh.raycast(glm::vec3(0.f), directions[q], nullptr, object, distance);
+            if(hit != (best < std::numeric_limits<float>::max()) || (hit && std::fabs(distance - best) > 1e-4f * std::max(1.f, best))) {
+                std::fprintf(stderr, "ray cast disagrees with the linear pass at %u objects\n", count);
+                return 1;
+            }
+        }
+        double linearRayMs = msSince(start);
+
+        std::printf("%-8u %6u %5u %9.2f %9.2f %9.3f %9.3f %9.3f %11.0f %11.0f\n", count, bvh.getNodeCount(), bvh.getDepth(), buildMs, refitMs,
+                    partialRefitMs, cullMs, linearMs, queries * 1000.0 / rayMs, linearRays * 1000.0 / linearRayMs);
+        (void)hits;
+    }
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+//times frustum culling of random bounding spheres on the scalar, SSE and AVX paths of
+//frustumCull.cpp and checks that every path finds the same visible set. Build with
+//`make cullbench`, run
+//    bench/cullBench [--reps N]
+
+#include "frustumCull.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+
+struct Result {
+    double bestMs;
+    double averageMs;
+    size_t visibleCount;
+};
+
+static Result run(const Frustum &frustum, const SphereSoA &spheres, std::vector<uint32_t> &visible, CullPath path, uint32_t reps) {
+
+    Result result = {1e30, 0.0, 0};
+    for(uint32_t r = 0; r < reps; r++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        result.visibleCount = cullSpheres(frustum, spheres, visible.data(), path);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.bestMs = std::min(result.bestMs, ms);
+        result.averageMs += ms / reps;
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+
+    uint32_t reps = 50;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else {
+            std::fprintf(stderr, "usage: %s [--reps N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    //the app's camera and projection, looking into a cube of objects around it
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+    glm::mat4 projection = glm::perspective(45.f, 800.f / 600.f, 0.1f, 100.f);
+    projection[1][1] *= -1;
+    Frustum frustum = extractFrustum(projection * view);
+
+    std::vector<CullPath> paths = {CULL_PATH_SCALAR};
+    CullPath best = getBestCullPath();
+    if(best >= CULL_PATH_SSE) {
+        paths.push_back(CULL_PATH_SSE);
+    }
+    if(best >= CULL_PATH_AVX) {
+        paths.push_back(CULL_PATH_AVX);
+    }
+
+    std::printf("%-9s %-7s %10s %10s %10s %9s %8s\n", "spheres", "path", "best ms", "avg ms", "ns/sphere", "visible", "speedup");
+
+    for(uint32_t count : {10000u, 100000u, 1000000u}) {
+        std::mt19937 rng(count);
+        std::uniform_real_distribution<float> position(-100.f, 100.f);
+        std::uniform_real_distribution<float> radius(0.1f, 2.f);
+
+        SphereSoA spheres;
+        spheres.reserve(count);
+        for(uint32_t i = 0; i < count; i++) {
+            spheres.add(glm::vec3(position(rng), position(rng), position(rng)), radius(rng));
+        }
+
+        std::vector<uint32_t> visible(spheres.paddedSize());
+        std::vector<uint32_t> reference;
+        double scalarMs = 0.0;
+
+        for(CullPath path : paths) {
+            Result result = run(frustum, spheres, visible, path, reps);
+
+            if(path == CULL_PATH_SCALAR) {
+                scalarMs = result.bestMs;
+                reference.assign(visible.begin(), visible.begin() + result.visibleCount);
+            }
+            else if(result.visibleCount != reference.size() || !std::equal(reference.begin(), reference.end(), visible.begin())) {
+                std::fprintf(stderr, "%s path disagrees with the scalar path at %u spheres\n", getCullPathName(path), count);
+                return 1;
+            }
+
+            std::printf("%-9u %-7s %10.4f %10.4f %10.3f %9zu %7.2fx\n", count, getCullPathName(path), result.bestMs, result.averageMs,
+                        result.bestMs * 1e6 / count, result.visibleCount, scalarMs / result.bestMs);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#!/bin/sh
+# stress test for hardware instancing: renders a growing field of whales headless,
+# once with one instanced draw and once with one draw per instance.
+# run from the repository root after `make`, or through `make instancebench`.
+# extra arguments are passed on to vulest, e.g. --frames 500
+
+frames=200
+prog=./vulest
+
+printf "%-10s %-12s %s\n" instances mode result
+for count in 1 10 100 1000 10000 100000; do
+    for mode in instanced per-draw; do
+        flag=""
+        if [ "$mode" = per-draw ]; then
+            flag="--no-instancing"
+        fi
+        result=$($prog --headless --frames $frames --instances $count $flag "$@" | grep "^headless:" | sed 's/^headless: //')
+        printf "%-10s %-12s %s\n" "$count" "$mode" "$result"
+    done
+done
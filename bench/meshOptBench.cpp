@@ -0,0 +1,188 @@
+//ACMR, ATVR and overdraw before and after the import time mesh optimization, on synthetic
+//meshes with their triangles shuffled and on any OBJ files given. Every optimized mesh is
+//checked to still hold the same triangles. Build with `make meshoptbench`, run
+//    bench/meshOptBench [a.obj ...]
+
+#include "meshOptimize.hpp"
+#include "obj.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+
+//a grid bent into a sphere around center
+static void addSphere(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, glm::vec3 center, float radius, uint32_t rings) {
+
+    uint32_t first = static_cast<uint32_t>(vertices.size());
+    uint32_t segments = 2 * rings;
+    for(uint32_t r = 0; r <= rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for(uint32_t s = 0; s <= segments; s++) {
+            float phi = 2.f * 3.14159265f * s / segments;
+            glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            vertices.push_back({center + radius * normal, glm::vec3(1.f), normal});
+        }
+    }
+    for(uint32_t r = 0; r < rings; r++) {
+        for(uint32_t s = 0; s < segments; s++) {
+            uint32_t a = first + r * (segments + 1) + s;
+            uint32_t b = a + segments + 1;
+            indices.insert(indices.end(), {a, a + 1, b, a + 1, b + 1, b});
+        }
+    }
+}
+
+static void shuffleTriangles(std::vector<uint32_t> &indices, std::mt19937 &rng) {
+
+    std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+    for(size_t t = 0; t < triangles.size(); t++) {
+        triangles[t] = {indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]};
+    }
+    std::shuffle(triangles.begin(), triangles.end(), rng);
+    for(size_t t = 0; t < triangles.size(); t++) {
+        std::copy(triangles[t].begin(), triangles[t].end(), indices.begin() + 3 * t);
+    }
+}
+
+//every triangle as its positions, rotated to start at the smallest, in sorted order
+static std::vector<std::array<float, 9>> triangleSet(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
+
+    std::vector<std::array<float, 9>> set(indices.size() / 3);
+    for(size_t t = 0; t < set.size(); t++) {
+        std::array<float, 9> corners[3];
+        for(int rotation = 0; rotation < 3; rotation++) {
+            for(int c = 0; c < 3; c++) {
+                const glm::vec3 &p = vertices[indices[3 * t + (c + rotation) % 3]].pos;
+                corners[rotation][3 * c] = p.x;
+                corners[rotation][3 * c + 1] = p.y;
+                corners[rotation][3 * c + 2] = p.z;
+            }
+        }
+        set[t] = std::min({corners[0], corners[1], corners[2]});
+    }
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+//shaded over covered pixels of a depth tested, back face culled orthographic raster along
+//the six axis directions, 1 means every covered pixel was shaded once
+static float analyzeOverdraw(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
+
+    const int size = 256;
+    glm::vec3 boundsMin(1e30f);
+    glm::vec3 boundsMax(-1e30f);
+    for(const Vertex &vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+    glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+
+    std::vector<float> depth(size * size);
+    uint64_t shaded = 0;
+    uint64_t covered = 0;
+    for(int axis = 0; axis < 3; axis++) {
+        for(float sign : {1.f, -1.f}) {
+            std::fill(depth.begin(), depth.end(), 1e30f);
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+            for(size_t t = 0; t + 3 <= indices.size(); t += 3) {
+                glm::vec3 p[3];
+                for(int c = 0; c < 3; c++) {
+                    glm::vec3 n = (vertices[indices[t + c]].pos - boundsMin) / extent;
+                    p[c] = glm::vec3(n[u] * (size - 1), n[v] * (size - 1), sign * n[axis]);
+                }
+                float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+                if(area * sign >= 0.f) {
+                    continue;
+                }
+                int x0 = std::max(0, static_cast<int>(std::floor(std::min({p[0].x, p[1].x, p[2].x}))));
+                int x1 = std::min(size - 1, static_cast<int>(std::ceil(std::max({p[0].x, p[1].x, p[2].x}))));
+                int y0 = std::max(0, static_cast<int>(std::floor(std::min({p[0].y, p[1].y, p[2].y}))));
+                int y1 = std::min(size - 1, static_cast<int>(std::ceil(std::max({p[0].y, p[1].y, p[2].y}))));
+                for(int y = y0; y <= y1; y++) {
+                    for(int x = x0; x <= x1; x++) {
+                        float w[3];
+                        for(int c = 0; c < 3; c++) {
+                            const glm::vec3 &a = p[(c + 1) % 3];
+                            const glm::vec3 &b = p[(c + 2) % 3];
+                            w[c] = ((b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x)) / area;
+                        }
+                        if(w[0] < 0.f || w[1] < 0.f || w[2] < 0.f) {
+                            continue;
+                        }
+                        float z = w[0] * p[0].z + w[1] * p[1].z + w[2] * p[2].z;
+                        float &stored = depth[y * size + x];
+                        if(z < stored) {
+                            covered += stored == 1e30f;
+                            shaded++;
+                            stored = z;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return covered > 0 ? static_cast<float>(shaded) / static_cast<float>(covered) : 0.f;
+}
+
+static bool report(const char* name, std::vector<Vertex> vertices, std::vector<uint32_t> indices) {
+
+    std::vector<std::array<float, 9>> before = triangleSet(vertices, indices);
+    VertexCacheStats before32 = analyzeVertexCache(indices, vertices.size(), 32);
+    float overdrawBefore = analyzeOverdraw(vertices, indices);
+
+    MeshOptimizeReport result = optimizeMesh(vertices, indices);
+
+    VertexCacheStats after32 = analyzeVertexCache(indices, vertices.size(), 32);
+    float overdrawAfter = analyzeOverdraw(vertices, indices);
+    std::printf("%-22s %9zu %5.3f -> %5.3f %5.3f -> %5.3f %5.3f -> %5.3f %5.3f -> %5.3f %9.2f\n", name, indices.size() / 3,
+                result.before.acmr, result.after.acmr, before32.acmr, after32.acmr, result.before.atvr, result.after.atvr,
+                overdrawBefore, overdrawAfter, result.ms);
+
+    if(triangleSet(vertices, indices) != before) {
+        std::fprintf(stderr, "%s: the optimized mesh does not hold the same triangles\n", name);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+
+    std::printf("%-22s %9s %14s %14s %14s %14s %9s\n", "mesh", "triangles", "ACMR 16", "ACMR 32", "ATVR 16", "overdraw", "ms");
+
+    std::mt19937 rng(1);
+    bool ok = true;
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    addSphere(vertices, indices, glm::vec3(0.f), 1.f, 256);
+    shuffleTriangles(indices, rng);
+    ok &= report("shuffled sphere", vertices, indices);
+
+    //overlapping spheres have hidden surfaces, so triangle order changes overdraw
+    vertices.clear();
+    indices.clear();
+    std::uniform_real_distribution<float> offset(-1.f, 1.f);
+    for(int s = 0; s < 16; s++) {
+        addSphere(vertices, indices, glm::vec3(offset(rng), offset(rng), offset(rng)), 0.5f, 64);
+    }
+    shuffleTriangles(indices, rng);
+    ok &= report("shuffled sphere cloud", vertices, indices);
+
+    for(int i = 1; i < argc; i++) {
+        vertices.clear();
+        indices.clear();
+        obj(argv[i], vertices, indices);
+        ok &= report(argv[i], vertices, indices);
+    }
+
+    return ok ? 0 : 1;
+}
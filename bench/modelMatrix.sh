@@ -0,0 +1,21 @@
+#!/bin/sh
+# per draw cost of setting the model matrix: push constants against rebinding the dynamic ubo.
+# Every instance gets its own draw and the frame is re-recorded on one thread, so the
+# record time is dominated by the per draw vkCmdPushConstants or vkCmdBindDescriptorSets.
+# run from the repository root after `make`, or through `make modelbench`.
+# extra arguments are passed on to vulest, e.g. --frames 500
+
+frames=200
+prog=./vulest
+
+printf "%-8s %-14s %s\n" draws path result
+for draws in 1000 10000 100000; do
+    for path in push-constant ubo; do
+        flag=""
+        if [ "$path" = ubo ]; then
+            flag="--model-ubo"
+        fi
+        result=$($prog --headless --frames $frames --instances $draws --no-instancing --rerecord --record-threads 1 $flag "$@" | grep "^headless:" | sed 's/^headless: //')
+        printf "%-8s %-14s %s\n" "$draws" "$path" "$result"
+    done
+done
@@ -0,0 +1,174 @@
+//compares the OBJ parser in obj.cpp against the objl::Loader path it replaced.
+//build with `make objbench`, run with one or more OBJ files or let it generate one:
+//    bench/objBench --generate 2000 /tmp/grid.obj /tmp/grid.obj obj/whale.obj
+
+#include "obj.hpp"
+#include "OBJ_Loader.h"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/stat.h>
+
+
+//the loader as it was: objl::Loader, a copy of every mesh, a full text dump and push_back without reserve
+static void objlLoad(const std::string &path, std::vector<Vertex> &verts, std::vector<uint32_t> &idx, bool writeDump) {
+
+    objl::Loader loader;
+    if(!loader.LoadFile(path)) {
+        throw std::runtime_error("Could not load " + path + " with objl.");
+    }
+
+    std::ofstream file;
+    if(writeDump) {
+        file.open("objBench_objl.txt");
+    }
+
+    for(size_t i = 0; i < loader.LoadedMeshes.size(); i++) {
+        objl::Mesh curMesh = loader.LoadedMeshes[i];
+
+        for(size_t j = 0; j < curMesh.Vertices.size(); j++) {
+            if(writeDump) {
+                file << "V" << j << ": " <<
+                    "P(" << curMesh.Vertices[j].Position.X << ", " << curMesh.Vertices[j].Position.Y << ", " << curMesh.Vertices[j].Position.Z << ") " <<
+                    "N(" << curMesh.Vertices[j].Normal.X << ", " << curMesh.Vertices[j].Normal.Y << ", " << curMesh.Vertices[j].Normal.Z << ")\n";
+            }
+            Vertex v;
+            v.pos = 0.5f * glm::vec3(curMesh.Vertices[j].Position.X, curMesh.Vertices[j].Position.Y, curMesh.Vertices[j].Position.Z);
+            v.color = glm::vec3(0.f, 0.f, 1.f);
+            v.normal = glm::vec3(curMesh.Vertices[j].Normal.X, curMesh.Vertices[j].Normal.Y, curMesh.Vertices[j].Normal.Z);
+            verts.push_back(v);
+        }
+
+        for(size_t j = 0; j < curMesh.Indices.size(); j += 3) {
+            if(writeDump) {
+                file << "T" << j / 3 << ": " << curMesh.Indices[j] << ", " << curMesh.Indices[j + 1] << ", " << curMesh.Indices[j + 2] << "\n";
+            }
+            idx.push_back(curMesh.Indices[j]);
+            idx.push_back(curMesh.Indices[j + 1]);
+            idx.push_back(curMesh.Indices[j + 2]);
+        }
+    }
+}
+
+//a gently curved grid x grid heightfield with normals, written as quads
+static void generate(uint32_t grid, const std::string &path) {
+
+    FILE* file = fopen(path.c_str(), "w");
+    if(!file) {
+        throw std::runtime_error("Could not open " + path + '.');
+    }
+    for(uint32_t z = 0; z <= grid; z++) {
+        for(uint32_t x = 0; x <= grid; x++) {
+            float fx = static_cast<float>(x) / grid;
+            float fz = static_cast<float>(z) / grid;
+            fprintf(file, "v %f %f %f\n", fx * 20.f - 10.f, 0.5f * std::sin(fx * 12.f) * std::cos(fz * 12.f), -fz * 20.f);
+        }
+    }
+    for(uint32_t z = 0; z <= grid; z++) {
+        for(uint32_t x = 0; x <= grid; x++) {
+            fprintf(file, "vn %f %f %f\n", 0.f, 1.f, 0.f);
+        }
+    }
+    for(uint32_t z = 0; z < grid; z++) {
+        for(uint32_t x = 0; x < grid; x++) {
+            uint32_t a = z * (grid + 1) + x + 1;
+            uint32_t b = a + 1;
+            uint32_t c = a + grid + 2;
+            uint32_t d = a + grid + 1;
+            fprintf(file, "f %u//%u %u//%u %u//%u %u//%u\n", a, a, b, b, c, c, d, d);
+        }
+    }
+    fclose(file);
+}
+
+struct Result {
+    double bestMs;
+    size_t vertexCount;
+    size_t triangleCount;
+};
+
+static Result measure(uint32_t runs, const std::function<void(std::vector<Vertex>&, std::vector<uint32_t>&)> &load) {
+
+    Result result = {1e30, 0, 0};
+    for(uint32_t run = 0; run < runs; run++) {
+        std::vector<Vertex> verts;
+        std::vector<uint32_t> idx;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        load(verts, idx);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        result.bestMs = std::min(result.bestMs, ms);
+        result.vertexCount = verts.size();
+        result.triangleCount = idx.size() / 3;
+    }
+    return result;
+}
+
+static void print(const char* name, const Result &result, double fileMB) {
+    printf("  %-28s %10.1f ms %9.1f MB/s %10zu verts %10zu tris\n", name, result.bestMs, fileMB / (result.bestMs / 1000.0), result.vertexCount, result.triangleCount);
+}
+
+int main(int argc, char** argv) {
+
+    uint32_t runs = 3;
+    bool skipObjl = false;
+    std::vector<std::string> paths;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::max(1ul, std::stoul(argv[++i]));
+        }
+        else if(strcmp(argv[i], "--generate") == 0 && i + 2 < argc) {
+            uint32_t grid = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+            generate(grid, argv[i + 2]);
+            i += 2;
+        }
+        else if(strcmp(argv[i], "--skip-objl") == 0) {
+            skipObjl = true;
+        }
+        else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if(paths.empty()) {
+        std::cerr << "usage: objBench [--runs N] [--skip-objl] [--generate GRID OUT.obj] FILE.obj...\n";
+        return 1;
+    }
+
+    for(const std::string &path : paths) {
+        struct stat fileStat;
+        if(stat(path.c_str(), &fileStat) != 0) {
+            std::cerr << "Could not stat " << path << '\n';
+            return 1;
+        }
+        double fileMB = fileStat.st_size / (1024.0 * 1024.0);
+        printf("%s (%.1f MB, best of %u)\n", path.c_str(), fileMB, runs);
+
+        if(!skipObjl) {
+            print("objl + dump (old default)", measure(runs, [&](std::vector<Vertex> &v, std::vector<uint32_t> &i) { objlLoad(path, v, i, true); }), fileMB);
+            print("objl", measure(runs, [&](std::vector<Vertex> &v, std::vector<uint32_t> &i) { objlLoad(path, v, i, false); }), fileMB);
+            std::remove("objBench_objl.txt");
+        }
+
+        ObjOptions options;
+        options.threadCount = 1;
+        print("obj, 1 thread", measure(runs, [&](std::vector<Vertex> &v, std::vector<uint32_t> &i) { obj(path, v, i, options); }), fileMB);
+        options.threadCount = 0;
+        print("obj, all threads", measure(runs, [&](std::vector<Vertex> &v, std::vector<uint32_t> &i) { obj(path, v, i, options); }), fileMB);
+        options.dumpPath = "objBench_obj.txt";
+        print("obj + dump, all threads", measure(runs, [&](std::vector<Vertex> &v, std::vector<uint32_t> &i) { obj(path, v, i, options); }), fileMB);
+        std::remove("objBench_obj.txt");
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+//cost of a CPU zone with the profiler off and on, on one thread and on every hardware
+//thread at once, with the per thread rings wrapping, next to one read of the timebase.
+//Build with `make profilerbench`, run
+//    bench/profilerBench
+
+#include "cpuProfiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+
+static volatile uint32_t sink = 0;
+
+static void zones(uint32_t count) {
+    for(uint32_t i = 0; i < count; i++) {
+        CPU_ZONE("bench zone");
+        sink = sink + 1;
+    }
+}
+
+//best of a few runs, in nanoseconds per zone, with threadCount threads each opening count zones
+static double measure(uint32_t threadCount, uint32_t count) {
+
+    double best = 1e30;
+    for(int run = 0; run < 5; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for(uint32_t t = 1; t < threadCount; t++) {
+            threads.emplace_back(zones, count);
+        }
+        zones(count);
+        for(std::thread &thread : threads) {
+            thread.join();
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ns / count);
+    }
+    return best;
+}
+
+int main() {
+
+    const uint32_t count = 4000000;
+    uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    //the loop alone, so its cost can be taken off
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < count; i++) {
+        sink = sink + 1;
+    }
+    double loopNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+
+    //a zone reads the timebase twice, under virtualization that read alone can cost more than the rest
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < count; i++) {
+        sink = sink + static_cast<uint32_t>(CpuProfiler::now());
+    }
+    double timerNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count - loopNs;
+
+    double offNs = measure(1, count);
+    CpuProfiler::enable();
+    double onNs = measure(1, count);
+    double onThreadsNs = measure(threadCount, count);
+
+    std::printf("%-28s %8s\n", "", "ns/zone");
+    std::printf("%-28s %8.2f\n", "timer read", timerNs);
+    std::printf("%-28s %8.2f\n", "profiler off", offNs - loopNs);
+    std::printf("%-28s %8.2f\n", "profiler on, 1 thread", onNs - loopNs);
+    std::printf("profiler on, %-3u threads     %8.2f\n", threadCount, onThreadsNs - loopNs);
+    return 0;
+}
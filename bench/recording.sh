@@ -0,0 +1,25 @@
+#!/bin/sh
+# scaling of per-frame command buffer recording: renders 10k and 100k draws headless,
+# re-recording every frame with the draws split over 1..N threads of secondary command buffers.
+# run from the repository root after `make`, or through `make recordbench`.
+# extra arguments are passed on to vulest, e.g. --frames 500
+
+frames=200
+prog=./vulest
+cores=$(nproc)
+
+threads=1
+counts=""
+while [ $threads -lt $cores ]; do
+    counts="$counts $threads"
+    threads=$((threads * 2))
+done
+counts="$counts $cores"
+
+printf "%-8s %-8s %s\n" draws threads result
+for draws in 10000 100000; do
+    for threads in $counts; do
+        result=$($prog --headless --frames $frames --instances $draws --no-instancing --rerecord --record-threads $threads "$@" | grep "^headless:" | sed 's/^headless: //')
+        printf "%-8s %-8s %s\n" "$draws" "$threads" "$result"
+    done
+done
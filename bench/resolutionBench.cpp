@@ -0,0 +1,84 @@
+//the dynamic resolution controller against simulated GPU loads: GPU time proportional to the
+//pixels drawn, reported frames in flight later with some noise, for a series of load steps.
+//Prints how many frames each step takes until the scale stays within 5% of where it ends up,
+//the worst frame time of the step and the mean, spread and scale over its second half. Deterministic, the noise has a fixed seed.
+//Build with `make resolutionbench`, run
+//    bench/resolutionBench [TARGET_MS]
+
+#include "resolutionScaler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+
+
+struct Step {
+    //full resolution GPU time
+    double fullMs;
+    uint32_t frames;
+};
+
+static void run(const char* name, double targetMs, uint32_t latency, double noise, const Step* steps, size_t stepCount) {
+
+    ResolutionScaler scaler(targetMs, 0.5f);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> jitter(1.0 - noise, 1.0 + noise);
+    //scales of the frames still in flight, the oldest one's time is reported next
+    std::deque<float> inFlight(latency, 1.f);
+
+    std::printf("%s, %u frames latency, %.0f%% noise\n", name, latency, noise * 100.0);
+    std::printf("  %10s %8s %10s %10s %10s %8s\n", "full ms", "settle", "worst ms", "mean ms", "stddev ms", "scale");
+    for(size_t s = 0; s < stepCount; s++) {
+        std::vector<float> scales;
+        double worstMs = 0.0;
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        uint32_t tail = 0;
+        for(uint32_t frame = 0; frame < steps[s].frames; frame++) {
+            inFlight.push_back(scaler.getScale());
+            float scale = inFlight.front();
+            inFlight.pop_front();
+            double gpuMs = steps[s].fullMs * scale * scale * jitter(random);
+            scales.push_back(scaler.update(gpuMs));
+
+            worstMs = std::max(worstMs, gpuMs);
+            //the second half of the step
+            if(frame >= steps[s].frames / 2) {
+                sum += gpuMs;
+                sumSquares += gpuMs * gpuMs;
+                tail++;
+            }
+        }
+        double mean = sum / tail;
+        double stddev = std::sqrt(std::max(0.0, sumSquares / tail - mean * mean));
+
+        //the scale it ends up at is the average of the last 20 frames
+        float finalScale = 0.f;
+        for(size_t i = scales.size() - 20; i < scales.size(); i++) {
+            finalScale += scales[i] / 20.f;
+        }
+        size_t settled = scales.size();
+        while(settled > 0 && std::fabs(scales[settled - 1] - finalScale) <= 0.05f * finalScale) {
+            settled--;
+        }
+        std::printf("  %10.1f %8zu %10.2f %10.2f %10.2f %8.3f\n", steps[s].fullMs, settled, worstMs, mean, stddev, finalScale);
+    }
+}
+
+int main(int argc, char** argv) {
+
+    double targetMs = argc > 1 ? std::atof(argv[1]) : 16.6;
+
+    //light, over budget, far over (the scale bottoms out), back to light
+    const Step steps[] = {{10.0, 200}, {40.0, 200}, {80.0, 200}, {25.0, 200}, {12.0, 200}};
+    const size_t stepCount = sizeof(steps) / sizeof(steps[0]);
+
+    run("clean", targetMs, 1, 0.0, steps, stepCount);
+    run("2 frames in flight", targetMs, 2, 0.05, steps, stepCount);
+    run("3 frames in flight, noisy", targetMs, 3, 0.1, steps, stepCount);
+    return 0;
+}
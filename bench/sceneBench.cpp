@@ -0,0 +1,143 @@
+//measures scene building time and peak memory for the old by value Model/Scene path
+//against the arena based Scene. Each variant runs in its own forked process so its
+//peak RSS is not hidden by the other's. Build with `make scenebench`, run
+//    bench/sceneBench [--models N] [--vertices V]
+
+#include "model.hpp"
+#include "memoryUsage.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+//the API as it was: vectors taken and returned by value
+class LegacyModel {
+    public:
+        LegacyModel(std::vector<Vertex> vertices, std::vector<uint32_t> indices) : vertices(vertices), indices(indices) {}
+        std::vector<Vertex> getVerts() { return vertices; }
+        std::vector<uint32_t> getInds() { return indices; }
+
+    private:
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+};
+
+class LegacyScene {
+    public:
+        void pushbackModel(LegacyModel* pModel) {
+            std::vector<Vertex> verts = pModel->getVerts();
+            std::vector<uint32_t> inds = pModel->getInds();
+            std::transform(inds.begin(), inds.end(), inds.begin(), [this](uint32_t i) {return i + vertices.size();});
+            vertices.insert(vertices.end(), verts.begin(), verts.end());
+            indices.insert(indices.end(), inds.begin(), inds.end());
+        }
+        std::vector<Vertex>* getVerts() { return &vertices; }
+        std::vector<uint32_t>* getInds() { return &indices; }
+
+    private:
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+};
+
+//a grid of vertexCount vertices standing in for a loaded model
+static void makeMesh(uint32_t vertexCount, uint32_t seed, std::vector<Vertex> &verts, std::vector<uint32_t> &idx) {
+
+    uint32_t side = std::max(2u, static_cast<uint32_t>(std::sqrt(static_cast<double>(vertexCount))));
+    verts.resize(static_cast<size_t>(side) * side);
+    for(size_t i = 0; i < verts.size(); i++) {
+        verts[i].pos = glm::vec3(static_cast<float>(i % side), static_cast<float>(seed), static_cast<float>(i / side));
+        verts[i].color = glm::vec3(0.f, 0.f, 1.f);
+        verts[i].normal = glm::vec3(0.f, 1.f, 0.f);
+    }
+    idx.clear();
+    idx.reserve(static_cast<size_t>(side - 1) * (side - 1) * 6);
+    for(uint32_t z = 0; z + 1 < side; z++) {
+        for(uint32_t x = 0; x + 1 < side; x++) {
+            uint32_t a = z * side + x;
+            uint32_t quad[6] = {a, a + side, a + 1, a + 1, a + side, a + side + 1};
+            idx.insert(idx.end(), quad, quad + 6);
+        }
+    }
+}
+
+static void run(const char* name, uint32_t modelCount, uint32_t vertexCount, bool legacy) {
+
+    //what the loader hands over: one pair of vectors per model
+    std::vector<std::vector<Vertex>> loadedVertices(modelCount);
+    std::vector<std::vector<uint32_t>> loadedIndices(modelCount);
+    size_t totalVertices = 0;
+    size_t totalIndices = 0;
+    for(uint32_t i = 0; i < modelCount; i++) {
+        makeMesh(vertexCount, i, loadedVertices[i], loadedIndices[i]);
+        totalVertices += loadedVertices[i].size();
+        totalIndices += loadedIndices[i].size();
+    }
+    double inputMB = (totalVertices * sizeof(Vertex) + totalIndices * sizeof(uint32_t)) / (1024.0 * 1024.0);
+    size_t baseRss = getCurrentRssBytes();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t checksum = 0;
+    if(legacy) {
+        LegacyScene scene;
+        std::vector<LegacyModel> models;
+        models.reserve(modelCount);
+        for(uint32_t i = 0; i < modelCount; i++) {
+            models.push_back(LegacyModel(loadedVertices[i], loadedIndices[i]));
+            scene.pushbackModel(&models.back());
+        }
+        //VulkanBase used to keep its own copy of the scene arrays
+        std::vector<Vertex> uploadVertices = *scene.getVerts();
+        std::vector<uint32_t> uploadIndices = *scene.getInds();
+        checksum = uploadVertices.size() + uploadIndices.back();
+    }
+    else {
+        Scene scene;
+        scene.reserve(totalVertices, totalIndices);
+        for(uint32_t i = 0; i < modelCount; i++) {
+            scene.addMesh(loadedVertices[i], loadedIndices[i]);
+        }
+        checksum = scene.getVerts().size() + scene.getInds().back();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double extraMB = (getPeakRssBytes() - std::min(getPeakRssBytes(), baseRss)) / (1024.0 * 1024.0);
+
+    printf("  %-22s %9.1f ms   peak RSS +%8.1f MB over the loaded input (%.1f MB, %.2fx)   [%zu]\n",
+           name, ms, extraMB, inputMB, extraMB / inputMB, checksum);
+}
+
+int main(int argc, char** argv) {
+
+    uint32_t modelCount = 64;
+    uint32_t vertexCount = 250000;
+    for(int i = 1; i + 1 < argc; i += 2) {
+        if(strcmp(argv[i], "--models") == 0) {
+            modelCount = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+        }
+        else if(strcmp(argv[i], "--vertices") == 0) {
+            vertexCount = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+        }
+    }
+    printf("%u models of ~%u vertices\n", modelCount, vertexCount);
+    fflush(stdout);
+
+    for(int variant = 0; variant < 2; variant++) {
+        pid_t pid = fork();
+        if(pid == 0) {
+            run(variant == 0 ? "by value (old)" : "arena (new)", modelCount, vertexCount, variant == 0);
+            fflush(stdout);
+            _exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+#!/bin/sh
+# reproducible render benchmark: renders synthetic scenes of 1 to 1M objects and 1k to ~50M
+# triangles headless along scripted camera paths, with instancing, culling and frames in flight
+# varied, and writes the results of every run (frame time percentiles, record, cull and GPU time,
+# draws, memory) to one JSON file together with the commit it was built from.
+# run from the repository root after `make`, or through `make bench`.
+# usage: bench/suite.sh [OUTPUT.json] [extra vulest arguments], default output bench/results.json.
+# FRAMES and WARMUP set the timed and untimed frames per run (default 200 and 20), SCENES a
+# subset of: tiny mesh grid10k grid100k grid1m.
+# The camera moves by frame number, not time, so every run draws the same frames. Compare
+# results from the same machine and driver; lavapipe is picked when VK_ICD_FILENAMES is unset.
+
+out=${1:-bench/results.json}
+if [ $# -gt 0 ]; then
+    shift
+fi
+frames=${FRAMES:-200}
+warmup=${WARMUP:-20}
+scenes=${SCENES:-"tiny mesh grid10k grid100k grid1m"}
+prog=./vulest
+
+if [ -z "$VK_ICD_FILENAMES" ]; then
+    for icd in /usr/share/vulkan/icd.d/lvp_icd.*.json; do
+        if [ -f "$icd" ]; then
+            export VK_ICD_FILENAMES="$icd"
+            break
+        fi
+    done
+fi
+
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+if [ -n "$(git status --porcelain --untracked-files=no 2>/dev/null)" ]; then
+    commit="$commit-dirty"
+fi
+extra="$*"
+run=$(mktemp)
+results=$(mktemp)
+failed=0
+
+# run NAME ARGS... appends one result, tagged with its name and arguments
+run() {
+    label=$1
+    shift
+    printf "%-40s " "$label"
+    if $prog --headless --frames "$frames" --warmup "$warmup" --bench-json "$run" "$@" $extra > /dev/null 2>&1; then
+        if [ -s "$results" ]; then
+            printf ",\n" >> "$results"
+        fi
+        sed "s|^{|{\"name\": \"$label\", \"args\": \"$*\", |" "$run" | tr -d '\n' >> "$results"
+        sed 's/.*"frameMs": {"avg": \([0-9.e+-]*\).*"gpuMs": {"avg": \([0-9.e+-]*\).*/frame \1 ms, gpu \2 ms/' "$run"
+    else
+        echo failed
+        failed=1
+    fi
+}
+
+# scene NAME INSTANCES TRIANGLES PATH, the triangle count is per object
+scene() {
+    name=$1
+    instances=$2
+    triangles=$3
+    path=$4
+    set -- --synthetic "$triangles" --instances "$instances" --camera-path "$path"
+
+    run "$name/instanced" "$@"
+    run "$name/gpu-driven" "$@" --gpu-driven
+    # one draw per object is only recorded up to 100k objects
+    if [ "$instances" -gt 1 ] && [ "$instances" -le 100000 ]; then
+        run "$name/per-draw" "$@" --no-instancing
+        run "$name/cpu-cull" "$@" --no-instancing --cpu-cull
+        run "$name/bvh-cull" "$@" --no-instancing --cull-bvh
+    fi
+    if [ "$name" = grid10k ]; then
+        for inFlight in 1 2 3; do
+            run "$name/cpu-cull/in-flight-$inFlight" "$@" --no-instancing --cpu-cull --frames-in-flight "$inFlight"
+        done
+    fi
+}
+
+for name in $scenes; do
+    case $name in
+        tiny) scene tiny 1 1000 orbit ;;
+        mesh) scene mesh 1 1000000 orbit ;;
+        grid10k) scene grid10k 10000 1000 fly ;;
+        grid100k) scene grid100k 100000 500 fly ;;
+        grid1m) scene grid1m 1000000 36 fly ;;
+        *) echo "unknown scene $name" >&2; failed=1 ;;
+    esac
+done
+
+{
+    printf "{\"commit\": \"%s\", \"frames\": %s, \"warmup\": %s, \"results\": [\n" "$commit" "$frames" "$warmup"
+    cat "$results"
+    printf "\n]}\n"
+} > "$out"
+rm -f "$run" "$results"
+echo "results written to $out"
+exit $failed
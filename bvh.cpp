@@ -0,0 +1,422 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#define BVH_BIN_COUNT 16
+//leaves at most this small are never split
+#define BVH_MIN_LEAF_SIZE 2
+//leaves are never larger than this, even when the SAH prefers not to split
+#define BVH_MAX_LEAF_SIZE 8
+#define BVH_NO_PARENT UINT32_MAX
+
+
+static Aabb emptyBox() {
+    return {glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max())};
+}
+
+static void grow(Aabb &box, const Aabb &other) {
+    box.min = glm::min(box.min, other.min);
+    box.max = glm::max(box.max, other.max);
+}
+
+static void grow(Aabb &box, const glm::vec3 &point) {
+    box.min = glm::min(box.min, point);
+    box.max = glm::max(box.max, point);
+}
+
+//half the surface area, the factor 2 cancels out of every SAH comparison
+static float halfArea(const Aabb &box) {
+    glm::vec3 extent = box.max - box.min;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+void Bvh::build(std::vector<Aabb> bounds) {
+
+    uint32_t objectCount = static_cast<uint32_t>(bounds.size());
+
+    std::vector<BuildEntry> entries(objectCount);
+    for(uint32_t i = 0; i < objectCount; i++) {
+        entries[i] = {bounds[i], 0.5f * (bounds[i].min + bounds[i].max), i};
+    }
+
+    nodes.clear();
+    parents.clear();
+    objectLeaves.assign(objectCount, 0);
+    dirtyObjects.clear();
+    depth = 0;
+
+    //a binary tree with leaves of at least one object has fewer than 2n nodes
+    nodes.reserve(objectCount > 0 ? 2 * objectCount - 1 : 0);
+    parents.reserve(nodes.capacity());
+
+    if(objectCount > 0) {
+        buildNode(entries, 0, objectCount, BVH_NO_PARENT, 0);
+    }
+
+    objects.resize(objectCount);
+    slotBounds.resize(objectCount);
+    objectSlots.resize(objectCount);
+    for(uint32_t i = 0; i < objectCount; i++) {
+        objects[i] = entries[i].object;
+        slotBounds[i] = entries[i].bounds;
+        objectSlots[entries[i].object] = i;
+    }
+}
+
+uint32_t Bvh::buildNode(std::vector<BuildEntry> &entries, uint32_t first, uint32_t count, uint32_t parent, uint32_t nodeDepth) {
+
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.push_back({});
+    parents.push_back(parent);
+    depth = std::max(depth, nodeDepth);
+
+    BuildEntry* begin = entries.data() + first;
+    BuildEntry* end = begin + count;
+
+    Aabb bounds = emptyBox();
+    Aabb centroidBounds = emptyBox();
+    for(BuildEntry* entry = begin; entry != end; entry++) {
+        grow(bounds, entry->bounds);
+        grow(centroidBounds, entry->centroid);
+    }
+    nodes[index].min = bounds.min;
+    nodes[index].max = bounds.max;
+
+    //binned SAH: sort the centroids into bins along each axis, all three in one pass,
+    //and try a split between every pair of neighbouring bins
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    glm::vec3 scale;
+    for(int axis = 0; axis < 3; axis++) {
+        scale[axis] = extent[axis] > 0.f ? BVH_BIN_COUNT / extent[axis] : 0.f;
+    }
+
+    Aabb binBounds[3][BVH_BIN_COUNT];
+    uint32_t binCounts[3][BVH_BIN_COUNT] = {};
+    if(count > BVH_MIN_LEAF_SIZE) {
+        std::fill(&binBounds[0][0], &binBounds[0][0] + 3 * BVH_BIN_COUNT, emptyBox());
+        for(BuildEntry* entry = begin; entry != end; entry++) {
+            for(int axis = 0; axis < 3; axis++) {
+                int bin = std::min(BVH_BIN_COUNT - 1, static_cast<int>((entry->centroid[axis] - centroidBounds.min[axis]) * scale[axis]));
+                binCounts[axis][bin]++;
+                grow(binBounds[axis][bin], entry->bounds);
+            }
+        }
+    }
+
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    float bestCost = std::numeric_limits<float>::max();
+
+    for(int axis = 0; axis < 3 && count > BVH_MIN_LEAF_SIZE; axis++) {
+        if(extent[axis] <= 0.f) {
+            continue;
+        }
+
+        //sweep from the right to get the cost of everything after each split
+        float rightCosts[BVH_BIN_COUNT];
+        Aabb right = emptyBox();
+        uint32_t rightCount = 0;
+        for(int bin = BVH_BIN_COUNT - 1; bin > 0; bin--) {
+            grow(right, binBounds[axis][bin]);
+            rightCount += binCounts[axis][bin];
+            rightCosts[bin] = rightCount > 0 ? rightCount * halfArea(right) : 0.f;
+        }
+
+        Aabb left = emptyBox();
+        uint32_t leftCount = 0;
+        for(int bin = 0; bin < BVH_BIN_COUNT - 1; bin++) {
+            grow(left, binBounds[axis][bin]);
+            leftCount += binCounts[axis][bin];
+            if(leftCount == 0 || leftCount == count) {
+                continue;
+            }
+            float cost = leftCount * halfArea(left) + rightCosts[bin + 1];
+            if(cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = bin + 1;
+            }
+        }
+    }
+
+    bool split = bestAxis >= 0 && bestCost < count * halfArea(bounds);
+    if(!split && count <= BVH_MAX_LEAF_SIZE) {
+        nodes[index].rightOrFirst = first;
+        nodes[index].count = count;
+        for(BuildEntry* entry = begin; entry != end; entry++) {
+            objectLeaves[entry->object] = index;
+        }
+        return index;
+    }
+
+    BuildEntry* middle;
+    if(split) {
+        float axisMin = centroidBounds.min[bestAxis];
+        float axisScale = scale[bestAxis];
+        middle = std::partition(begin, end, [&](const BuildEntry &entry) {
+            int bin = std::min(BVH_BIN_COUNT - 1, static_cast<int>((entry.centroid[bestAxis] - axisMin) * axisScale));
+            return static_cast<uint32_t>(bin) < bestSplit;
+        });
+    }
+    else {
+        //too many objects for a leaf and no split the SAH likes, halve along the widest axis
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        middle = begin + count / 2;
+        std::nth_element(begin, middle, end, [axis](const BuildEntry &a, const BuildEntry &b) {
+            return a.centroid[axis] < b.centroid[axis];
+        });
+    }
+
+    uint32_t middleIndex = static_cast<uint32_t>(middle - entries.data());
+    nodes[index].count = 0;
+    buildNode(entries, first, middleIndex - first, index, nodeDepth + 1);
+    uint32_t right = buildNode(entries, middleIndex, first + count - middleIndex, index, nodeDepth + 1);
+    nodes[index].rightOrFirst = right;
+    return index;
+}
+
+void Bvh::setBounds(uint32_t object, const Aabb &bounds) {
+    slotBounds[objectSlots[object]] = bounds;
+    dirtyObjects.push_back(object);
+}
+
+void Bvh::updateNode(uint32_t index) {
+
+    BvhNode &node = nodes[index];
+    Aabb bounds = emptyBox();
+    if(node.count > 0) {
+        for(uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; i++) {
+            grow(bounds, slotBounds[i]);
+        }
+    }
+    else {
+        const BvhNode &left = nodes[index + 1];
+        const BvhNode &right = nodes[node.rightOrFirst];
+        bounds.min = glm::min(left.min, right.min);
+        bounds.max = glm::max(left.max, right.max);
+    }
+    node.min = bounds.min;
+    node.max = bounds.max;
+}
+
+void Bvh::refit() {
+
+    if(dirtyObjects.empty()) {
+        return;
+    }
+
+    //children come after their parents, so one backwards pass refits everything
+    if(dirtyObjects.size() > objects.size() / 8) {
+        for(uint32_t i = static_cast<uint32_t>(nodes.size()); i-- > 0;) {
+            updateNode(i);
+        }
+        dirtyObjects.clear();
+        return;
+    }
+
+    //walk up from each moved object until a node comes out the same as before
+    for(uint32_t object : dirtyObjects) {
+        uint32_t index = objectLeaves[object];
+        while(index != BVH_NO_PARENT) {
+            glm::vec3 oldMin = nodes[index].min;
+            glm::vec3 oldMax = nodes[index].max;
+            updateNode(index);
+            if(nodes[index].min == oldMin && nodes[index].max == oldMax) {
+                break;
+            }
+            index = parents[index];
+        }
+    }
+    dirtyObjects.clear();
+}
+
+//false when the box is outside a plane in mask, and drops the planes it is completely inside of
+static bool testBox(const Frustum &frustum, const glm::vec3 &min, const glm::vec3 &max, uint32_t &mask) {
+
+    for(uint32_t p = 0; p < 6; p++) {
+        if(!(mask & (1u << p))) {
+            continue;
+        }
+        const glm::vec4 &plane = frustum.planes[p];
+        glm::vec3 normal = glm::vec3(plane);
+
+        //the corners furthest along and against the plane normal
+        glm::vec3 positive(plane.x >= 0.f ? max.x : min.x, plane.y >= 0.f ? max.y : min.y, plane.z >= 0.f ? max.z : min.z);
+        if(glm::dot(normal, positive) + plane.w < 0.f) {
+            return false;
+        }
+        glm::vec3 negative(plane.x >= 0.f ? min.x : max.x, plane.y >= 0.f ? min.y : max.y, plane.z >= 0.f ? min.z : max.z);
+        if(glm::dot(normal, negative) + plane.w >= 0.f) {
+            mask &= ~(1u << p);
+        }
+    }
+    return true;
+}
+
+void Bvh::cullFrustum(const Frustum &frustum, std::vector<uint32_t> &visible) const {
+
+    visible.clear();
+    if(nodes.empty()) {
+        return;
+    }
+
+    //once a node is completely inside a plane its whole subtree is, so the plane is not tested again
+    struct Entry {
+        uint32_t node;
+        uint32_t planeMask;
+    };
+    std::vector<Entry> stack;
+    stack.reserve(depth + 2);
+    stack.push_back({0, 0x3f});
+
+    while(!stack.empty()) {
+        Entry entry = stack.back();
+        stack.pop_back();
+
+        const BvhNode &node = nodes[entry.node];
+        uint32_t mask = entry.planeMask;
+        if(mask != 0 && !testBox(frustum, node.min, node.max, mask)) {
+            continue;
+        }
+
+        if(node.count == 0) {
+            stack.push_back({node.rightOrFirst, mask});
+            stack.push_back({entry.node + 1, mask});
+            continue;
+        }
+
+        for(uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; i++) {
+            uint32_t objectMask = mask;
+            const Aabb &bounds = slotBounds[i];
+            if(objectMask == 0 || testBox(frustum, bounds.min, bounds.max, objectMask)) {
+                visible.push_back(objects[i]);
+            }
+        }
+    }
+}
+
+//distance along the ray where it enters the box, clamped to the origin; false if it misses or enters past maxDistance
+static bool intersectBox(const glm::vec3 &origin, const glm::vec3 &inverseDirection, const glm::vec3 &min, const glm::vec3 &max, float maxDistance, float &entry) {
+
+    float near = 0.f;
+    float far = maxDistance;
+    for(int axis = 0; axis < 3; axis++) {
+        float t0 = (min[axis] - origin[axis]) * inverseDirection[axis];
+        float t1 = (max[axis] - origin[axis]) * inverseDirection[axis];
+        //fmin and fmax drop the NaN of a ray lying in the slab's plane
+        near = std::fmax(near, std::fmin(t0, t1));
+        far = std::fmin(far, std::fmax(t0, t1));
+    }
+    entry = near;
+    return near <= far && near < maxDistance;
+}
+
+bool Bvh::raycast(glm::vec3 origin, glm::vec3 direction, const std::function<float(uint32_t)> &intersect, uint32_t &object, float &distance) const {
+
+    if(nodes.empty()) {
+        return false;
+    }
+
+    glm::vec3 inverseDirection(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+    float best = std::numeric_limits<float>::max();
+    bool hit = false;
+
+    struct Entry {
+        uint32_t node;
+        float entry;
+    };
+    std::vector<Entry> stack;
+    stack.reserve(depth + 2);
+
+    float rootEntry;
+    if(!intersectBox(origin, inverseDirection, nodes[0].min, nodes[0].max, best, rootEntry)) {
+        return false;
+    }
+    stack.push_back({0, rootEntry});
+
+    while(!stack.empty()) {
+        Entry entry = stack.back();
+        stack.pop_back();
+        //a closer hit was found since the node was pushed
+        if(entry.entry >= best) {
+            continue;
+        }
+
+        const BvhNode &node = nodes[entry.node];
+        if(node.count == 0) {
+            //visit the nearer child first so the far one is more likely to be pruned
+            uint32_t children[2] = {entry.node + 1, node.rightOrFirst};
+            float entries[2];
+            bool hits[2];
+            for(int c = 0; c < 2; c++) {
+                hits[c] = intersectBox(origin, inverseDirection, nodes[children[c]].min, nodes[children[c]].max, best, entries[c]);
+            }
+            int nearChild = hits[0] && hits[1] ? (entries[0] <= entries[1] ? 0 : 1) : (hits[0] ? 0 : 1);
+            int farChild = 1 - nearChild;
+            if(hits[farChild]) {
+                stack.push_back({children[farChild], entries[farChild]});
+            }
+            if(hits[nearChild]) {
+                stack.push_back({children[nearChild], entries[nearChild]});
+            }
+            continue;
+        }
+
+        for(uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; i++) {
+            const Aabb &bounds = slotBounds[i];
+            float boxEntry;
+            if(!intersectBox(origin, inverseDirection, bounds.min, bounds.max, best, boxEntry)) {
+                continue;
+            }
+            float t = intersect ? intersect(objects[i]) : boxEntry;
+            if(t >= 0.f && t < best) {
+                best = t;
+                object = objects[i];
+                hit = true;
+            }
+        }
+    }
+
+    distance = best;
+    return hit;
+}
+
+uint32_t Bvh::getNodeCount() const {
+    return static_cast<uint32_t>(nodes.size());
+}
+
+uint32_t Bvh::getObjectCount() const {
+    return static_cast<uint32_t>(objects.size());
+}
+
+uint32_t Bvh::getDepth() const {
+    return depth;
+}
+
+float intersectTriangle(glm::vec3 origin, glm::vec3 direction, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+
+    //Moller-Trumbore, both sides of the triangle count
+    glm::vec3 edge1 = b - a;
+    glm::vec3 edge2 = c - a;
+    glm::vec3 p = glm::cross(direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if(std::fabs(determinant) < 1e-12f) {
+        return -1.f;
+    }
+    float inverseDeterminant = 1.f / determinant;
+
+    glm::vec3 s = origin - a;
+    float u = glm::dot(s, p) * inverseDeterminant;
+    if(u < 0.f || u > 1.f) {
+        return -1.f;
+    }
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(direction, q) * inverseDeterminant;
+    if(v < 0.f || u + v > 1.f) {
+        return -1.f;
+    }
+    return glm::dot(edge2, q) * inverseDeterminant;
+}
@@ -0,0 +1,82 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "frustumCull.hpp"
+
+
+struct Aabb {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+//32 bytes, two nodes per cache line. Nodes are stored depth first, so a node's left child
+//directly follows it and a subtree is one contiguous run of the array.
+struct BvhNode {
+    glm::vec3 min;
+    //leaf: first entry of its objects in the object list, inner node: index of the right child
+    uint32_t rightOrFirst;
+    glm::vec3 max;
+    //objects in a leaf, 0 for inner nodes
+    uint32_t count;
+};
+
+//bounding volume hierarchy over object boxes, built with the binned surface area heuristic.
+//Moved objects are refit in place: only the nodes above them are updated, the topology stays.
+class Bvh {
+    public:
+        void build(std::vector<Aabb> bounds);
+
+        //change an object's box, the tree catches up on the next refit
+        void setBounds(uint32_t object, const Aabb &bounds);
+        //grow or shrink the nodes above every object changed since the last refit
+        void refit();
+
+        //the objects whose boxes intersect the frustum, in traversal order
+        void cullFrustum(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+
+        //nearest object hit by the ray. intersect is called for objects whose box the ray enters
+        //closer than the best hit so far and returns the hit distance, negative for a miss;
+        //without it the distance to the box is used.
+        bool raycast(glm::vec3 origin, glm::vec3 direction, const std::function<float(uint32_t)> &intersect, uint32_t &object, float &distance) const;
+
+        uint32_t getNodeCount() const;
+        uint32_t getObjectCount() const;
+        uint32_t getDepth() const;
+
+    private:
+        //objects are partitioned in this array while building, so every pass reads it in order
+        struct BuildEntry {
+            Aabb bounds;
+            glm::vec3 centroid;
+            uint32_t object;
+        };
+
+        uint32_t buildNode(std::vector<BuildEntry> &entries, uint32_t first, uint32_t count, uint32_t parent, uint32_t depth);
+        void updateNode(uint32_t node);
+
+        std::vector<BvhNode> nodes;
+        //the objects in leaf order, each leaf owns a contiguous range of slots,
+        //and their boxes in the same order so a leaf's boxes share cache lines
+        std::vector<uint32_t> objects;
+        std::vector<Aabb> slotBounds;
+
+        //for refitting: the parent of every node, the slot and leaf of every object
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> objectSlots;
+        std::vector<uint32_t> objectLeaves;
+        std::vector<uint32_t> dirtyObjects;
+
+        uint32_t depth = 0;
+};
+
+//distance along the ray to triangle abc, negative for a miss
+float intersectTriangle(glm::vec3 origin, glm::vec3 direction, glm::vec3 a, glm::vec3 b, glm::vec3 c);
+
+
+#endif
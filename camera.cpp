@@ -11,6 +11,14 @@ void Camera::updateView() {
     *view = glm::lookAt(pos, pos + forward, up);
 }
 
+void Camera::lookAt(glm::vec3 pos, glm::vec3 target) {
+    this->pos = pos;
+    forward = glm::normalize(target - pos);
+    glm::vec3 worldUp(0.f, 1.f, 0.f);
+    up = glm::normalize(worldUp - glm::dot(worldUp, forward) * forward);
+    updateView();
+}
+
 void Camera::moveForward() {
     pos = pos + sensitivity * forward;
     updateView();
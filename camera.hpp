@@ -11,6 +11,8 @@ class Camera{
     Camera(glm::mat4* view, glm::vec3 forward = glm::vec3(0.f, 0.f, -1.f), glm::vec3 up = glm::vec3(0.f, 1.f, 0.f), glm::vec3 pos = glm::vec3(0.f, 0.f, 0.f));
 
     void updateView();
+    //place the camera at pos facing target, with up as close to +y as it allows
+    void lookAt(glm::vec3 pos, glm::vec3 target);
 
     void moveForward();
     void moveBackward();
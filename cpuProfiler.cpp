@@ -0,0 +1,132 @@
+#include "cpuProfiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+
+std::atomic<bool> CpuProfiler::enabled{false};
+thread_local CpuProfiler::ThreadRing* CpuProfiler::ring = nullptr;
+std::mutex CpuProfiler::ringsMutex;
+std::vector<std::unique_ptr<CpuProfiler::ThreadRing>> CpuProfiler::rings;
+uint64_t CpuProfiler::startTicks = 0;
+std::chrono::steady_clock::time_point CpuProfiler::startTime;
+
+void CpuProfiler::enable() {
+
+    startTime = std::chrono::steady_clock::now();
+    startTicks = now();
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void CpuProfiler::setThreadName(const char* name) {
+
+    if(!isEnabled()) {
+        return;
+    }
+    if(!ring) {
+        registerThread();
+    }
+    ring->name = name;
+}
+
+CpuProfiler::ThreadRing* CpuProfiler::registerThread() {
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    rings.emplace_back(new ThreadRing());
+    rings.back()->id = static_cast<uint32_t>(rings.size() - 1);
+    ring = rings.back().get();
+    return ring;
+}
+
+double CpuProfiler::getMsPerTick() {
+
+    uint64_t ticks = now() - startTicks;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return ticks > 0 ? ms / ticks : 0.0;
+}
+
+void CpuProfiler::printStats(std::ostream &out) {
+
+    struct Totals {
+        uint64_t count = 0;
+        uint64_t ticks = 0;
+        uint64_t longest = 0;
+    };
+    std::map<std::string, Totals> totals;
+    uint64_t dropped = 0;
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for(const std::unique_ptr<ThreadRing> &threadRing : rings) {
+        uint64_t written = threadRing->written.load(std::memory_order_acquire);
+        uint64_t first = written > RING_SIZE ? written - RING_SIZE : 0;
+        dropped += first;
+        for(uint64_t i = first; i < written; i++) {
+            const Event &event = threadRing->events[i & (RING_SIZE - 1)];
+            Totals &zone = totals[event.name];
+            zone.count++;
+            zone.ticks += event.end - event.begin;
+            zone.longest = std::max(zone.longest, event.end - event.begin);
+        }
+    }
+    if(totals.empty()) {
+        return;
+    }
+
+    //the most expensive zones first
+    std::vector<std::pair<std::string, Totals>> sorted(totals.begin(), totals.end());
+    std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, Totals> &a, const std::pair<std::string, Totals> &b) {
+        return a.second.ticks > b.second.ticks;
+    });
+
+    double msPerTick = getMsPerTick();
+    out << "CPU zone times:\n";
+    for(const std::pair<std::string, Totals> &zone : sorted) {
+        out << "  " << zone.first << ": " << zone.second.count << " x " << zone.second.ticks * msPerTick / zone.second.count
+            << " ms = " << zone.second.ticks * msPerTick << " ms, longest " << zone.second.longest * msPerTick << " ms\n";
+    }
+    if(dropped > 0) {
+        out << "  " << dropped << " older zones were overwritten\n";
+    }
+}
+
+void CpuProfiler::writeChromeTrace(const std::string &path) {
+
+    std::ofstream file(path);
+    if(!file) {
+        throw std::runtime_error("Could not open CPU trace file " + path + ".");
+    }
+
+    //one row per thread, times in microseconds from enable()
+    double usPerTick = getMsPerTick() * 1000.0;
+    file.setf(std::ios::fixed);
+    file.precision(3);
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}}";
+    for(const std::unique_ptr<ThreadRing> &threadRing : rings) {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadRing->id << ",\"args\":{\"name\":\"";
+        if(threadRing->name) {
+            file << threadRing->name;
+        }
+        else {
+            file << "thread " << threadRing->id;
+        }
+        file << "\"}}";
+
+        uint64_t written = threadRing->written.load(std::memory_order_acquire);
+        uint64_t first = written > RING_SIZE ? written - RING_SIZE : 0;
+        for(uint64_t i = first; i < written; i++) {
+            const Event &event = threadRing->events[i & (RING_SIZE - 1)];
+            file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << threadRing->id
+                 << ",\"ts\":" << static_cast<int64_t>(event.begin - startTicks) * usPerTick << ",\"dur\":" << (event.end - event.begin) * usPerTick << '}';
+        }
+    }
+    file << "\n]}\n";
+
+    if(!file) {
+        throw std::runtime_error("Could not write CPU trace file " + path + ".");
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef CPUPROFILER_HPP
+#define CPUPROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+//scoped CPU zones. CPU_ZONE("name") times the rest of the enclosing block on the calling
+//thread. Every thread writes its zones into its own ring, so recording takes no locks and
+//only the oldest zones are lost when a ring wraps. While the profiler is off a zone is a
+//single flag check. Zone names are kept as pointers, so they have to be string literals.
+class CpuProfiler {
+    public:
+        //start recording the zones of every thread
+        static void enable();
+        static bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+        //row name of the calling thread in the trace, a string literal
+        static void setThreadName(const char* name);
+
+        //the invariant TSC where there is one, calibrated against steady_clock when read
+        static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+        }
+
+        static void record(const char* name, uint64_t begin, uint64_t end) {
+            ThreadRing* current = ring;
+            if(!current) {
+                current = registerThread();
+            }
+            uint64_t index = current->written.load(std::memory_order_relaxed);
+            current->events[index & (RING_SIZE - 1)] = {name, begin, end};
+            current->written.store(index + 1, std::memory_order_release);
+        }
+
+        //the readers below expect every recording thread to be idle or gone
+        //count, total and longest time of every zone name
+        static void printStats(std::ostream &out);
+        //every zone as a complete event of the Chrome trace format (chrome://tracing, Perfetto)
+        static void writeChromeTrace(const std::string &path);
+
+    private:
+        static constexpr uint64_t RING_SIZE = 1 << 16;
+
+        struct Event {
+            const char* name;
+            uint64_t begin;
+            uint64_t end;
+        };
+        //rings are never freed, so zones of threads that have exited can still be read
+        struct ThreadRing {
+            std::unique_ptr<Event[]> events{new Event[RING_SIZE]};
+            std::atomic<uint64_t> written{0};
+            const char* name = nullptr;
+            uint32_t id = 0;
+        };
+
+        static ThreadRing* registerThread();
+        static double getMsPerTick();
+
+        static std::atomic<bool> enabled;
+        static thread_local ThreadRing* ring;
+        static std::mutex ringsMutex;
+        static std::vector<std::unique_ptr<ThreadRing>> rings;
+        //ticks and time when recording started, to scale ticks to milliseconds
+        static uint64_t startTicks;
+        static std::chrono::steady_clock::time_point startTime;
+};
+
+class CpuZone {
+    public:
+        explicit CpuZone(const char* name) : name(name), begin(CpuProfiler::isEnabled() ? CpuProfiler::now() : 0) {}
+        ~CpuZone() {
+            end();
+        }
+
+        //close the zone before the end of its block
+        void end() {
+            if(begin != 0) {
+                CpuProfiler::record(name, begin, CpuProfiler::now());
+                begin = 0;
+            }
+        }
+
+        CpuZone(const CpuZone&) = delete;
+        CpuZone& operator=(const CpuZone&) = delete;
+
+    private:
+        const char* name;
+        uint64_t begin;
+};
+
+#define CPU_ZONE_CONCAT(a, b) a##b
+#define CPU_ZONE_VARIABLE(line) CPU_ZONE_CONCAT(cpuZone, line)
+#define CPU_ZONE(name) CpuZone CPU_ZONE_VARIABLE(__LINE__)(name)
+
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef FLATHASHMAP_HPP
+#define FLATHASHMAP_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+//open addressing hash map from 64 bit keys to 32 bit values with linear probing.
+//Keys and values live in two flat arrays, so a lookup touches one or two cache lines
+//and nothing is allocated per entry. The all ones key is reserved as the empty marker.
+class FlatHashMap {
+    public:
+        static constexpr uint64_t EMPTY_KEY = ~0ull;
+
+        FlatHashMap(size_t expectedCount = 0) {
+            reserve(expectedCount);
+        }
+
+        void reserve(size_t expectedCount) {
+            //keep the load factor at or below one half
+            size_t capacity = 16;
+            while(capacity < expectedCount * 2) {
+                capacity *= 2;
+            }
+            if(capacity > keys.size()) {
+                rehash(capacity);
+            }
+        }
+
+        //returns the value stored for key, inserting value first if the key is new
+        uint32_t findOrInsert(uint64_t key, uint32_t value, bool &inserted) {
+            if((count + 1) * 2 > keys.size()) {
+                rehash(keys.size() * 2);
+            }
+            size_t slot = hash(key) & mask;
+            while(keys[slot] != EMPTY_KEY) {
+                if(keys[slot] == key) {
+                    inserted = false;
+                    return values[slot];
+                }
+                slot = (slot + 1) & mask;
+            }
+            keys[slot] = key;
+            values[slot] = value;
+            count++;
+            inserted = true;
+            return value;
+        }
+
+        const uint32_t* find(uint64_t key) const {
+            size_t slot = hash(key) & mask;
+            while(keys[slot] != EMPTY_KEY) {
+                if(keys[slot] == key) {
+                    return &values[slot];
+                }
+                slot = (slot + 1) & mask;
+            }
+            return nullptr;
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+    private:
+        //splitmix64 finalizer, packed index pairs hash badly with the identity
+        static uint64_t hash(uint64_t key) {
+            key ^= key >> 30;
+            key *= 0xbf58476d1ce4e5b9ull;
+            key ^= key >> 27;
+            key *= 0x94d049bb133111ebull;
+            key ^= key >> 31;
+            return key;
+        }
+
+        void rehash(size_t capacity) {
+            std::vector<uint64_t> oldKeys;
+            std::vector<uint32_t> oldValues;
+            oldKeys.swap(keys);
+            oldValues.swap(values);
+
+            keys.assign(capacity, EMPTY_KEY);
+            values.resize(capacity);
+            mask = capacity - 1;
+
+            for(size_t i = 0; i < oldKeys.size(); i++) {
+                if(oldKeys[i] == EMPTY_KEY) {
+                    continue;
+                }
+                size_t slot = hash(oldKeys[i]) & mask;
+                while(keys[slot] != EMPTY_KEY) {
+                    slot = (slot + 1) & mask;
+                }
+                keys[slot] = oldKeys[i];
+                values[slot] = oldValues[i];
+            }
+        }
+
+        std::vector<uint64_t> keys;
+        std::vector<uint32_t> values;
+        size_t mask = 0;
+        size_t count = 0;
+};
+
+
+#endif
@@ -0,0 +1,67 @@
+#include "frameTimer.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+
+FrameTimer::FrameTimer(double reportIntervalSeconds, bool print, bool keepSamples) : reportIntervalSeconds(reportIntervalSeconds), print(print), keepSamples(keepSamples) {
+    start = clock::now();
+    last = start;
+    intervalStart = start;
+}
+
+void FrameTimer::tick() {
+
+    clock::time_point now = clock::now();
+    lastFrameMs = std::chrono::duration<double, std::milli>(now - last).count();
+    last = now;
+    if(keepSamples) {
+        samples.push_back(lastFrameMs);
+    }
+
+    frameCount++;
+    intervalFrameCount++;
+
+    double intervalSeconds = std::chrono::duration<double>(now - intervalStart).count();
+    if(intervalSeconds >= reportIntervalSeconds) {
+        if(print) {
+            double avgMs = 1000.0 * intervalSeconds / intervalFrameCount;
+            std::cout << "frame time: " << avgMs << " ms (" << 1000.0 / avgMs << " fps)\n";
+        }
+        intervalStart = now;
+        intervalFrameCount = 0;
+    }
+}
+
+double FrameTimer::getLastFrameMs() {
+    return lastFrameMs;
+}
+
+double FrameTimer::getAverageFrameMs() {
+    if(frameCount == 0) {
+        return 0.0;
+    }
+    return std::chrono::duration<double, std::milli>(last - start).count() / frameCount;
+}
+
+uint64_t FrameTimer::getFrameCount() {
+    return frameCount;
+}
+
+double FrameTimer::getPercentileFrameMs(double percentile) {
+
+    if(samples.empty()) {
+        return 0.0;
+    }
+    //nearest rank
+    std::vector<double> sorted = samples;
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * sorted.size()));
+    size_t index = std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+double FrameTimer::getMaxFrameMs() {
+    return samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end());
+}
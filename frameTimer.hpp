@@ -0,0 +1,43 @@
+#ifndef FRAMETIMER_HPP
+#define FRAMETIMER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+
+//measures wall clock time between consecutive tick() calls and prints
+//the average frame time once per report interval
+class FrameTimer {
+    public:
+        //keepSamples stores every frame time, for percentiles
+        FrameTimer(double reportIntervalSeconds = 1.0, bool print = true, bool keepSamples = false);
+
+        void tick();
+
+        double getLastFrameMs();
+        double getAverageFrameMs();
+        uint64_t getFrameCount();
+        //frame time below which percentile (0 to 100) of the frames fall, 0 without samples
+        double getPercentileFrameMs(double percentile);
+        double getMaxFrameMs();
+
+    private:
+        typedef std::chrono::steady_clock clock;
+
+        clock::time_point start;
+        clock::time_point last;
+        clock::time_point intervalStart;
+
+        double reportIntervalSeconds;
+        bool print;
+        bool keepSamples;
+        std::vector<double> samples;
+
+        double lastFrameMs = 0.0;
+        uint64_t frameCount = 0;
+        uint64_t intervalFrameCount = 0;
+};
+
+
+#endif
@@ -0,0 +1,235 @@
+#include "frustumCull.hpp"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FRUSTUMCULL_X86
+#endif
+
+
+Frustum extractFrustum(const glm::mat4 &viewProjection) {
+
+    //glm is column major, so row i is m[0][i], m[1][i], m[2][i], m[3][i]
+    glm::vec4 rows[4];
+    for(int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    //same planes as shaders/cull.comp: left, right, bottom, top, near (depth 0) and far
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+
+    for(glm::vec4 &plane : frustum.planes) {
+        plane = plane / glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+void SphereSoA::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+    count = 0;
+}
+
+void SphereSoA::reserve(size_t sphereCount) {
+    size_t padded = (sphereCount + 7) & ~size_t(7);
+    x.reserve(padded);
+    y.reserve(padded);
+    z.reserve(padded);
+    radius.reserve(padded);
+}
+
+uint32_t SphereSoA::add(glm::vec3 center, float sphereRadius) {
+
+    //overwrite the first padding slot, then pad again up to the next multiple of 8
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    radius.resize(count);
+
+    x.push_back(center.x);
+    y.push_back(center.y);
+    z.push_back(center.z);
+    radius.push_back(sphereRadius);
+    uint32_t index = static_cast<uint32_t>(count++);
+
+    //a radius of -inf fails every plane test, whatever the plane
+    size_t padded = (count + 7) & ~size_t(7);
+    x.resize(padded, 0.f);
+    y.resize(padded, 0.f);
+    z.resize(padded, 0.f);
+    radius.resize(padded, -std::numeric_limits<float>::infinity());
+
+    return index;
+}
+
+size_t SphereSoA::size() const {
+    return count;
+}
+
+size_t SphereSoA::paddedSize() const {
+    return x.size();
+}
+
+const float* SphereSoA::getX() const {
+    return x.data();
+}
+
+const float* SphereSoA::getY() const {
+    return y.data();
+}
+
+const float* SphereSoA::getZ() const {
+    return z.data();
+}
+
+const float* SphereSoA::getRadius() const {
+    return radius.data();
+}
+
+static size_t cullSpheresScalar(const Frustum &frustum, const SphereSoA &spheres, uint32_t* visible) {
+
+    const float* x = spheres.getX();
+    const float* y = spheres.getY();
+    const float* z = spheres.getZ();
+    const float* r = spheres.getRadius();
+
+    size_t visibleCount = 0;
+    for(size_t i = 0; i < spheres.size(); i++) {
+        bool inside = true;
+        for(const glm::vec4 &plane : frustum.planes) {
+            if(plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w < -r[i]) {
+                inside = false;
+                break;
+            }
+        }
+        if(inside) {
+            visible[visibleCount++] = static_cast<uint32_t>(i);
+        }
+    }
+    return visibleCount;
+}
+
+#ifdef FRUSTUMCULL_X86
+
+__attribute__((target("sse2")))
+static size_t cullSpheresSSE(const Frustum &frustum, const SphereSoA &spheres, uint32_t* visible) {
+
+    const float* x = spheres.getX();
+    const float* y = spheres.getY();
+    const float* z = spheres.getZ();
+    const float* r = spheres.getRadius();
+
+    __m128 planes[6][4];
+    for(int p = 0; p < 6; p++) {
+        for(int c = 0; c < 4; c++) {
+            planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+        }
+    }
+    const __m128 signMask = _mm_set1_ps(-0.f);
+
+    size_t visibleCount = 0;
+    for(size_t i = 0; i < spheres.paddedSize(); i += 4) {
+        __m128 sx = _mm_loadu_ps(x + i);
+        __m128 sy = _mm_loadu_ps(y + i);
+        __m128 sz = _mm_loadu_ps(z + i);
+        __m128 negRadius = _mm_xor_ps(_mm_loadu_ps(r + i), signMask);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for(int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], sx), _mm_mul_ps(planes[p][1], sy)),
+                                         _mm_add_ps(_mm_mul_ps(planes[p][2], sz), planes[p][3]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+
+        //branchless compaction: every lane is written, only the visible ones advance the count
+        unsigned mask = static_cast<unsigned>(_mm_movemask_ps(inside));
+        for(unsigned lane = 0; lane < 4; lane++) {
+            visible[visibleCount] = static_cast<uint32_t>(i + lane);
+            visibleCount += (mask >> lane) & 1;
+        }
+    }
+    return visibleCount;
+}
+
+__attribute__((target("avx")))
+static size_t cullSpheresAVX(const Frustum &frustum, const SphereSoA &spheres, uint32_t* visible) {
+
+    const float* x = spheres.getX();
+    const float* y = spheres.getY();
+    const float* z = spheres.getZ();
+    const float* r = spheres.getRadius();
+
+    __m256 planes[6][4];
+    for(int p = 0; p < 6; p++) {
+        for(int c = 0; c < 4; c++) {
+            planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+        }
+    }
+    const __m256 signMask = _mm256_set1_ps(-0.f);
+
+    size_t visibleCount = 0;
+    for(size_t i = 0; i < spheres.paddedSize(); i += 8) {
+        __m256 sx = _mm256_loadu_ps(x + i);
+        __m256 sy = _mm256_loadu_ps(y + i);
+        __m256 sz = _mm256_loadu_ps(z + i);
+        __m256 negRadius = _mm256_xor_ps(_mm256_loadu_ps(r + i), signMask);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for(int p = 0; p < 6; p++) {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], sx), _mm256_mul_ps(planes[p][1], sy)),
+                                            _mm256_add_ps(_mm256_mul_ps(planes[p][2], sz), planes[p][3]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+        }
+
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(inside));
+        for(unsigned lane = 0; lane < 8; lane++) {
+            visible[visibleCount] = static_cast<uint32_t>(i + lane);
+            visibleCount += (mask >> lane) & 1;
+        }
+    }
+    return visibleCount;
+}
+
+#endif
+
+CullPath getBestCullPath() {
+#ifdef FRUSTUMCULL_X86
+    if(__builtin_cpu_supports("avx")) {
+        return CULL_PATH_AVX;
+    }
+    if(__builtin_cpu_supports("sse2")) {
+        return CULL_PATH_SSE;
+    }
+#endif
+    return CULL_PATH_SCALAR;
+}
+
+const char* getCullPathName(CullPath path) {
+    switch(path) {
+        case CULL_PATH_SSE: return "sse";
+        case CULL_PATH_AVX: return "avx";
+        default: return "scalar";
+    }
+}
+
+size_t cullSpheres(const Frustum &frustum, const SphereSoA &spheres, uint32_t* visible, CullPath path) {
+#ifdef FRUSTUMCULL_X86
+    if(path == CULL_PATH_AVX) {
+        return cullSpheresAVX(frustum, spheres, visible);
+    }
+    if(path == CULL_PATH_SSE) {
+        return cullSpheresSSE(frustum, spheres, visible);
+    }
+#endif
+    return cullSpheresScalar(frustum, spheres, visible);
+}
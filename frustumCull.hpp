@@ -0,0 +1,61 @@
+#ifndef FRUSTUMCULL_HPP
+#define FRUSTUMCULL_HPP
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+//the six planes of a view projection matrix with 0..1 depth, normalized and facing inwards,
+//so a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+Frustum extractFrustum(const glm::mat4 &viewProjection);
+
+//world space bounding spheres in structure of arrays layout, one array per component, so four
+//or eight spheres load into one SIMD register each. The arrays are padded to a multiple of 8
+//with spheres that are always outside, which lets the SIMD loops run without a scalar tail.
+class SphereSoA {
+    public:
+        void clear();
+        void reserve(size_t count);
+        uint32_t add(glm::vec3 center, float radius);
+
+        //number of spheres added, without the padding
+        size_t size() const;
+        //size of the arrays, with the padding
+        size_t paddedSize() const;
+
+        const float* getX() const;
+        const float* getY() const;
+        const float* getZ() const;
+        const float* getRadius() const;
+
+    private:
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> radius;
+        size_t count = 0;
+};
+
+enum CullPath {
+    CULL_PATH_SCALAR,
+    CULL_PATH_SSE,
+    CULL_PATH_AVX
+};
+
+//widest path the CPU supports
+CullPath getBestCullPath();
+const char* getCullPathName(CullPath path);
+
+//writes the indices of the spheres that intersect the frustum to visible, in ascending order,
+//and returns how many there are. visible needs room for spheres.paddedSize() indices.
+size_t cullSpheres(const Frustum &frustum, const SphereSoA &spheres, uint32_t* visible, CullPath path);
+
+
+#endif
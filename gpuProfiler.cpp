@@ -0,0 +1,249 @@
+#include "gpuProfiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+
+GpuProfiler::GpuProfiler(VkDevice device, float timestampPeriod, uint32_t validBits, uint32_t slotCount, uint32_t maxZones, bool trace)
+    : device(device), msPerTick(timestampPeriod * 1e-6), maxZones(maxZones), trace(trace), slots(slotCount), results(2 * maxZones) {
+
+    tickMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    createQueryPool();
+}
+
+GpuProfiler::~GpuProfiler() {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+}
+
+void GpuProfiler::createQueryPool() {
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2 * maxZones * static_cast<uint32_t>(slots.size());
+
+    if(vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create timestamp query pool.");
+    }
+}
+
+void GpuProfiler::setSlotCount(uint32_t slotCount) {
+
+    //the queries of every slot are reset before its first zone, the new pool needs nothing else
+    vkDestroyQueryPool(device, queryPool, nullptr);
+    slots.assign(slotCount, Slot());
+    createQueryPool();
+}
+
+void GpuProfiler::beginSlot(uint32_t slot) {
+    slots[slot].zones.clear();
+    slots[slot].pending = false;
+}
+
+uint32_t GpuProfiler::internName(const char* name) {
+
+    for(uint32_t id = 0; id < timings.size(); id++) {
+        if(timings[id].name == name) {
+            return id;
+        }
+    }
+    timings.emplace_back();
+    timings.back().name = name;
+    return static_cast<uint32_t>(timings.size() - 1);
+}
+
+uint32_t GpuProfiler::reserveZones(uint32_t slot, const char* name, uint32_t count, const uint32_t* args) {
+
+    std::vector<Zone> &zones = slots[slot].zones;
+    if(count == 0 || zones.size() + count > maxZones) {
+        return NO_ZONE;
+    }
+
+    uint32_t first = static_cast<uint32_t>(zones.size());
+    uint32_t nameId = internName(name);
+    for(uint32_t z = 0; z < count; z++) {
+        zones.push_back({nameId, args ? args[z] : NO_ZONE});
+    }
+    return first;
+}
+
+void GpuProfiler::recordReset(VkCommandBuffer commandBuffer, uint32_t slot) {
+    vkCmdResetQueryPool(commandBuffer, queryPool, 2 * maxZones * slot, 2 * maxZones);
+}
+
+void GpuProfiler::beginZone(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t zone) {
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 2 * (maxZones * slot + zone));
+}
+
+void GpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t zone) {
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 2 * (maxZones * slot + zone) + 1);
+}
+
+void GpuProfiler::submitted(uint32_t slot) {
+    slots[slot].pending = !slots[slot].zones.empty();
+}
+
+void GpuProfiler::collect(uint32_t slot) {
+
+    Slot &current = slots[slot];
+    if(!current.pending) {
+        return;
+    }
+    current.pending = false;
+
+    //without the wait flag this returns VK_NOT_READY instead of blocking, the frame is then skipped
+    uint32_t queryCount = 2 * static_cast<uint32_t>(current.zones.size());
+    if(vkGetQueryPoolResults(device, queryPool, 2 * maxZones * slot, queryCount, queryCount * sizeof(uint64_t), results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return;
+    }
+
+    for(size_t z = 0; z < current.zones.size(); z++) {
+        const Zone &zone = current.zones[z];
+        uint64_t begin = results[2 * z] & tickMask;
+        uint64_t end = results[2 * z + 1] & tickMask;
+        double ms = ((end - begin) & tickMask) * msPerTick;
+
+        Timings &timing = timings[zone.nameId];
+        if(timing.window.size() < WINDOW) {
+            timing.window.push_back(ms);
+        }
+        else {
+            timing.window[timing.next] = ms;
+        }
+        timing.next = (timing.next + 1) % WINDOW;
+        timing.samples++;
+        timing.lastMs = ms;
+        timing.totalMs += ms;
+
+        if(trace) {
+            if(traceEvents.size() < MAX_TRACE_EVENTS) {
+                traceEvents.push_back({zone.nameId, zone.arg, begin, end});
+            }
+            else {
+                traceTruncated = true;
+            }
+        }
+    }
+}
+
+void GpuProfiler::collectAll() {
+    for(uint32_t slot = 0; slot < slots.size(); slot++) {
+        collect(slot);
+    }
+}
+
+void GpuProfiler::clearStats() {
+
+    for(Timings &timing : timings) {
+        timing.window.clear();
+        timing.next = 0;
+        timing.samples = 0;
+        timing.lastMs = 0.0;
+        timing.totalMs = 0.0;
+    }
+    traceEvents.clear();
+    traceTruncated = false;
+}
+
+GpuProfiler::ZoneStats GpuProfiler::computeStats(uint32_t nameId) {
+
+    const Timings &timing = timings[nameId];
+    ZoneStats stats = {timing.name, timing.samples, timing.lastMs, timing.totalMs, 0.0, 0.0, 0.0};
+    if(timing.window.empty()) {
+        return stats;
+    }
+
+    std::vector<double> sorted = timing.window;
+    size_t p99 = (sorted.size() * 99 + 99) / 100 - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+    stats.p99Ms = sorted[p99];
+    stats.minMs = *std::min_element(sorted.begin(), sorted.end());
+    for(double ms : sorted) {
+        stats.avgMs += ms;
+    }
+    stats.avgMs /= sorted.size();
+    return stats;
+}
+
+std::vector<GpuProfiler::ZoneStats> GpuProfiler::getStats() {
+
+    std::vector<ZoneStats> stats;
+    for(uint32_t id = 0; id < timings.size(); id++) {
+        stats.push_back(computeStats(id));
+    }
+    return stats;
+}
+
+GpuProfiler::ZoneStats GpuProfiler::getStats(const char* name) {
+
+    for(uint32_t id = 0; id < timings.size(); id++) {
+        if(timings[id].name == name) {
+            return computeStats(id);
+        }
+    }
+    return {name, 0, 0.0, 0.0, 0.0, 0.0, 0.0};
+}
+
+double GpuProfiler::getLastMs(const char* name, uint64_t &samples) {
+
+    for(const Timings &timing : timings) {
+        if(timing.name == name) {
+            samples = timing.samples;
+            return timing.lastMs;
+        }
+    }
+    samples = 0;
+    return 0.0;
+}
+
+void GpuProfiler::printStats(std::ostream &out) {
+
+    if(timings.empty()) {
+        return;
+    }
+    out << "GPU zone times (min/avg/p99 over the last " << WINDOW << " samples):\n";
+    for(const ZoneStats &stats : getStats()) {
+        out << "  " << stats.name << ": " << stats.minMs << " / " << stats.avgMs << " / " << stats.p99Ms << " ms, "
+            << stats.samples << " samples, " << (stats.samples > 0 ? stats.totalMs / stats.samples : 0.0) << " ms average\n";
+    }
+    if(traceTruncated) {
+        out << "  the trace stopped after " << MAX_TRACE_EVENTS << " zones\n";
+    }
+}
+
+void GpuProfiler::writeChromeTrace(const std::string &path) {
+
+    std::ofstream file(path);
+    if(!file) {
+        throw std::runtime_error("Could not open GPU trace file " + path + ".");
+    }
+
+    //one row per zone name, times in microseconds from the first timestamp collected
+    uint64_t origin = UINT64_MAX;
+    for(const TraceEvent &event : traceEvents) {
+        origin = std::min(origin, event.begin);
+    }
+    double usPerTick = msPerTick * 1000.0;
+    file.setf(std::ios::fixed);
+    file.precision(3);
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}";
+    for(uint32_t id = 0; id < timings.size(); id++) {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << id << ",\"args\":{\"name\":\"" << timings[id].name << "\"}}";
+    }
+    for(const TraceEvent &event : traceEvents) {
+        file << ",\n{\"name\":\"" << timings[event.nameId].name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.nameId
+             << ",\"ts\":" << ((event.begin - origin) & tickMask) * usPerTick << ",\"dur\":" << ((event.end - event.begin) & tickMask) * usPerTick;
+        if(event.arg != NO_ZONE) {
+            file << ",\"args\":{\"item\":" << event.arg << '}';
+        }
+        file << '}';
+    }
+    file << "\n]}\n";
+
+    if(!file) {
+        throw std::runtime_error("Could not write GPU trace file " + path + ".");
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef GPUPROFILER_HPP
+#define GPUPROFILER_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+//timestamp queries around named zones of a command buffer. Every command buffer slot (swapchain
+//image) owns a fixed range of the query pool, two queries per zone. Zones are reserved on the
+//recording thread before any thread writes them, so secondaries can time their own draws.
+//Results are read once the slot's fence has signaled, when the slot comes around again
+//framesInFlight frames later, so reading them never waits on the GPU.
+class GpuProfiler {
+    public:
+        //timestampPeriod and validBits come from the device limits and the queue family
+        GpuProfiler(VkDevice device, float timestampPeriod, uint32_t validBits, uint32_t slotCount, uint32_t maxZones, bool trace);
+        ~GpuProfiler();
+
+        GpuProfiler(const GpuProfiler&) = delete;
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+        //a zone the slot's command buffer doesn't write
+        static constexpr uint32_t NO_ZONE = UINT32_MAX;
+
+        //only once every slot was collected, the collected timings are kept
+        void setSlotCount(uint32_t slotCount);
+
+        //start recording the slot again, forgets its zones
+        void beginSlot(uint32_t slot);
+        //count consecutive zones called name, returns the first or NO_ZONE when the slot is full.
+        //arg tags each zone in the trace, e.g. the draw item it times
+        uint32_t reserveZones(uint32_t slot, const char* name, uint32_t count = 1, const uint32_t* args = nullptr);
+        //outside a render pass, before the slot's first zone
+        void recordReset(VkCommandBuffer commandBuffer, uint32_t slot);
+        void beginZone(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t zone);
+        void endZone(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t zone);
+
+        //the slot's command buffer was submitted
+        void submitted(uint32_t slot);
+        //only once the fence of the slot's last submission has signaled
+        void collect(uint32_t slot);
+        void collectAll();
+        //forget every sample collected so far, e.g. those of warmup frames
+        void clearStats();
+
+        struct ZoneStats {
+            std::string name;
+            uint64_t samples;
+            double lastMs;
+            double totalMs;
+            //over the last WINDOW samples
+            double minMs;
+            double avgMs;
+            double p99Ms;
+        };
+        std::vector<ZoneStats> getStats();
+        //zeroes when no zone called name was collected yet
+        ZoneStats getStats(const char* name);
+        //the newest time of zone name and its sample count, cheap enough for every frame
+        double getLastMs(const char* name, uint64_t &samples);
+
+        void printStats(std::ostream &out);
+        //every collected zone as a complete event of the Chrome trace format (chrome://tracing, Perfetto)
+        void writeChromeTrace(const std::string &path);
+
+    private:
+        static constexpr size_t WINDOW = 1024;
+        static constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+
+        void createQueryPool();
+        uint32_t internName(const char* name);
+        ZoneStats computeStats(uint32_t nameId);
+
+        VkDevice device;
+        VkQueryPool queryPool;
+        double msPerTick;
+        uint64_t tickMask;
+        uint32_t maxZones;
+        bool trace;
+
+        struct Zone {
+            uint32_t nameId;
+            uint32_t arg;
+        };
+        struct Slot {
+            std::vector<Zone> zones;
+            bool pending = false;
+        };
+        std::vector<Slot> slots;
+        std::vector<uint64_t> results;
+
+        //samples of one zone name, a ring of the last WINDOW durations
+        struct Timings {
+            std::string name;
+            std::vector<double> window;
+            size_t next = 0;
+            uint64_t samples = 0;
+            double lastMs = 0.0;
+            double totalMs = 0.0;
+        };
+        std::vector<Timings> timings;
+
+        struct TraceEvent {
+            uint32_t nameId;
+            uint32_t arg;
+            uint64_t begin;
+            uint64_t end;
+        };
+        std::vector<TraceEvent> traceEvents;
+        bool traceTruncated = false;
+};
+
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+
+//non cryptographic 64 bit hash of a byte range, for noticing that a cached file or blob changed.
+//Chain calls through seed to hash several ranges as one.
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0) {
+
+    //one multiply and rotate per 8 bytes, plenty to notice an edited file
+    const uint64_t prime1 = 0x9e3779b185ebca87ull;
+    const uint64_t prime2 = 0xc2b2ae3d27d4eb4full;
+    const char* p = static_cast<const char*>(data);
+
+    uint64_t h = seed ^ (size * prime1);
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, 8);
+        h ^= word * prime2;
+        h = ((h << 31) | (h >> 33)) * prime1;
+    }
+    for(; i < size; i++) {
+        h ^= static_cast<uint8_t>(p[i]) * prime1;
+        h = ((h << 11) | (h >> 53)) * prime2;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    return h;
+}
+
+
+#endif
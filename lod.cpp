@@ -0,0 +1,301 @@
+#include "lod.hpp"
+#include "flatHashMap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+
+
+//symmetric 4x4 matrix, the sum of squared distances to a set of planes
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+
+    void addPlane(double a, double b, double c, double d) {
+        a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+        b2 += b * b; bc += b * c; bd += b * d;
+        c2 += c * c; cd += c * d;
+        d2 += d * d;
+    }
+
+    void add(const Quadric &q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+    }
+
+    double evaluate(const glm::vec3 &p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+             + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+             + c2 * z * z + 2 * cd * z
+             + d2;
+    }
+};
+
+struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromVersion;
+    uint32_t toVersion;
+
+    bool operator>(const Collapse &other) const {
+        return cost > other.cost;
+    }
+};
+
+static uint64_t edgeKey(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+std::vector<uint32_t> simplifyMesh(Span<Vertex> vertices, Span<uint32_t> indices, size_t targetIndexCount, float &error) {
+
+    error = 0.f;
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size);
+
+    //the topology is that of one vertex per position, the triangles keep their own copies of it
+    //(wedges) so normal and colour seams survive
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const glm::vec3 &pa = vertices.data[a].pos;
+        const glm::vec3 &pb = vertices.data[b].pos;
+        return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : (pa.z != pb.z ? pa.z < pb.z : a < b));
+    });
+    std::vector<uint32_t> canonical(vertexCount);
+    for(uint32_t i = 0; i < vertexCount; i++) {
+        bool same = i > 0 && vertices.data[order[i]].pos == vertices.data[order[i - 1]].pos;
+        canonical[order[i]] = same ? canonical[order[i - 1]] : order[i];
+    }
+
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> wedges;
+    triangles.reserve(indices.size);
+    wedges.reserve(indices.size);
+    for(size_t i = 0; i + 3 <= indices.size; i += 3) {
+        uint32_t a = canonical[indices.data[i]];
+        uint32_t b = canonical[indices.data[i + 1]];
+        uint32_t c = canonical[indices.data[i + 2]];
+        if(a != b && b != c && c != a) {
+            triangles.insert(triangles.end(), {a, b, c});
+            wedges.insert(wedges.end(), indices.data + i, indices.data + i + 3);
+        }
+    }
+    uint32_t triangleCount = static_cast<uint32_t>(triangles.size() / 3);
+
+    //plane quadrics and the triangles around every vertex
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    FlatHashMap edgeUses(triangles.size());
+    std::vector<uint32_t> edgeCounts;
+    //the wedges of the edge's first triangle, lower position first, and whether another triangle disagrees
+    std::vector<uint64_t> edgeWedges;
+    std::vector<bool> edgeSeams;
+    auto sameAttributes = [&](uint32_t a, uint32_t b) {
+        return vertices.data[a].normal == vertices.data[b].normal && vertices.data[a].color == vertices.data[b].color;
+    };
+    for(uint32_t t = 0; t < triangleCount; t++) {
+        const uint32_t* tri = &triangles[3 * t];
+        glm::vec3 p0 = vertices.data[tri[0]].pos;
+        glm::vec3 normal = glm::cross(vertices.data[tri[1]].pos - p0, vertices.data[tri[2]].pos - p0);
+        float length = glm::length(normal);
+        if(length > 0.f) {
+            normal = normal / length;
+        }
+        double d = -glm::dot(normal, p0);
+        const uint32_t* wedge = &wedges[3 * t];
+        for(int c = 0; c < 3; c++) {
+            quadrics[tri[c]].addPlane(normal.x, normal.y, normal.z, d);
+            vertexTriangles[tri[c]].push_back(t);
+
+            int n = (c + 1) % 3;
+            uint64_t wedgePair = tri[c] < tri[n] ? (uint64_t(wedge[c]) << 32) | wedge[n] : (uint64_t(wedge[n]) << 32) | wedge[c];
+            bool inserted;
+            uint32_t edge = edgeUses.findOrInsert(edgeKey(tri[c], tri[n]), static_cast<uint32_t>(edgeCounts.size()), inserted);
+            if(inserted) {
+                edgeCounts.push_back(0);
+                edgeWedges.push_back(wedgePair);
+                edgeSeams.push_back(false);
+            }
+            else if(!sameAttributes(uint32_t(edgeWedges[edge] >> 32), uint32_t(wedgePair >> 32)) ||
+                    !sameAttributes(uint32_t(edgeWedges[edge]), uint32_t(wedgePair))) {
+                edgeSeams[edge] = true;
+            }
+            edgeCounts[edge]++;
+        }
+    }
+
+    //the ends of open and non-manifold edges keep their place so holes and borders keep their shape,
+    //those of seams so that every vertex that moves has a single wedge its triangles can take along
+    std::vector<bool> locked(vertexCount, false);
+    for(uint32_t t = 0; t < triangleCount; t++) {
+        const uint32_t* tri = &triangles[3 * t];
+        for(int c = 0; c < 3; c++) {
+            uint32_t edge = *edgeUses.find(edgeKey(tri[c], tri[(c + 1) % 3]));
+            if(edgeCounts[edge] != 2 || edgeSeams[edge]) {
+                locked[tri[c]] = true;
+                locked[tri[(c + 1) % 3]] = true;
+            }
+        }
+    }
+
+    std::vector<bool> triangleAlive(triangleCount, true);
+    std::vector<uint32_t> versions(vertexCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+    //the cheaper direction of collapsing the edge ab
+    auto pushEdge = [&](uint32_t a, uint32_t b) {
+        Quadric q = quadrics[a];
+        q.add(quadrics[b]);
+        double costIntoB = locked[a] ? INFINITY : q.evaluate(vertices.data[b].pos);
+        double costIntoA = locked[b] ? INFINITY : q.evaluate(vertices.data[a].pos);
+        if(std::isinf(costIntoA) && std::isinf(costIntoB)) {
+            return;
+        }
+        if(costIntoB <= costIntoA) {
+            heap.push({costIntoB, a, b, versions[a], versions[b]});
+        }
+        else {
+            heap.push({costIntoA, b, a, versions[b], versions[a]});
+        }
+    };
+
+    for(uint32_t t = 0; t < triangleCount; t++) {
+        const uint32_t* tri = &triangles[3 * t];
+        for(int c = 0; c < 3; c++) {
+            //every interior edge is seen from both of its triangles, push it once
+            if(tri[c] < tri[(c + 1) % 3]) {
+                pushEdge(tri[c], tri[(c + 1) % 3]);
+            }
+        }
+    }
+
+    uint32_t liveTriangles = triangleCount;
+    while(size_t(liveTriangles) * 3 > targetIndexCount && !heap.empty()) {
+        Collapse collapse = heap.top();
+        heap.pop();
+        uint32_t from = collapse.from;
+        uint32_t to = collapse.to;
+        if(collapse.fromVersion != versions[from] || collapse.toVersion != versions[to]) {
+            continue;
+        }
+
+        //the edge can be gone when a neighbour collapsed, and no triangle may turn over
+        bool adjacent = false;
+        bool flips = false;
+        const glm::vec3 &toPos = vertices.data[to].pos;
+        for(uint32_t t : vertexTriangles[from]) {
+            if(!triangleAlive[t]) {
+                continue;
+            }
+            uint32_t* tri = &triangles[3 * t];
+            if(tri[0] == to || tri[1] == to || tri[2] == to) {
+                adjacent = true;
+                continue;
+            }
+            glm::vec3 p[3];
+            glm::vec3 moved[3];
+            for(int c = 0; c < 3; c++) {
+                p[c] = vertices.data[tri[c]].pos;
+                moved[c] = tri[c] == from ? toPos : p[c];
+            }
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+            if(glm::dot(before, after) <= 0.f) {
+                flips = true;
+                break;
+            }
+        }
+        if(!adjacent || flips) {
+            continue;
+        }
+
+        //triangles on the edge disappear, the rest move over to the surviving vertex and take the
+        //wedge it has on the edge, the same on both sides as the edge is no seam
+        std::vector<uint32_t> &toTriangles = vertexTriangles[to];
+        uint32_t toWedge = to;
+        for(uint32_t t : vertexTriangles[from]) {
+            if(!triangleAlive[t]) {
+                continue;
+            }
+            const uint32_t* tri = &triangles[3 * t];
+            for(int c = 0; c < 3; c++) {
+                if(tri[c] == to) {
+                    toWedge = wedges[3 * t + c];
+                }
+            }
+        }
+        for(uint32_t t : vertexTriangles[from]) {
+            if(!triangleAlive[t]) {
+                continue;
+            }
+            uint32_t* tri = &triangles[3 * t];
+            if(tri[0] == to || tri[1] == to || tri[2] == to) {
+                triangleAlive[t] = false;
+                liveTriangles--;
+                continue;
+            }
+            for(int c = 0; c < 3; c++) {
+                if(tri[c] == from) {
+                    tri[c] = to;
+                    wedges[3 * t + c] = toWedge;
+                }
+            }
+            toTriangles.push_back(t);
+        }
+        vertexTriangles[from].clear();
+        toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(), [&](uint32_t t) {return !triangleAlive[t];}), toTriangles.end());
+
+        quadrics[to].add(quadrics[from]);
+        versions[from]++;
+        versions[to]++;
+        error = std::max(error, static_cast<float>(std::sqrt(std::max(collapse.cost, 0.0))));
+
+        //every edge around the surviving vertex has a new cost
+        for(uint32_t t : toTriangles) {
+            const uint32_t* tri = &triangles[3 * t];
+            for(int c = 0; c < 3; c++) {
+                if(tri[c] != to) {
+                    pushEdge(to, tri[c]);
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(size_t(liveTriangles) * 3);
+    for(uint32_t t = 0; t < triangleCount; t++) {
+        if(triangleAlive[t]) {
+            result.insert(result.end(), wedges.begin() + 3 * t, wedges.begin() + 3 * t + 3);
+        }
+    }
+    return result;
+}
+
+std::vector<LodLevel> buildLodChain(Span<Vertex> vertices, Span<uint32_t> indices, uint32_t levelCount) {
+
+    std::vector<LodLevel> levels;
+    levels.reserve(levelCount);
+    Span<uint32_t> previous = indices;
+    float previousError = 0.f;
+
+    for(uint32_t level = 0; level < levelCount; level++) {
+        //each level simplifies the one before, so the errors add up
+        LodLevel lod;
+        float error;
+        lod.indices = simplifyMesh(vertices, previous, previous.size / 6 * 3, error);
+        lod.error = previousError + error;
+        if(lod.indices.empty() || lod.indices.size() > previous.size / 10 * 9) {
+            break;
+        }
+        levels.push_back(std::move(lod));
+        previous = Span<uint32_t>(levels.back().indices);
+        previousError = levels.back().error;
+    }
+    return levels;
+}
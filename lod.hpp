@@ -0,0 +1,31 @@
+#ifndef LOD_HPP
+#define LOD_HPP
+
+#include "model.hpp"
+#include "vertex.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+struct LodLevel {
+    //indices into the mesh's own vertices, no new vertices are made
+    std::vector<uint32_t> indices;
+    //largest distance, in model units, the surface may have moved from the full mesh
+    float error;
+};
+
+//quadric error metric decimation by edge collapse. Vertices are only ever collapsed into one
+//another, so the result is an index list over the same vertices and can share their buffer.
+//Vertices on open or non-manifold edges and on normal or colour seams stay put, as do collapses
+//that would flip a triangle. Triangles keep their own copy of a vertex split along a seam.
+//Stops at targetIndexCount or when nothing can collapse; error receives the model space error.
+std::vector<uint32_t> simplifyMesh(Span<Vertex> vertices, Span<uint32_t> indices, size_t targetIndexCount, float &error);
+
+//levelCount coarser levels, each with about half the triangles of the one before.
+//Stops early once a level is less than 10% smaller than the one before.
+std::vector<LodLevel> buildLodChain(Span<Vertex> vertices, Span<uint32_t> indices, uint32_t levelCount);
+
+
+#endif
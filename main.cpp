@@ -1,25 +1,136 @@
 #include "window.hpp"
 #include "vulkanBase.hpp"
 #include "obj.hpp"
+#include "meshCache.hpp"
 #include "model.hpp"
+#include "settings.hpp"
+#include "frameTimer.hpp"
+#include "memoryUsage.hpp"
+#include "lod.hpp"
+#include "meshOptimize.hpp"
+#include "cpuProfiler.hpp"
+#include "syntheticMesh.hpp"
 
 #include <iostream>
 #include <algorithm>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <fstream>
 
 
 
-int main() {
+//a square field of copies spaced along x and back along -z, centred on the original
+static std::vector<glm::mat4> makeInstanceGrid(uint32_t count) {
 
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    float spacing = 3.f;
 
-    Window window = Window();
-    Scene scene = Scene();
+    std::vector<glm::mat4> transforms(count, glm::mat4(1.f));
+    for(uint32_t i = 0; i < count; i++) {
+        float x = (static_cast<float>(i % side) - 0.5f * (side - 1)) * spacing;
+        float z = -static_cast<float>(i / side) * spacing;
+        transforms[i][3] = glm::vec4(x, 0.f, z, 1.f);
+    }
+    return transforms;
+}
+
+//camera along settings.cameraPath at t from 0 to 1, over the field of makeInstanceGrid.
+//The field starts at the model's place, 10 units in front of the start position.
+static void moveCamera(Camera* cam, CameraPath path, float t, uint32_t instanceCount) {
+
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+    float halfExtent = 1.5f * side + 1.f;
+    glm::vec3 center(0.f, 1.f, -10.f - 1.5f * (side - 1));
+
+    if(path == CAMERA_PATH_ORBIT) {
+        //around the field, or inside it when it reaches past the far plane
+        float radius = std::min(halfExtent + 5.f, 60.f);
+        float angle = 2.f * 3.14159265f * t;
+        cam->lookAt(center + glm::vec3(radius * std::sin(angle), 0.5f * radius, radius * std::cos(angle)), center);
+    }
+    else if(path == CAMERA_PATH_FLY) {
+        //low over the field from its front edge to its back edge, looking ahead and down
+        float z = center.z + halfExtent + 5.f - t * (2.f * halfExtent + 10.f);
+        glm::vec3 pos(0.f, 5.f, z);
+        cam->lookAt(pos, pos + glm::vec3(0.f, -1.f, -4.f));
+    }
+}
+
+static void writeBenchJson(const Settings &settings, VulkanBase &base, Scene &scene, FrameTimer &frameTimer) {
+
+    std::ofstream file(settings.benchJsonPath);
+    if(!file) {
+        throw std::runtime_error("Could not open " + settings.benchJsonPath + ".");
+    }
+
+    uint64_t sceneTriangles = 0;
+    for(uint32_t model = 0; model < scene.getModelCount(); model++) {
+        sceneTriangles += uint64_t(scene.getIndexCount(model) / 3) * scene.getInstanceCount(model);
+    }
+    const char* cull = settings.gpuDriven ? "gpu" : settings.cullBvh ? "bvh" : settings.cpuCull ? "cpu" : "none";
+    const char* cameraPaths[] = {"static", "orbit", "fly"};
+    const char* vertexLayouts[] = {"full", "half", "snorm16"};
+    GpuProfiler::ZoneStats gpu = base.getGpuFrameStats();
+    MemoryStats memory = base.getMemoryStats();
+    const double mb = 1024.0 * 1024.0;
+
+    file << "{\"device\": \"" << base.getDeviceName() << "\", "
+         << "\"config\": {\"model\": \"" << (settings.syntheticTriangles > 0 ? "synthetic" : settings.objPath) << "\", "
+         << "\"meshTriangles\": " << scene.getIndexCount(0) / 3 << ", \"instances\": " << settings.instanceCount << ", "
+         << "\"sceneTriangles\": " << sceneTriangles << ", \"instancing\": " << (settings.instancing ? "true" : "false") << ", "
+         << "\"cull\": \"" << cull << "\", \"rerecord\": " << (settings.rerecord ? "true" : "false") << ", "
+         << "\"framesInFlight\": " << settings.framesInFlight << ", \"cameraPath\": \"" << cameraPaths[settings.cameraPath] << "\", "
+         << "\"lods\": " << settings.lodCount << ", \"vertexLayout\": \"" << vertexLayouts[settings.vertexLayout] << "\", "
+         << "\"frames\": " << settings.frameCount << ", \"warmup\": " << settings.warmupFrames << ", "
+         << "\"targetGpuMs\": " << settings.targetGpuMs << ", \"simulatedGpuMs\": " << settings.simulatedGpuMs << "}, "
+         << "\"frameMs\": {\"avg\": " << frameTimer.getAverageFrameMs() << ", \"p50\": " << frameTimer.getPercentileFrameMs(50.0)
+         << ", \"p95\": " << frameTimer.getPercentileFrameMs(95.0) << ", \"p99\": " << frameTimer.getPercentileFrameMs(99.0)
+         << ", \"max\": " << frameTimer.getMaxFrameMs() << "}, "
+         << "\"gpuMs\": {\"avg\": " << (gpu.samples > 0 ? gpu.totalMs / gpu.samples : 0.0) << ", \"min\": " << gpu.minMs
+         << ", \"p99\": " << gpu.p99Ms << ", \"samples\": " << gpu.samples << "}, "
+         << "\"recordMs\": " << base.getRecordTimeMs() << ", \"cullMs\": " << base.getCullTimeMs() << ", "
+         << "\"renderScale\": " << base.getAverageRenderScale() << ", "
+         << "\"draws\": " << base.getDrawCount() << ", \"trianglesDrawn\": " << (settings.gpuDriven ? 0 : base.getTriangleCount()) << ", "
+         << "\"memory\": {\"peakRssMB\": " << getPeakRssBytes() / mb << ", \"deviceReservedMB\": " << memory.reservedBytes / mb
+         << ", \"deviceAllocatedMB\": " << memory.allocatedBytes / mb << "}}\n";
+
+    if(!file) {
+        throw std::runtime_error("Could not write " + settings.benchJsonPath + ".");
+    }
+}
 
-    std::vector<Vertex> objVertices;
-    std::vector<uint32_t> objIndices;
-    obj(objVertices, objIndices);
-       
-    Model objModel = Model(objVertices, objIndices);
-    scene.pushbackModel(&objModel);
+//stats and trace of the CPU zones, once every other thread is done
+static void finishCpuProfile(const Settings &settings) {
+
+    if(!settings.cpuProfile) {
+        return;
+    }
+    CpuProfiler::printStats(std::cout);
+    if(!settings.cpuTracePath.empty()) {
+        try {
+            CpuProfiler::writeChromeTrace(settings.cpuTracePath);
+            std::cout << "CPU trace written to " << settings.cpuTracePath << ".\n";
+        } catch(const std::exception &e) {
+            std::cout << e.what() << '\n';
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+
+    Settings settings = parseSettings(argc, argv);
+    if(settings.cpuProfile) {
+        CpuProfiler::enable();
+        CpuProfiler::setThreadName("main");
+    }
+
+    //headless runs never touch SDL
+    std::unique_ptr<Window> window;
+    if(!settings.headless) {
+        window.reset(new Window());
+    }
+    Scene scene = Scene();
 
     std::vector<Vertex> planeVertices = {
         {{-10.f, 0.f, 0.f}, {0.0f, 1.0f, 0.0f}, {0.f, 1.f, 0.f}},
@@ -32,33 +143,209 @@ int main() {
     std::vector<uint32_t> planeIndices = {
         2, 0, 3, 3, 0, 1
     };
-    Model plane = Model(planeVertices, planeIndices);
-    scene.pushbackModel(&plane);
+    if(settings.meshOptimize) {
+        optimizeMesh(planeVertices, planeIndices);
+    }
+
+    //the loaded model and its source buffers only live until they are copied into the scene
+    {
+        std::vector<Vertex> objVertices;
+        std::vector<uint32_t> objIndices;
+        ObjOptions objOptions;
+        objOptions.dumpPath = settings.objDumpPath;
+        std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+        const char* loadKind = "parsed";
+        std::string modelName = settings.objPath;
+        CpuZone loadZone("load model");
+
+        //a dump needs the parse, so it bypasses the cache
+        std::unique_ptr<MeshCache> meshCache;
+        //a warm cache was optimized when it was written
+        bool optimized = false;
+        MeshOptimizeReport optimizeReport;
+        if(settings.syntheticTriangles > 0) {
+            loadKind = "generated";
+            modelName = "synthetic sphere";
+        }
+        else if(settings.meshCache && settings.objDumpPath.empty()) {
+            try {
+                bool cacheHit;
+                meshCache = loadObjCached(settings.objPath, objOptions, settings.meshOptimize, cacheHit, optimizeReport);
+                loadKind = cacheHit ? "warm, from mesh cache" : "cold, mesh cache written";
+                optimized = settings.meshOptimize && !cacheHit;
+            } catch(const std::exception &e) {
+                std::cout << "Mesh cache unavailable (" << e.what() << "), parsing " << settings.objPath << '\n';
+            }
+        }
+        if(!meshCache) {
+            if(settings.syntheticTriangles > 0) {
+                makeSphereMesh(settings.syntheticTriangles, objVertices, objIndices);
+            }
+            else {
+                obj(settings.objPath, objVertices, objIndices, objOptions);
+            }
+            if(settings.meshOptimize) {
+                optimizeReport = optimizeMesh(objVertices, objIndices);
+                optimized = true;
+            }
+        }
+
+        //the mapped mesh file is read in place
+        Span<Vertex> modelVertices = meshCache ? Span<Vertex>(meshCache->getVertices(), meshCache->getVertexCount()) : Span<Vertex>(objVertices);
+        Span<uint32_t> modelIndices = meshCache ? Span<uint32_t>(meshCache->getIndices(), meshCache->getIndexCount()) : Span<uint32_t>(objIndices);
+        std::cout << "Loaded " << modelName << " (" << loadKind << "): " << modelVertices.size << " vertices, " << modelIndices.size / 3 << " triangles in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count() << " ms\n";
+        loadZone.end();
+        if(optimized) {
+            std::cout << "Mesh optimized in " << optimizeReport.ms << " ms: ACMR " << optimizeReport.before.acmr << " -> " << optimizeReport.after.acmr
+                      << ", ATVR " << optimizeReport.before.atvr << " -> " << optimizeReport.after.atvr << '\n';
+        }
+        else {
+            VertexCacheStats stats = analyzeVertexCache(modelIndices, modelVertices.size);
+            std::cout << "Mesh: ACMR " << stats.acmr << ", ATVR " << stats.atvr << '\n';
+        }
+
+        //coarser levels share the model's vertices, only their indices are added
+        std::vector<LodLevel> lods;
+        size_t lodIndexCount = 0;
+        if(settings.lodCount > 0) {
+            CPU_ZONE("build LODs");
+            std::chrono::steady_clock::time_point lodStart = std::chrono::steady_clock::now();
+            lods = buildLodChain(modelVertices, modelIndices, settings.lodCount);
+            //the levels share the optimized vertex order, their triangles are reordered the same way
+            if(settings.meshOptimize) {
+                for(LodLevel &lod : lods) {
+                    optimizeVertexCache(lod.indices.data(), lod.indices.size(), modelVertices.size);
+                    optimizeOverdraw(lod.indices.data(), lod.indices.size(), modelVertices);
+                }
+            }
+            std::cout << "LODs: " << modelIndices.size / 3;
+            for(const LodLevel &lod : lods) {
+                std::cout << " -> " << lod.indices.size() / 3;
+                lodIndexCount += lod.indices.size();
+            }
+            std::cout << " triangles in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lodStart).count() << " ms\n";
+        }
+
+        std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+        CPU_ZONE("build scene");
+        scene.reserve(modelVertices.size + planeVertices.size(), modelIndices.size + lodIndexCount + planeIndices.size());
+        //the mesh file stores the bounds, so the scene doesn't scan the mapped vertices for them
+        Bounds cachedBounds;
+        const Bounds* pModelBounds = nullptr;
+        if(meshCache && meshCache->getMeshCount() == 1) {
+            const MeshRange &range = meshCache->getMeshes()[0];
+            cachedBounds = {range.boundsMin, range.boundsMax, 0.5f * (range.boundsMin + range.boundsMax), range.radius};
+            pModelBounds = &cachedBounds;
+        }
+        scene.addMesh(modelVertices, modelIndices, pModelBounds);
+        for(const LodLevel &lod : lods) {
+            scene.addLod(lod.indices, lod.error);
+        }
+        if(settings.instanceCount > 1) {
+            scene.setInstances(makeInstanceGrid(settings.instanceCount));
+        }
+        scene.addMesh(planeVertices, planeIndices);
+        std::cout << "Scene: " << scene.getVerts().size() << " vertices, " << scene.getInds().size() << " indices built in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count() << " ms, peak RSS "
+                  << getPeakRssBytes() / (1024.0 * 1024.0) << " MB\n";
+    }
 
      
-    VulkanBase base = VulkanBase(&window, &scene, true);
+    VulkanBase base = VulkanBase(window.get(), &scene, true, settings);
     base.createInstance();
     base.createSurface();
     base.createLogicalDevice();
+    base.createPipelineCache();
     base.createSwapchain();
     base.createImageViews();
     base.createDepthBuffer();
+    base.createSceneTarget();
     base.createUniformBuffers();
     base.createDescriptorSet();
     base.createRenderPass();
+    base.createStagingRing();
     base.createVertexBuffer();
     base.createIndexBuffer();
+    base.createInstanceBuffer();
+    base.createCullingResources();
+    base.createSceneBvh();
+    base.finishUploads();
     base.createGraphicsPipeline();
+    base.startShaderHotReload();
     base.createFramebuffers();
+    base.createGpuProfiler();
     base.createCommandBuffers();
     base.createSyncObjects();
 
 
 
 
+    if(settings.headless) {
+        //warmup frames see the path's first camera position
+        if(settings.cameraPath != CAMERA_PATH_STATIC) {
+            moveCamera(base.cam, settings.cameraPath, 0.f, settings.instanceCount);
+            base.updateMVP();
+        }
+        for(uint32_t i = 0; i < settings.warmupFrames; i++) {
+            base.draw();
+        }
+        if(settings.warmupFrames > 0) {
+            base.clearGpuStats();
+        }
+
+        FrameTimer frameTimer(1.0, true, !settings.benchJsonPath.empty());
+        for(uint32_t i = 0; i < settings.frameCount; i++) {
+            CPU_ZONE("frame");
+            if(settings.cameraPath != CAMERA_PATH_STATIC) {
+                moveCamera(base.cam, settings.cameraPath, static_cast<float>(i) / settings.frameCount, settings.instanceCount);
+                base.updateMVP();
+            }
+            //alternate between the full and two thirds of the size
+            if(settings.resizeEvery > 0 && i > 0 && i % settings.resizeEvery == 0) {
+                bool shrink = (i / settings.resizeEvery) % 2 == 1;
+                base.resize(shrink ? SCREEN_WIDTH * 2 / 3 : SCREEN_WIDTH, shrink ? SCREEN_HEIGHT * 2 / 3 : SCREEN_HEIGHT);
+            }
+            base.draw();
+            frameTimer.tick();
+        }
+        base.waitIdle();
+
+        std::cout << "headless: " << frameTimer.getFrameCount() << " frames, "
+                  << frameTimer.getAverageFrameMs() << " ms/frame (" << 1000.0 / frameTimer.getAverageFrameMs() << " fps), "
+                  << "gpu " << base.getAverageGpuTimeMs() << " ms/frame, "
+                  << base.getDrawCount() << " draws/frame recorded in " << base.getRecordTimeMs() << " ms"
+                  << (settings.rerecord ? " every frame" : " once");
+        if(!settings.gpuDriven) {
+            std::cout << ", " << base.getTriangleCount() << " triangles/frame";
+        }
+        if(settings.cpuCull) {
+            std::cout << ", cpu cull " << base.getCullTimeMs() << " ms" << (settings.cullBvh ? " through the BVH" : "");
+        }
+        if(settings.resizeEvery > 0) {
+            std::cout << ", " << base.getSwapchainRecreateCount() << " resizes";
+        }
+        if(settings.targetGpuMs > 0.f) {
+            std::cout << ", render scale " << base.getAverageRenderScale() << " average, " << base.getRenderScale() << " last";
+        }
+        std::cout << '\n';
+        if(!settings.benchJsonPath.empty()) {
+            writeBenchJson(settings, base, scene, frameTimer);
+        }
+        base.cleanUp();
+        finishCpuProfile(settings);
+        return 0;
+    }
+
+    FrameTimer frameTimer;
+
     SDL_Event event;
     bool run = true;
+    //a left click picks, a left drag turns the camera
+    bool dragged = false;
     while(run) {
+        CPU_ZONE("frame");
+        CpuZone eventsZone("events");
         while( SDL_PollEvent( &event ) != 0 ){
             switch(event.type) {
                 case SDL_QUIT: {
@@ -66,9 +353,20 @@ int main() {
                                    break;
                                }
 
+                case SDL_WINDOWEVENT: {
+                                          if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                                              //in pixels, which differ from window coordinates on high DPI displays
+                                              int width, height;
+                                              SDL_Vulkan_GetDrawableSize(window->getWindow(), &width, &height);
+                                              base.resize(width, height);
+                                          }
+                                          break;
+                                      }
+
                 case SDL_MOUSEMOTION:{
                                          unsigned int button = SDL_GetMouseState(NULL, NULL);
                                          if (button & SDL_BUTTON(SDL_BUTTON_LEFT)) {
+                                             dragged = true;
                                              base.cam->yaw(event.motion.xrel);
                                              base.cam->pitch(-event.motion.yrel);
                                              base.updateMVP();
@@ -79,6 +377,31 @@ int main() {
                                          }
                                          break;
                                      }
+                case SDL_MOUSEBUTTONDOWN: {
+                                              if (event.button.button == SDL_BUTTON_LEFT) {
+                                                  dragged = false;
+                                              }
+                                              break;
+                                          }
+                case SDL_MOUSEBUTTONUP: {
+                                            if (event.button.button == SDL_BUTTON_LEFT && !dragged) {
+                                                uint32_t model, instance;
+                                                float distance;
+                                                //window coordinates to the drawable's pixels, they differ on high DPI displays
+                                                int windowWidth, windowHeight, drawableWidth, drawableHeight;
+                                                SDL_GetWindowSize(window->getWindow(), &windowWidth, &windowHeight);
+                                                SDL_Vulkan_GetDrawableSize(window->getWindow(), &drawableWidth, &drawableHeight);
+                                                int x = windowWidth > 0 ? event.button.x * drawableWidth / windowWidth : event.button.x;
+                                                int y = windowHeight > 0 ? event.button.y * drawableHeight / windowHeight : event.button.y;
+                                                if (base.pick(x, y, model, instance, distance)) {
+                                                    std::cout << "Picked model " << model << " instance " << instance << " at distance " << distance << '\n';
+                                                }
+                                                else {
+                                                    std::cout << "Picked nothing\n";
+                                                }
+                                            }
+                                            break;
+                                        }
                 case SDL_KEYDOWN: {
                                       switch( event.key.keysym.sym )
                                       {
@@ -105,9 +428,17 @@ int main() {
                                   }
             }
         }
+        eventsZone.end();
+        //nothing is drawn while minimized, sleep until the window changes
+        if(SDL_GetWindowFlags(window->getWindow()) & SDL_WINDOW_MINIMIZED) {
+            SDL_WaitEvent(nullptr);
+            continue;
+        }
         base.draw();
+        frameTimer.tick();
     }
     base.cleanUp();
+    finishCpuProfile(settings);
     SDL_Quit();
 }
 
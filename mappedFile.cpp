@@ -0,0 +1,64 @@
+#include "mappedFile.hpp"
+
+#include <stdexcept>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+MappedFile::MappedFile(const std::string &path) {
+
+    fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw std::runtime_error("Could not open " + path + '.');
+    }
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not stat " + path + '.');
+    }
+    size = static_cast<size_t>(fileStat.st_size);
+
+    //mmap rejects zero length mappings, an empty file just has no data
+    if(size == 0) {
+        return;
+    }
+
+    pData = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(pData == MAP_FAILED) {
+        pData = nullptr;
+        close(fd);
+        throw std::runtime_error("Could not map " + path + '.');
+    }
+    //advice values are not flags and can't be combined. Ignored advice only costs read ahead.
+    if(madvise(pData, size, MADV_SEQUENTIAL) != 0) {
+        std::cout << "madvise(MADV_SEQUENTIAL) failed for " << path << ": " << std::strerror(errno) << '\n';
+    }
+    if(madvise(pData, size, MADV_WILLNEED) != 0) {
+        std::cout << "madvise(MADV_WILLNEED) failed for " << path << ": " << std::strerror(errno) << '\n';
+    }
+}
+
+MappedFile::~MappedFile() {
+
+    if(pData) {
+        munmap(pData, size);
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+}
+
+const char* MappedFile::getData() {
+    return static_cast<const char*>(pData);
+}
+
+size_t MappedFile::getSize() {
+    return size;
+}
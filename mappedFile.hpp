@@ -0,0 +1,27 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <string>
+#include <cstddef>
+
+
+//read only memory mapping of a whole file
+class MappedFile {
+    public:
+        MappedFile(const std::string &path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* getData();
+        size_t getSize();
+
+    private:
+        int fd = -1;
+        void* pData = nullptr;
+        size_t size = 0;
+};
+
+
+#endif
@@ -0,0 +1,382 @@
+#include "memoryAllocator.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <climits>
+
+
+#define MIN_NODE_SIZE 256
+
+
+BuddyBlock::BuddyBlock(VkDeviceSize size, VkDeviceSize minNodeSize) : size(size) {
+
+    levelCount = 1;
+    while((size >> levelCount) >= minNodeSize) {
+        levelCount++;
+    }
+    freeLists.resize(levelCount);
+    freeLists[0].insert(0);
+}
+
+VkDeviceSize BuddyBlock::getNodeSize(uint32_t level) {
+    return size >> level;
+}
+
+bool BuddyBlock::allocate(VkDeviceSize requestSize, VkDeviceSize alignment, VkDeviceSize &offset, uint32_t &level) {
+
+    //nodes are aligned to their own size, so a node at least as large as the alignment satisfies it
+    VkDeviceSize needed = std::max(requestSize, alignment);
+    if(needed > size) {
+        return false;
+    }
+
+    uint32_t target = 0;
+    while(target + 1 < levelCount && getNodeSize(target + 1) >= needed) {
+        target++;
+    }
+
+    //smallest free node that fits, split down to the target size
+    int found = -1;
+    for(int l = static_cast<int>(target); l >= 0; l--) {
+        if(!freeLists[l].empty()) {
+            found = l;
+            break;
+        }
+    }
+    if(found < 0) {
+        return false;
+    }
+
+    uint32_t l = static_cast<uint32_t>(found);
+    offset = *freeLists[l].begin();
+    freeLists[l].erase(freeLists[l].begin());
+
+    while(l < target) {
+        l++;
+        freeLists[l].insert(offset + getNodeSize(l));
+    }
+
+    level = target;
+    return true;
+}
+
+void BuddyBlock::free(VkDeviceSize offset, uint32_t level) {
+
+    while(level > 0) {
+        VkDeviceSize buddy = offset ^ getNodeSize(level);
+        std::set<VkDeviceSize>::iterator it = freeLists[level].find(buddy);
+        if(it == freeLists[level].end()) {
+            break;
+        }
+        freeLists[level].erase(it);
+        offset = std::min(offset, buddy);
+        level--;
+    }
+    freeLists[level].insert(offset);
+}
+
+MemoryAllocator::MemoryAllocator(const VkPhysicalDeviceMemoryProperties &memProps, DeviceMemoryBackend* backend, VkDeviceSize preferredBlockSize) : memProps(memProps), backend(backend) {
+
+    pools.resize(memProps.memoryTypeCount * RESOURCE_KIND_COUNT);
+
+    for(uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
+        //blocks are a power of two and no more than an eighth of their heap
+        VkDeviceSize heapSize = memProps.memoryHeaps[memProps.memoryTypes[i].heapIndex].size;
+        VkDeviceSize blockSize = MIN_NODE_SIZE;
+        while(blockSize * 2 <= preferredBlockSize && blockSize * 2 <= heapSize / 8) {
+            blockSize *= 2;
+        }
+
+        for(uint32_t k = 0; k < RESOURCE_KIND_COUNT; k++) {
+            Pool &pool = pools[i * RESOURCE_KIND_COUNT + k];
+            pool.memoryTypeIndex = i;
+            pool.blockSize = blockSize;
+        }
+    }
+}
+
+MemoryAllocator::~MemoryAllocator() {
+
+    for(Pool &pool : pools) {
+        for(uint32_t i = 0; i < pool.blocks.size(); i++) {
+            if(pool.blocks[i]) {
+                releaseBlock(pool, i);
+            }
+        }
+    }
+}
+
+bool MemoryAllocator::isHostVisible(uint32_t memoryTypeIndex) {
+    return memProps.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+
+    uint32_t best = memProps.memoryTypeCount;
+    int bestScore = INT_MIN;
+
+    for(uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
+        VkMemoryPropertyFlags flags = memProps.memoryTypes[i].propertyFlags;
+        if(!(typeBits & (1u << i)) || (flags & required) != required) {
+            continue;
+        }
+        //most preferred flags first, then fewest flags nobody asked for
+        int score = 64 * __builtin_popcount(flags & preferred) - __builtin_popcount(flags & ~(required | preferred));
+        if(score > bestScore) {
+            best = i;
+            bestScore = score;
+        }
+    }
+
+    if(best == memProps.memoryTypeCount) {
+        throw std::runtime_error("Could not find suitable memory type.");
+    }
+    return best;
+}
+
+uint32_t MemoryAllocator::createBlock(Pool &pool) {
+
+    std::unique_ptr<Block> block(new Block(pool.blockSize, MIN_NODE_SIZE));
+
+    if(backend->allocate(pool.memoryTypeIndex, pool.blockSize, &block->memory) != VK_SUCCESS) {
+        throw std::runtime_error("Could not allocate device memory block.");
+    }
+    totalDeviceAllocations++;
+
+    block->pMapped = nullptr;
+    if(isHostVisible(pool.memoryTypeIndex) && backend->map(block->memory, &block->pMapped) != VK_SUCCESS) {
+        throw std::runtime_error("Could not map device memory block.");
+    }
+
+    for(uint32_t i = 0; i < pool.blocks.size(); i++) {
+        if(!pool.blocks[i]) {
+            pool.blocks[i] = std::move(block);
+            return i;
+        }
+    }
+    pool.blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(pool.blocks.size() - 1);
+}
+
+void MemoryAllocator::releaseBlock(Pool &pool, uint32_t blockIndex) {
+
+    Block* block = pool.blocks[blockIndex].get();
+    if(block->pMapped) {
+        backend->unmap(block->memory);
+    }
+    backend->free(block->memory);
+    pool.blocks[blockIndex].reset();
+}
+
+uint32_t MemoryAllocator::countBlocks(Pool &pool) {
+
+    uint32_t count = 0;
+    for(std::unique_ptr<Block> &block : pool.blocks) {
+        if(block) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool MemoryAllocator::allocateFromBlock(Pool &pool, uint32_t blockIndex, VkDeviceSize size, VkDeviceSize alignment, Allocation &allocation) {
+
+    Block* block = pool.blocks[blockIndex].get();
+
+    VkDeviceSize offset;
+    uint32_t level;
+    if(!block->buddy.allocate(size, alignment, offset, level)) {
+        return false;
+    }
+
+    block->live[offset] = {level, size, alignment};
+    block->allocatedBytes += block->buddy.getNodeSize(level);
+    pool.requestedBytes += size;
+
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.alignment = alignment;
+    allocation.pMapped = block->pMapped ? static_cast<char*>(block->pMapped) + offset : nullptr;
+    allocation.memoryTypeIndex = pool.memoryTypeIndex;
+    allocation.blockIndex = blockIndex;
+    allocation.level = level;
+    return true;
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements &memReqs, ResourceKind kind, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t memoryTypeIndex = findMemoryType(memReqs.memoryTypeBits, required, preferred);
+    uint32_t poolIndex = memoryTypeIndex * RESOURCE_KIND_COUNT + kind;
+    Pool &pool = pools[poolIndex];
+
+    Allocation allocation;
+    allocation.poolIndex = poolIndex;
+
+    //large resources would waste most of a block, give them their own memory
+    if(memReqs.size > pool.blockSize / 2) {
+        if(backend->allocate(memoryTypeIndex, memReqs.size, &allocation.memory) != VK_SUCCESS) {
+            throw std::runtime_error("Could not allocate dedicated device memory.");
+        }
+        totalDeviceAllocations++;
+        if(isHostVisible(memoryTypeIndex) && backend->map(allocation.memory, &allocation.pMapped) != VK_SUCCESS) {
+            throw std::runtime_error("Could not map dedicated device memory.");
+        }
+        allocation.size = memReqs.size;
+        allocation.alignment = memReqs.alignment;
+        allocation.memoryTypeIndex = memoryTypeIndex;
+        allocation.blockIndex = ALLOCATION_DEDICATED;
+        pool.dedicatedCount++;
+        pool.dedicatedBytes += memReqs.size;
+        pool.requestedBytes += memReqs.size;
+        return allocation;
+    }
+
+    for(uint32_t i = 0; i < pool.blocks.size(); i++) {
+        if(pool.blocks[i] && allocateFromBlock(pool, i, memReqs.size, memReqs.alignment, allocation)) {
+            return allocation;
+        }
+    }
+
+    uint32_t blockIndex = createBlock(pool);
+    if(!allocateFromBlock(pool, blockIndex, memReqs.size, memReqs.alignment, allocation)) {
+        throw std::runtime_error("Could not sub-allocate from a new memory block.");
+    }
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation &allocation) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    Pool &pool = pools[allocation.poolIndex];
+    pool.requestedBytes -= allocation.size;
+
+    if(allocation.blockIndex == ALLOCATION_DEDICATED) {
+        if(allocation.pMapped) {
+            backend->unmap(allocation.memory);
+        }
+        backend->free(allocation.memory);
+        pool.dedicatedCount--;
+        pool.dedicatedBytes -= allocation.size;
+        allocation = Allocation();
+        return;
+    }
+
+    Block* block = pool.blocks[allocation.blockIndex].get();
+    block->buddy.free(allocation.offset, allocation.level);
+    block->live.erase(allocation.offset);
+    block->allocatedBytes -= block->buddy.getNodeSize(allocation.level);
+
+    //hand empty blocks back to the driver but keep one around to avoid thrashing
+    if(block->live.empty() && countBlocks(pool) > 1) {
+        releaseBlock(pool, allocation.blockIndex);
+    }
+    allocation = Allocation();
+}
+
+std::vector<Allocation> MemoryAllocator::getLiveAllocations() {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<Allocation> allocations;
+    for(uint32_t p = 0; p < pools.size(); p++) {
+        Pool &pool = pools[p];
+        for(uint32_t b = 0; b < pool.blocks.size(); b++) {
+            Block* block = pool.blocks[b].get();
+            if(!block) {
+                continue;
+            }
+            for(const std::pair<const VkDeviceSize, Block::LiveRange> &range : block->live) {
+                Allocation allocation;
+                allocation.memory = block->memory;
+                allocation.offset = range.first;
+                allocation.size = range.second.size;
+                allocation.alignment = range.second.alignment;
+                allocation.pMapped = block->pMapped ? static_cast<char*>(block->pMapped) + range.first : nullptr;
+                allocation.memoryTypeIndex = pool.memoryTypeIndex;
+                allocation.poolIndex = p;
+                allocation.blockIndex = b;
+                allocation.level = range.second.level;
+                allocations.push_back(allocation);
+            }
+        }
+    }
+    return allocations;
+}
+
+bool MemoryAllocator::allocateMoveDestination(const Allocation &source, Allocation &destination) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(source.memory == VK_NULL_HANDLE || source.blockIndex == ALLOCATION_DEDICATED) {
+        return false;
+    }
+
+    Pool &pool = pools[source.poolIndex];
+    for(uint32_t i = 0; i < source.blockIndex; i++) {
+        if(pool.blocks[i] && allocateFromBlock(pool, i, source.size, source.alignment, destination)) {
+            destination.poolIndex = source.poolIndex;
+            return true;
+        }
+    }
+    return false;
+}
+
+MemoryStats MemoryAllocator::getStats() {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    MemoryStats stats;
+    stats.types.resize(memProps.memoryTypeCount);
+    stats.totalDeviceAllocations = totalDeviceAllocations;
+
+    for(Pool &pool : pools) {
+        MemoryTypeStats &type = stats.types[pool.memoryTypeIndex];
+        for(std::unique_ptr<Block> &block : pool.blocks) {
+            if(block) {
+                type.blockCount++;
+                type.allocationCount += static_cast<uint32_t>(block->live.size());
+                type.reservedBytes += pool.blockSize;
+                type.allocatedBytes += block->allocatedBytes;
+            }
+        }
+        type.dedicatedCount += pool.dedicatedCount;
+        type.allocationCount += pool.dedicatedCount;
+        type.reservedBytes += pool.dedicatedBytes;
+        type.allocatedBytes += pool.dedicatedBytes;
+        type.requestedBytes += pool.requestedBytes;
+    }
+
+    for(MemoryTypeStats &type : stats.types) {
+        stats.deviceAllocationCount += type.blockCount + type.dedicatedCount;
+        stats.reservedBytes += type.reservedBytes;
+        stats.allocatedBytes += type.allocatedBytes;
+        stats.requestedBytes += type.requestedBytes;
+    }
+    return stats;
+}
+
+void MemoryAllocator::printStats(std::ostream &out) {
+
+    MemoryStats stats = getStats();
+    const double mb = 1024.0 * 1024.0;
+
+    out << "Device memory: " << stats.deviceAllocationCount << " live device allocations (" << stats.totalDeviceAllocations << " total), "
+        << stats.reservedBytes / mb << " MB reserved, " << stats.allocatedBytes / mb << " MB allocated, " << stats.requestedBytes / mb << " MB requested\n";
+
+    for(uint32_t i = 0; i < stats.types.size(); i++) {
+        MemoryTypeStats &type = stats.types[i];
+        if(type.blockCount == 0 && type.dedicatedCount == 0) {
+            continue;
+        }
+        out << "\ttype " << i << ": " << type.allocationCount << " allocations in " << type.blockCount << " blocks + "
+            << type.dedicatedCount << " dedicated, " << type.reservedBytes / mb << " MB reserved, " << type.requestedBytes / mb << " MB requested\n";
+    }
+}
@@ -0,0 +1,157 @@
+#ifndef MEMORYALLOCATOR_HPP
+#define MEMORYALLOCATOR_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+
+//the device memory calls the allocator makes. Swapping this out lets the allocator
+//run against a mock memory properties table without a GPU, see tests/allocatorTest.cpp.
+//The Vulkan implementation is in vulkanMemoryBackend.hpp.
+class DeviceMemoryBackend {
+    public:
+        virtual ~DeviceMemoryBackend() {}
+        virtual VkResult allocate(uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceMemory* pMemory) = 0;
+        virtual void free(VkDeviceMemory memory) = 0;
+        virtual VkResult map(VkDeviceMemory memory, void** ppData) = 0;
+        virtual void unmap(VkDeviceMemory memory) = 0;
+};
+
+
+//buffers and optimally tiled images are kept in separate blocks so
+//bufferImageGranularity never has to be considered between neighbours
+enum ResourceKind {
+    RESOURCE_KIND_BUFFER = 0,
+    RESOURCE_KIND_IMAGE = 1,
+    RESOURCE_KIND_COUNT = 2
+};
+
+#define ALLOCATION_DEDICATED 0xffffffffu
+
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    //from the memory requirements, a moved allocation keeps it
+    VkDeviceSize alignment = 1;
+    //persistently mapped pointer to offset, null for memory that is not host visible
+    void* pMapped = nullptr;
+    uint32_t memoryTypeIndex = 0;
+
+    uint32_t poolIndex = 0;
+    uint32_t blockIndex = ALLOCATION_DEDICATED;
+    uint32_t level = 0;
+};
+
+struct MemoryTypeStats {
+    uint32_t blockCount = 0;
+    uint32_t dedicatedCount = 0;
+    uint32_t allocationCount = 0;
+    //device memory obtained from the driver
+    VkDeviceSize reservedBytes = 0;
+    //bytes handed out, after rounding to the buddy size
+    VkDeviceSize allocatedBytes = 0;
+    //bytes actually requested
+    VkDeviceSize requestedBytes = 0;
+};
+
+struct MemoryStats {
+    std::vector<MemoryTypeStats> types;
+    uint32_t deviceAllocationCount = 0;
+    uint64_t totalDeviceAllocations = 0;
+    VkDeviceSize reservedBytes = 0;
+    VkDeviceSize allocatedBytes = 0;
+    VkDeviceSize requestedBytes = 0;
+};
+
+
+//binary buddy allocator over one power of two sized range.
+//level 0 is the whole range, every level below halves the node size.
+class BuddyBlock {
+    public:
+        BuddyBlock(VkDeviceSize size, VkDeviceSize minNodeSize);
+
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset, uint32_t &level);
+        void free(VkDeviceSize offset, uint32_t level);
+
+        VkDeviceSize getNodeSize(uint32_t level);
+
+    private:
+        VkDeviceSize size;
+        uint32_t levelCount;
+        std::vector<std::set<VkDeviceSize>> freeLists;
+};
+
+
+//hands out sub-ranges of large VkDeviceMemory blocks, one block list per memory type
+//and resource kind. Requests bigger than half a block get their own VkDeviceMemory.
+class MemoryAllocator {
+    public:
+        MemoryAllocator(const VkPhysicalDeviceMemoryProperties &memProps, DeviceMemoryBackend* backend, VkDeviceSize preferredBlockSize = 64 * 1024 * 1024);
+        ~MemoryAllocator();
+
+        //pick the memory type allowed by typeBits that has all required flags and the most preferred flags
+        uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+
+        Allocation allocate(const VkMemoryRequirements &memReqs, ResourceKind kind, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+        void free(Allocation &allocation);
+
+        //defragmentation hooks. A pass lists the sub-allocations, asks for a destination for the ones
+        //it wants to compact, copies their contents, binds the resource to the destination and frees
+        //the source, which releases blocks that empty out. Dedicated allocations are not listed.
+        std::vector<Allocation> getLiveAllocations();
+        //a range of the same size and alignment in an earlier block of the source's pool, so moves
+        //pack the front blocks. False when none has room; the source stays live either way.
+        bool allocateMoveDestination(const Allocation &source, Allocation &destination);
+
+        MemoryStats getStats();
+        void printStats(std::ostream &out);
+
+    private:
+        struct Block {
+            VkDeviceMemory memory;
+            void* pMapped;
+            BuddyBlock buddy;
+            //every live allocation by offset, enough to list it again and move it
+            struct LiveRange {
+                uint32_t level;
+                VkDeviceSize size;
+                VkDeviceSize alignment;
+            };
+            std::map<VkDeviceSize, LiveRange> live;
+            VkDeviceSize allocatedBytes = 0;
+
+            Block(VkDeviceSize size, VkDeviceSize minNodeSize) : buddy(size, minNodeSize) {}
+        };
+
+        struct Pool {
+            uint32_t memoryTypeIndex;
+            VkDeviceSize blockSize;
+            //released blocks leave a null slot so block indices stay valid
+            std::vector<std::unique_ptr<Block>> blocks;
+            uint32_t dedicatedCount = 0;
+            VkDeviceSize dedicatedBytes = 0;
+            VkDeviceSize requestedBytes = 0;
+        };
+
+        bool allocateFromBlock(Pool &pool, uint32_t blockIndex, VkDeviceSize size, VkDeviceSize alignment, Allocation &allocation);
+        uint32_t createBlock(Pool &pool);
+        void releaseBlock(Pool &pool, uint32_t blockIndex);
+        uint32_t countBlocks(Pool &pool);
+        bool isHostVisible(uint32_t memoryTypeIndex);
+
+        VkPhysicalDeviceMemoryProperties memProps;
+        DeviceMemoryBackend* backend;
+        std::vector<Pool> pools;
+        uint64_t totalDeviceAllocations = 0;
+        std::mutex mutex;
+};
+
+
+#endif
@@ -0,0 +1,33 @@
+#include "memoryUsage.hpp"
+
+#include <cstdio>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+
+size_t getPeakRssBytes() {
+
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    //ru_maxrss is in kilobytes on Linux
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
+
+size_t getCurrentRssBytes() {
+
+    FILE* file = fopen("/proc/self/statm", "r");
+    if(!file) {
+        return 0;
+    }
+    unsigned long totalPages = 0;
+    unsigned long residentPages = 0;
+    int read = fscanf(file, "%lu %lu", &totalPages, &residentPages);
+    fclose(file);
+    if(read != 2) {
+        return 0;
+    }
+    return static_cast<size_t>(residentPages) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
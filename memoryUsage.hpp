@@ -0,0 +1,12 @@
+#ifndef MEMORYUSAGE_HPP
+#define MEMORYUSAGE_HPP
+
+#include <cstddef>
+
+
+//resident set size of this process, from getrusage and /proc/self/statm
+size_t getPeakRssBytes();
+size_t getCurrentRssBytes();
+
+
+#endif
@@ -0,0 +1,172 @@
+#include "meshCache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+
+static const char MESH_CACHE_MAGIC[8] = {'V', 'U', 'L', 'M', 'E', 'S', 'H', '\0'};
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+MeshCache::MeshCache(const std::string &path) : file(path) {
+
+    const char* data = file.getData();
+    size_t size = file.getSize();
+
+    if(size < sizeof(MeshCacheHeader)) {
+        throw std::runtime_error("Invalid mesh file " + path + ": too small.");
+    }
+    pHeader = reinterpret_cast<const MeshCacheHeader*>(data);
+
+    if(memcmp(pHeader->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0) {
+        throw std::runtime_error("Invalid mesh file " + path + ": bad magic.");
+    }
+    if(pHeader->version != MESH_CACHE_VERSION || pHeader->vertexStride != sizeof(Vertex)) {
+        throw std::runtime_error("Invalid mesh file " + path + ": version or vertex layout mismatch.");
+    }
+
+    //every section has to lie inside the file
+    if(pHeader->meshOffset > size || pHeader->meshCount > (size - pHeader->meshOffset) / sizeof(MeshRange) ||
+       pHeader->vertexOffset > size || pHeader->vertexCount > (size - pHeader->vertexOffset) / sizeof(Vertex) ||
+       pHeader->indexOffset > size || pHeader->indexCount > (size - pHeader->indexOffset) / sizeof(uint32_t)) {
+        throw std::runtime_error("Invalid mesh file " + path + ": truncated.");
+    }
+}
+
+void MeshCache::write(const std::string &path, const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+                      const std::vector<MeshRange> &meshes, uint64_t sourceHash) {
+
+    MeshCacheHeader header = {};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version = MESH_CACHE_VERSION;
+    header.vertexStride = sizeof(Vertex);
+    header.sourceHash = sourceHash;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.vertexCount = vertexCount;
+    header.indexCount = indexCount;
+    header.meshOffset = alignUp(sizeof(MeshCacheHeader), 16);
+    header.vertexOffset = alignUp(header.meshOffset + meshes.size() * sizeof(MeshRange), 16);
+    header.indexOffset = alignUp(header.vertexOffset + vertexCount * sizeof(Vertex), 16);
+
+    //write next to the target and rename, so a reader never maps a half written file
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if(!out) {
+            throw std::runtime_error("Could not open " + tmpPath + '.');
+        }
+
+        const char zeros[16] = {};
+        uint64_t written = 0;
+        auto writeAt = [&](uint64_t offset, const void* data, size_t size) {
+            out.write(zeros, offset - written);
+            out.write(static_cast<const char*>(data), size);
+            written = offset + size;
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.meshOffset, meshes.data(), meshes.size() * sizeof(MeshRange));
+        writeAt(header.vertexOffset, vertices, vertexCount * sizeof(Vertex));
+        writeAt(header.indexOffset, indices, indexCount * sizeof(uint32_t));
+
+        if(!out) {
+            throw std::runtime_error("Could not write " + tmpPath + '.');
+        }
+    }
+    if(std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("Could not rename " + tmpPath + " to " + path + '.');
+    }
+}
+
+uint64_t MeshCache::hashFile(const std::string &path, uint64_t seed) {
+    MappedFile source(path);
+    return hashBytes(source.getData(), source.getSize(), seed);
+}
+
+MeshRange MeshCache::makeRange(const Vertex* vertices, uint32_t firstVertex, uint32_t vertexCount, uint32_t firstIndex, uint32_t indexCount) {
+
+    MeshRange range = {};
+    range.firstIndex = firstIndex;
+    range.indexCount = indexCount;
+    range.firstVertex = firstVertex;
+    range.vertexCount = vertexCount;
+    range.boundsMin = glm::vec3(vertexCount ? 1e30f : 0.f);
+    range.boundsMax = glm::vec3(vertexCount ? -1e30f : 0.f);
+    for(uint32_t i = firstVertex; i < firstVertex + vertexCount; i++) {
+        range.boundsMin = glm::min(range.boundsMin, vertices[i].pos);
+        range.boundsMax = glm::max(range.boundsMax, vertices[i].pos);
+    }
+    glm::vec3 center = 0.5f * (range.boundsMin + range.boundsMax);
+    for(uint32_t i = firstVertex; i < firstVertex + vertexCount; i++) {
+        range.radius = std::max(range.radius, glm::length(vertices[i].pos - center));
+    }
+    return range;
+}
+
+const Vertex* MeshCache::getVertices() {
+    return reinterpret_cast<const Vertex*>(file.getData() + pHeader->vertexOffset);
+}
+
+size_t MeshCache::getVertexCount() {
+    return pHeader->vertexCount;
+}
+
+const uint32_t* MeshCache::getIndices() {
+    return reinterpret_cast<const uint32_t*>(file.getData() + pHeader->indexOffset);
+}
+
+size_t MeshCache::getIndexCount() {
+    return pHeader->indexCount;
+}
+
+const MeshRange* MeshCache::getMeshes() {
+    return reinterpret_cast<const MeshRange*>(file.getData() + pHeader->meshOffset);
+}
+
+uint32_t MeshCache::getMeshCount() {
+    return pHeader->meshCount;
+}
+
+uint64_t MeshCache::getSourceHash() {
+    return pHeader->sourceHash;
+}
+
+
+std::unique_ptr<MeshCache> loadObjCached(const std::string &objPath, const ObjOptions &options, bool optimize, bool &cacheHit, MeshOptimizeReport &report) {
+
+    std::string cachePath = objPath + ".vmesh";
+
+    //scale and color are baked into the vertices, so they are part of the key
+    uint64_t sourceHash = MeshCache::hashFile(objPath);
+    sourceHash = hashBytes(&options.scale, sizeof(options.scale), sourceHash);
+    sourceHash = hashBytes(&options.color, sizeof(options.color), sourceHash);
+    sourceHash = hashBytes(&optimize, sizeof(optimize), sourceHash);
+
+    try {
+        std::unique_ptr<MeshCache> cache(new MeshCache(cachePath));
+        if(cache->getSourceHash() == sourceHash) {
+            cacheHit = true;
+            return cache;
+        }
+    } catch(const std::exception &) {
+        //missing or stale cache files are rebuilt below
+    }
+    cacheHit = false;
+
+    std::vector<Vertex> verts;
+    std::vector<uint32_t> idx;
+    obj(objPath, verts, idx, options);
+    if(optimize) {
+        report = optimizeMesh(verts, idx);
+    }
+
+    std::vector<MeshRange> meshes = {MeshCache::makeRange(verts.data(), 0, static_cast<uint32_t>(verts.size()), 0, static_cast<uint32_t>(idx.size()))};
+    MeshCache::write(cachePath, verts.data(), verts.size(), idx.data(), idx.size(), meshes, sourceHash);
+
+    return std::unique_ptr<MeshCache>(new MeshCache(cachePath));
+}
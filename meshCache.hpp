@@ -0,0 +1,85 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "vertex.hpp"
+#include "hash.hpp"
+#include "mappedFile.hpp"
+#include "obj.hpp"
+#include "meshOptimize.hpp"
+
+#define MESH_CACHE_VERSION 2
+
+
+//a binary mesh file is the header, the mesh ranges, the Vertex array and the index array,
+//each section 16 byte aligned and in host byte order. Mapping it gives arrays that can be
+//handed to the staging upload as they are.
+struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    //sizeof(Vertex) when the file was written
+    uint32_t vertexStride;
+    //hash of the source files and the options that shaped the vertices
+    uint64_t sourceHash;
+    uint32_t meshCount;
+    uint32_t reserved;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t meshOffset;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+};
+
+//indices are absolute, so the whole file can be drawn from a single vertex buffer
+struct MeshRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    //of the sphere around the centre of the box, as Scene keeps it
+    float radius;
+};
+
+class MeshCache {
+    public:
+        //map and validate a mesh file, throws if it is missing or malformed
+        MeshCache(const std::string &path);
+
+        static void write(const std::string &path, const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+                          const std::vector<MeshRange> &meshes, uint64_t sourceHash);
+
+        //hashBytes of the whole file
+        static uint64_t hashFile(const std::string &path, uint64_t seed = 0);
+        //bounds and bounding sphere of the given vertices, for building a MeshRange
+        static MeshRange makeRange(const Vertex* vertices, uint32_t firstVertex, uint32_t vertexCount, uint32_t firstIndex, uint32_t indexCount);
+
+        const Vertex* getVertices();
+        size_t getVertexCount();
+        const uint32_t* getIndices();
+        size_t getIndexCount();
+        const MeshRange* getMeshes();
+        uint32_t getMeshCount();
+        uint64_t getSourceHash();
+
+    private:
+        MappedFile file;
+        const MeshCacheHeader* pHeader;
+};
+
+
+//load an OBJ through a mesh file stored next to it (path + ".vmesh").
+//The cache is rebuilt when the hash of the OBJ and the options no longer matches.
+//With optimize the mesh is run through optimizeMesh before it is written, and report
+//receives its result when the cache was rebuilt.
+std::unique_ptr<MeshCache> loadObjCached(const std::string &objPath, const ObjOptions &options, bool optimize, bool &cacheHit, MeshOptimizeReport &report);
+
+
+#endif
@@ -0,0 +1,275 @@
+#include "meshOptimize.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+
+//a vertex is in a FIFO cache when it went in fewer than cacheSize insertions ago,
+//so the cache is a time stamp per vertex and moving time forwards by cacheSize empties it
+class FifoCache {
+    public:
+        FifoCache(size_t vertexCount, uint32_t cacheSize) : timestamps(vertexCount, 0), time(cacheSize + 1), cacheSize(cacheSize) {}
+
+        //1 when v had to be transformed
+        uint32_t touch(uint32_t v) {
+            if(time - timestamps[v] > cacheSize) {
+                timestamps[v] = time++;
+                return 1;
+            }
+            return 0;
+        }
+
+        uint32_t touchTriangle(const uint32_t* triangle) {
+            return touch(triangle[0]) + touch(triangle[1]) + touch(triangle[2]);
+        }
+
+        void flush() {
+            time += cacheSize + 1;
+        }
+
+    private:
+        std::vector<uint32_t> timestamps;
+        uint32_t time;
+        uint32_t cacheSize;
+};
+
+VertexCacheStats analyzeVertexCache(Span<uint32_t> indices, size_t vertexCount, uint32_t cacheSize) {
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0;
+    size_t uniqueVertices = 0;
+    for(size_t i = 0; i < indices.size; i++) {
+        uint32_t v = indices.data[i];
+        misses += cache.touch(v);
+        if(!referenced[v]) {
+            referenced[v] = true;
+            uniqueVertices++;
+        }
+    }
+
+    VertexCacheStats stats;
+    stats.acmr = indices.size >= 3 ? static_cast<float>(misses) / static_cast<float>(indices.size / 3) : 0.f;
+    stats.atvr = uniqueVertices > 0 ? static_cast<float>(misses) / static_cast<float>(uniqueVertices) : 0.f;
+    return stats;
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+
+    const uint32_t none = std::numeric_limits<uint32_t>::max();
+    size_t triangleCount = indexCount / 3;
+    if(triangleCount == 0) {
+        return;
+    }
+
+    //triangles around every vertex, and how many of them are still to be emitted
+    std::vector<uint32_t> liveCounts(vertexCount, 0);
+    for(size_t i = 0; i < triangleCount * 3; i++) {
+        liveCounts[indices[i]]++;
+    }
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for(size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + liveCounts[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for(size_t i = 0; i < triangleCount * 3; i++) {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    deadEnds.reserve(triangleCount * 3);
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0;
+    uint32_t fan = indices[0];
+
+    while(fan != none) {
+        //emit every triangle left around the fanning vertex
+        candidates.clear();
+        for(uint32_t k = offsets[fan]; k < offsets[fan + 1]; k++) {
+            uint32_t t = adjacency[k];
+            if(emitted[t]) {
+                continue;
+            }
+            for(int c = 0; c < 3; c++) {
+                uint32_t v = indices[3 * t + c];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveCounts[v]--;
+                if(time - timestamps[v] > cacheSize) {
+                    timestamps[v] = time++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        //the oldest candidate that will still be cached after its own fan, any candidate otherwise
+        fan = none;
+        int64_t bestPriority = -1;
+        for(uint32_t v : candidates) {
+            if(liveCounts[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if(time - timestamps[v] + 2 * liveCounts[v] <= cacheSize) {
+                priority = time - timestamps[v];
+            }
+            if(priority > bestPriority) {
+                bestPriority = priority;
+                fan = v;
+            }
+        }
+
+        //dead end: go back to a recently used vertex, or to the next one in the input
+        while(fan == none && !deadEnds.empty()) {
+            uint32_t v = deadEnds.back();
+            deadEnds.pop_back();
+            if(liveCounts[v] > 0) {
+                fan = v;
+            }
+        }
+        while(fan == none && cursor < vertexCount) {
+            if(liveCounts[cursor] > 0) {
+                fan = cursor;
+            }
+            cursor++;
+        }
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, Span<Vertex> vertices, float threshold, uint32_t cacheSize) {
+
+    size_t triangleCount = indexCount / 3;
+    if(triangleCount == 0) {
+        return;
+    }
+
+    //runs start wherever the cache order had to start over, a triangle with three misses
+    FifoCache cache(vertices.size, cacheSize);
+    std::vector<size_t> runs;
+    for(size_t t = 0; t < triangleCount; t++) {
+        if(cache.touchTriangle(&indices[3 * t]) == 3) {
+            runs.push_back(t);
+        }
+    }
+    runs.push_back(triangleCount);
+
+    //clusters end once they reach the ACMR of their whole run times threshold
+    std::vector<size_t> clusters;
+    for(size_t r = 0; r + 1 < runs.size(); r++) {
+        size_t start = runs[r];
+        size_t end = runs[r + 1];
+
+        cache.flush();
+        uint32_t runMisses = 0;
+        for(size_t t = start; t < end; t++) {
+            runMisses += cache.touchTriangle(&indices[3 * t]);
+        }
+        float target = threshold * static_cast<float>(runMisses) / static_cast<float>(end - start);
+
+        cache.flush();
+        clusters.push_back(start);
+        uint32_t misses = 0;
+        uint32_t triangles = 0;
+        for(size_t t = start; t < end; t++) {
+            misses += cache.touchTriangle(&indices[3 * t]);
+            triangles++;
+            if(t + 1 < end && static_cast<float>(misses) <= target * static_cast<float>(triangles)) {
+                clusters.push_back(t + 1);
+                cache.flush();
+                misses = 0;
+                triangles = 0;
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    //area weighted centroid and normal of every cluster and of the whole mesh
+    size_t clusterCount = clusters.size() - 1;
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.f));
+    std::vector<float> areas(clusterCount, 0.f);
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for(size_t c = 0; c < clusterCount; c++) {
+        for(size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const glm::vec3 &p0 = vertices.data[indices[3 * t]].pos;
+            const glm::vec3 &p1 = vertices.data[indices[3 * t + 1]].pos;
+            const glm::vec3 &p2 = vertices.data[indices[3 * t + 2]].pos;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            centroids[c] += (p0 + p1 + p2) * (area / 3.f);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += areas[c];
+    }
+    if(meshArea > 0.f) {
+        meshCentroid = meshCentroid / meshArea;
+    }
+
+    //outward facing clusters far from the centre first
+    std::vector<float> keys(clusterCount, 0.f);
+    for(size_t c = 0; c < clusterCount; c++) {
+        float normalLength = glm::length(normals[c]);
+        if(areas[c] > 0.f && normalLength > 0.f) {
+            keys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / normalLength);
+        }
+    }
+    std::vector<uint32_t> order(clusterCount);
+    for(uint32_t c = 0; c < clusterCount; c++) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {return keys[a] > keys[b];});
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    for(uint32_t c : order) {
+        result.insert(result.end(), indices + 3 * clusters[c], indices + 3 * clusters[c + 1]);
+    }
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+
+    const uint32_t unused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for(uint32_t &index : indices) {
+        if(remap[index] == unused) {
+            remap[index] = static_cast<uint32_t>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+MeshOptimizeReport optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    MeshOptimizeReport report;
+    report.before = analyzeVertexCache(indices, vertices.size());
+
+    optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+    optimizeOverdraw(indices.data(), indices.size(), vertices);
+    optimizeVertexFetch(vertices, indices);
+
+    report.after = analyzeVertexCache(indices, vertices.size());
+    report.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
@@ -0,0 +1,45 @@
+#ifndef MESHOPTIMIZE_HPP
+#define MESHOPTIMIZE_HPP
+
+#include "model.hpp"
+#include "vertex.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+//post transform cache efficiency of an index list, simulated with a FIFO cache
+struct VertexCacheStats {
+    //average cache miss ratio: transformed vertices per triangle, 0.5 is ideal for a large grid, 3 is the worst
+    float acmr;
+    //average transformed to vertex ratio: transformed vertices per referenced vertex, 1 is ideal
+    float atvr;
+};
+
+VertexCacheStats analyzeVertexCache(Span<uint32_t> indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+//reorder the triangles for the post transform cache with Tipsify: fan around a vertex, then move on
+//to the neighbour that is still in the cache and has the fewest triangles left.
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+//split a cache optimized index list into clusters and draw the ones facing away from the
+//mesh's centre first, they are the likeliest occluders. A cluster ends when its ACMR has come
+//within threshold of the whole run it is in, so the cache order costs at most that much.
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, Span<Vertex> vertices, float threshold = 1.05f, uint32_t cacheSize = 16);
+
+//order the vertices by their first use in the index list, so vertex fetch walks the buffer
+//forwards. Unreferenced vertices are dropped and the indices rewritten.
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+struct MeshOptimizeReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    double ms;
+};
+
+//all three passes in order: vertex cache, overdraw and vertex fetch
+MeshOptimizeReport optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+
+#endif
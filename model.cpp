@@ -2,16 +2,18 @@
 
 #include <algorithm>
 #include <iostream>
+#include <utility>
+#include <stdexcept>
 
 
-Model::Model(std::vector<Vertex> vertices, std::vector<uint32_t> indices, glm::mat4 model) : vertices(vertices), indices(indices), model(model) {} 
+Model::Model(std::vector<Vertex> vertices, std::vector<uint32_t> indices, glm::mat4 model) : vertices(std::move(vertices)), indices(std::move(indices)), model(model) {} 
 
 
-std::vector<Vertex> Model::getVerts() {
+const std::vector<Vertex>& Model::getVerts() const {
     return vertices;
 }
 
-std::vector<uint32_t> Model::getInds() {
+const std::vector<uint32_t>& Model::getInds() const {
     return indices;
 }
 
@@ -19,32 +21,153 @@ std::vector<uint32_t> Model::getInds() {
 
 Scene::Scene() {}
 
-void Scene::pushbackModel(Model* pModel) {
+void Scene::reserve(size_t vertexCount, size_t indexCount) {
+    vertices.reserve(vertexCount);
+    indices.reserve(indexCount);
+}
+
+void Scene::addMesh(Span<Vertex> meshVertices, Span<uint32_t> meshIndices, const Bounds* meshBounds) {
 
-    std::vector<Vertex> verts = pModel->getVerts();
-    std::vector<uint32_t> inds = pModel->getInds();
+    uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
 
-    std::transform(inds.begin(), inds.end(), inds.begin(), [this](uint32_t i) {return i + vertices.size();});
+    vertices.insert(vertices.end(), meshVertices.data, meshVertices.data + meshVertices.size);
+
+    size_t firstIndex = indices.size();
+    indices.resize(firstIndex + meshIndices.size);
+    std::transform(meshIndices.data, meshIndices.data + meshIndices.size, indices.begin() + firstIndex, [baseVertex](uint32_t i) {return i + baseVertex;});
+
+    endModel(baseVertex, static_cast<uint32_t>(firstIndex), meshBounds);
+}
 
-    vertices.insert(vertices.end(), verts.begin(), verts.end());
-    indices.insert(indices.end(), inds.begin(), inds.end());
+void Scene::addMesh(std::vector<Vertex> &&meshVertices, std::vector<uint32_t> &&meshIndices) {
+
+    if(!vertices.empty() || vertices.capacity() > meshVertices.size()) {
+        addMesh(Span<Vertex>(meshVertices), Span<uint32_t>(meshIndices));
+        return;
+    }
+
+    vertices = std::move(meshVertices);
+    indices = std::move(meshIndices);
+    endModel(0, 0);
+}
+
+void Scene::pushbackModel(Model* pModel) {
+    addMesh(Span<Vertex>(pModel->getVerts()), Span<uint32_t>(pModel->getInds()));
+}
 
+void Scene::endModel(uint32_t firstVertex, uint32_t firstIndex, const Bounds* meshBounds) {
     modelCount++;
+    firstVertices.push_back(firstVertex);
     modelMarkers.push_back(indices.size());
+
+    firstLods.push_back(static_cast<uint32_t>(lods.size()));
+    lodCounts.push_back(1);
+    lods.push_back({firstIndex, static_cast<uint32_t>(indices.size()) - firstIndex, 0.f});
+
+    firstInstances.push_back(static_cast<uint32_t>(instanceTransforms.size()));
+    instanceCounts.push_back(1);
+    instanceTransforms.push_back(glm::mat4(1.f));
+
+    if(meshBounds) {
+        bounds.push_back(*meshBounds);
+        return;
+    }
+
+    Bounds modelBounds;
+    modelBounds.min = glm::vec3(1e30f);
+    modelBounds.max = glm::vec3(-1e30f);
+    for(size_t v = firstVertex; v < vertices.size(); v++) {
+        modelBounds.min = glm::min(modelBounds.min, vertices[v].pos);
+        modelBounds.max = glm::max(modelBounds.max, vertices[v].pos);
+    }
+    if(firstVertex == vertices.size()) {
+        modelBounds.min = modelBounds.max = glm::vec3(0.f);
+    }
+    modelBounds.center = 0.5f * (modelBounds.min + modelBounds.max);
+    modelBounds.radius = 0.f;
+    for(size_t v = firstVertex; v < vertices.size(); v++) {
+        modelBounds.radius = std::max(modelBounds.radius, glm::length(vertices[v].pos - modelBounds.center));
+    }
+    bounds.push_back(modelBounds);
 }
 
-std::vector<Vertex>* Scene::getVerts() {
-    return &vertices;
+void Scene::addLod(Span<uint32_t> lodIndices, float error) {
+
+    if(modelCount == 0) {
+        throw std::runtime_error("Could not add a level of detail: the scene has no models.");
+    }
+
+    uint32_t baseVertex = firstVertices.back();
+    size_t firstIndex = indices.size();
+    indices.resize(firstIndex + lodIndices.size);
+    std::transform(lodIndices.data, lodIndices.data + lodIndices.size, indices.begin() + firstIndex, [baseVertex](uint32_t i) {return i + baseVertex;});
+
+    //the last model's levels are at the end of the array
+    lods.push_back({static_cast<uint32_t>(firstIndex), static_cast<uint32_t>(lodIndices.size), error});
+    lodCounts.back()++;
 }
 
-std::vector<uint32_t>* Scene::getInds() {
-    return &indices;
+void Scene::setInstances(Span<glm::mat4> transforms) {
+
+    if(modelCount == 0) {
+        throw std::runtime_error("Could not set instances: the scene has no models.");
+    }
+
+    //the last model's range is at the end of the array
+    instanceTransforms.resize(firstInstances.back());
+    instanceTransforms.insert(instanceTransforms.end(), transforms.data, transforms.data + transforms.size);
+    instanceCounts.back() = static_cast<uint32_t>(transforms.size);
 }
 
-uint32_t Scene::getModelCount() {
-    return modelCount;
+const std::vector<glm::mat4>& Scene::getInstanceTransforms() const {
+    return instanceTransforms;
+}
+
+uint32_t Scene::getFirstInstance(uint32_t model) {
+    return firstInstances[model];
 }
 
+uint32_t Scene::getInstanceCount(uint32_t model) {
+    return instanceCounts[model];
+}
+
+uint32_t Scene::getFirstIndex(uint32_t model) {
+    return lods[firstLods[model]].firstIndex;
+}
+
+uint32_t Scene::getIndexCount(uint32_t model) {
+    return lods[firstLods[model]].indexCount;
+}
+
+uint32_t Scene::getLodCount(uint32_t model) {
+    return lodCounts[model];
+}
+
+const LodRange& Scene::getLod(uint32_t model, uint32_t level) const {
+    return lods[firstLods[model] + level];
+}
+
+uint32_t Scene::getFirstVertex(uint32_t model) {
+    return firstVertices[model];
+}
 
+uint32_t Scene::getVertexCount(uint32_t model) {
+    uint32_t end = model + 1 < modelCount ? firstVertices[model + 1] : static_cast<uint32_t>(vertices.size());
+    return end - firstVertices[model];
+}
+
+const Bounds& Scene::getBounds(uint32_t model) const {
+    return bounds[model];
+}
 
+const std::vector<Vertex>& Scene::getVerts() const {
+    return vertices;
+}
 
+const std::vector<uint32_t>& Scene::getInds() const {
+    return indices;
+}
+
+uint32_t Scene::getModelCount() {
+    return modelCount;
+}
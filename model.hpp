@@ -5,12 +5,42 @@
 #include "vertex.hpp"
 
 #include <vector>
+#include <cstddef>
+
+
+//non owning view of a contiguous array, e.g. a vector or a memory mapped mesh file
+template<typename T>
+struct Span {
+    const T* data = nullptr;
+    size_t size = 0;
+
+    Span() {}
+    Span(const T* data, size_t size) : data(data), size(size) {}
+    Span(const std::vector<T> &vector) : data(vector.data()), size(vector.size()) {}
+};
+
+//axis aligned box and the bounding sphere around its centre, in model space
+struct Bounds {
+    glm::vec3 min;
+    glm::vec3 max;
+    glm::vec3 center;
+    float radius;
+};
+
+//index range of one level of detail of a model, level 0 is the full mesh
+struct LodRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    //model space distance the level may deviate from the full mesh
+    float error;
+};
 
 class Model {
     public:
+        //pass the vectors with std::move to hand them over without a copy
         Model(std::vector<Vertex> vertices, std::vector<uint32_t> indices, glm::mat4 model = glm::mat4(1.f)); 
-        std::vector<Vertex> getVerts();
-        std::vector<uint32_t> getInds();
+        const std::vector<Vertex>& getVerts() const;
+        const std::vector<uint32_t>& getInds() const;
 
 
 private:
@@ -21,22 +51,70 @@ private:
 
 };
 
+//all models of the scene in one contiguous vertex and index arena.
+//Reserve the totals up front and every add is a single copy into its final place.
 class Scene {
     public:
         Scene();
-        std::vector<Vertex>* getVerts();
-        std::vector<uint32_t>* getInds();
+        const std::vector<Vertex>& getVerts() const;
+        const std::vector<uint32_t>& getInds() const;
+
+        void reserve(size_t vertexCount, size_t indexCount);
+
+        //copy a mesh into the arena, offsetting its indices on the way.
+        //Known bounds, e.g. those of a mesh file, spare the scan over its vertices.
+        void addMesh(Span<Vertex> vertices, Span<uint32_t> indices, const Bounds* meshBounds = nullptr);
+        //take over the vectors when the arena is still empty, otherwise append them
+        void addMesh(std::vector<Vertex> &&vertices, std::vector<uint32_t> &&indices);
+
+        //append a coarser level of detail of the most recently added mesh. Its indices are local
+        //to that mesh, as in addMesh, and go into the arena after the mesh's own indices.
+        void addLod(Span<uint32_t> indices, float error);
 
         void pushbackModel(Model* pModel);
         uint32_t getModelCount();
 
+        //draw the most recently added mesh once per transform instead of once.
+        //The transforms are applied before the model's own matrix.
+        void setInstances(Span<glm::mat4> transforms);
+        const std::vector<glm::mat4>& getInstanceTransforms() const;
+        uint32_t getFirstInstance(uint32_t model);
+        uint32_t getInstanceCount(uint32_t model);
+
+        //index range of the full mesh
+        uint32_t getFirstIndex(uint32_t model);
+        uint32_t getIndexCount(uint32_t model);
+        uint32_t getLodCount(uint32_t model);
+        const LodRange& getLod(uint32_t model, uint32_t level) const;
+
+        uint32_t getFirstVertex(uint32_t model);
+        uint32_t getVertexCount(uint32_t model);
+        //computed once when the model is added
+        const Bounds& getBounds(uint32_t model) const;
+
 
+        //end of each model's full mesh indices, its levels of detail follow it
         std::vector<uint32_t> modelMarkers;
 
     private:
+        void endModel(uint32_t firstVertex, uint32_t firstIndex, const Bounds* meshBounds = nullptr);
+
         std::vector<Vertex> vertices;
         std::vector<uint32_t> indices;
 
+        //every model owns a contiguous range of transforms, one identity by default
+        std::vector<glm::mat4> instanceTransforms;
+        std::vector<uint32_t> firstInstances;
+        std::vector<uint32_t> instanceCounts;
+
+        std::vector<uint32_t> firstVertices;
+        std::vector<Bounds> bounds;
+
+        //every model owns a contiguous range of levels, the full mesh first
+        std::vector<LodRange> lods;
+        std::vector<uint32_t> firstLods;
+        std::vector<uint32_t> lodCounts;
+
 
         uint32_t modelCount = 0;
 };
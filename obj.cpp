@@ -0,0 +1,421 @@
+#include "obj.hpp"
+#include "mappedFile.hpp"
+#include "flatHashMap.hpp"
+
+#include <stdexcept>
+#include <charconv>
+#include <cstring>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <fstream>
+
+
+namespace {
+
+const uint32_t NO_INDEX = 0xffffffffu;
+//files smaller than this per thread are not worth splitting further
+const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+struct Chunk {
+    const char* begin;
+    const char* end;
+
+    //counted in the first pass so the second pass knows where its attributes go
+    uint32_t positionCount = 0;
+    uint32_t normalCount = 0;
+    uint32_t faceCount = 0;
+    uint32_t positionBase = 0;
+    uint32_t normalBase = 0;
+
+    //packed (position, normal) keys of the chunk's vertices and its triangles in chunk local ids
+    std::vector<uint64_t> vertexKeys;
+    std::vector<uint32_t> localIndices;
+    //chunk local id to final vertex index
+    std::vector<uint32_t> remap;
+    size_t indexBase = 0;
+};
+
+//run task(0) .. task(taskCount - 1) on their own threads and rethrow the first failure
+template<typename Task>
+void parallelFor(size_t taskCount, Task task) {
+
+    std::vector<std::exception_ptr> errors(taskCount);
+    std::vector<std::thread> threads;
+
+    for(size_t i = 1; i < taskCount; i++) {
+        threads.emplace_back([&task, &errors, i]() {
+            try {
+                task(i);
+            } catch(...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    try {
+        task(0);
+    } catch(...) {
+        errors[0] = std::current_exception();
+    }
+    for(std::thread &thread : threads) {
+        thread.join();
+    }
+    for(std::exception_ptr &error : errors) {
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+const char* nextLine(const char* p, const char* end) {
+    const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+    return newline ? newline + 1 : end;
+}
+
+const char* skipSpaces(const char* p, const char* end) {
+    while(p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+enum LineType {
+    LINE_OTHER,
+    LINE_POSITION,
+    LINE_NORMAL,
+    LINE_FACE
+};
+
+//classify a line by its keyword and return where its arguments start
+LineType getLineType(const char* &p, const char* end) {
+    p = skipSpaces(p, end);
+    if(end - p < 2) {
+        return LINE_OTHER;
+    }
+    if(p[0] == 'v' && isSpace(p[1])) {
+        p += 2;
+        return LINE_POSITION;
+    }
+    if(p[0] == 'f' && isSpace(p[1])) {
+        p += 2;
+        return LINE_FACE;
+    }
+    if(end - p >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+        p += 3;
+        return LINE_NORMAL;
+    }
+    return LINE_OTHER;
+}
+
+const char* parseFloat(const char* p, const char* end, float &value) {
+    p = skipSpaces(p, end);
+    if(p < end && *p == '+') {
+        p++;
+    }
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if(result.ec == std::errc::result_out_of_range) {
+        //denormals and overflow, neither matters for geometry
+        value = 0.f;
+    }
+    else if(result.ec != std::errc()) {
+        throw std::runtime_error("Could not parse OBJ number.");
+    }
+    return result.ptr;
+}
+
+const char* parseIndex(const char* p, const char* end, long &value) {
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if(result.ec != std::errc()) {
+        throw std::runtime_error("Could not parse OBJ face index.");
+    }
+    return result.ptr;
+}
+
+//OBJ indices are 1 based, negative ones count back from the last attribute read
+uint32_t resolveIndex(long raw, uint32_t countSoFar, uint32_t total) {
+    long index = raw > 0 ? raw - 1 : static_cast<long>(countSoFar) + raw;
+    if(raw == 0 || index < 0 || index >= static_cast<long>(total)) {
+        throw std::runtime_error("Could not parse OBJ face: index out of range.");
+    }
+    return static_cast<uint32_t>(index);
+}
+
+void countLines(Chunk &chunk) {
+
+    for(const char* p = chunk.begin; p < chunk.end; p = nextLine(p, chunk.end)) {
+        const char* args = p;
+        switch(getLineType(args, chunk.end)) {
+            case LINE_POSITION: chunk.positionCount++; break;
+            case LINE_NORMAL: chunk.normalCount++; break;
+            case LINE_FACE: chunk.faceCount++; break;
+            default: break;
+        }
+    }
+}
+
+void parseChunk(Chunk &chunk, glm::vec3* positions, uint32_t positionTotal, glm::vec3* normals, uint32_t normalTotal) {
+
+    uint32_t positionIndex = chunk.positionBase;
+    uint32_t normalIndex = chunk.normalBase;
+
+    //most meshes have about half as many vertices as triangles
+    FlatHashMap vertexMap(chunk.faceCount);
+    chunk.vertexKeys.reserve(chunk.faceCount);
+    chunk.localIndices.reserve(static_cast<size_t>(chunk.faceCount) * 3);
+
+    for(const char* p = chunk.begin; p < chunk.end;) {
+        const char* lineEnd = nextLine(p, chunk.end);
+        const char* end = lineEnd;
+        while(end > p && (end[-1] == '\n' || end[-1] == '\r')) {
+            end--;
+        }
+
+        switch(getLineType(p, end)) {
+            case LINE_POSITION: {
+                glm::vec3 &position = positions[positionIndex++];
+                p = parseFloat(p, end, position.x);
+                p = parseFloat(p, end, position.y);
+                parseFloat(p, end, position.z);
+                break;
+            }
+            case LINE_NORMAL: {
+                glm::vec3 &normal = normals[normalIndex++];
+                p = parseFloat(p, end, normal.x);
+                p = parseFloat(p, end, normal.y);
+                parseFloat(p, end, normal.z);
+                break;
+            }
+            case LINE_FACE: {
+                uint32_t first = 0;
+                uint32_t prev = 0;
+                uint32_t cornerCount = 0;
+
+                for(p = skipSpaces(p, end); p < end; p = skipSpaces(p, end)) {
+                    long raw;
+                    p = parseIndex(p, end, raw);
+                    uint32_t position = resolveIndex(raw, positionIndex, positionTotal);
+                    uint32_t normal = NO_INDEX;
+
+                    //v, v/vt, v//vn or v/vt/vn; texture coordinates are not used by Vertex
+                    if(p < end && *p == '/') {
+                        p++;
+                        if(p < end && *p != '/') {
+                            p = parseIndex(p, end, raw);
+                        }
+                        if(p < end && *p == '/') {
+                            p = parseIndex(p + 1, end, raw);
+                            normal = resolveIndex(raw, normalIndex, normalTotal);
+                        }
+                    }
+                    if(p < end && !isSpace(*p)) {
+                        throw std::runtime_error("Could not parse OBJ face.");
+                    }
+
+                    uint64_t key = static_cast<uint64_t>(position) << 32 | normal;
+                    bool inserted;
+                    uint32_t id = vertexMap.findOrInsert(key, static_cast<uint32_t>(chunk.vertexKeys.size()), inserted);
+                    if(inserted) {
+                        chunk.vertexKeys.push_back(key);
+                    }
+
+                    //fan triangulation around the first corner
+                    if(cornerCount == 0) {
+                        first = id;
+                    }
+                    else if(cornerCount >= 2) {
+                        chunk.localIndices.push_back(first);
+                        chunk.localIndices.push_back(prev);
+                        chunk.localIndices.push_back(id);
+                    }
+                    prev = id;
+                    cornerCount++;
+                }
+                if(cornerCount < 3) {
+                    throw std::runtime_error("Could not parse OBJ face: fewer than 3 corners.");
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        p = lineEnd;
+    }
+}
+
+void appendFloat(std::string &out, float value) {
+    char buffer[32];
+    std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void appendUint(std::string &out, uint32_t value) {
+    char buffer[16];
+    std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void dump(const std::string &path, const std::vector<Vertex> &verts, const std::vector<uint32_t> &idx) {
+
+    std::ofstream file(path, std::ios::binary);
+    if(!file) {
+        throw std::runtime_error("Could not open " + path + '.');
+    }
+
+    //format into a buffer and write it out in large blocks
+    std::string out;
+    out.reserve(1 << 20);
+    out += "Vertices:\n";
+    for(size_t i = 0; i < verts.size(); i++) {
+        const Vertex &v = verts[i];
+        out += 'V'; appendUint(out, i); out += ": P(";
+        appendFloat(out, v.pos.x); out += ", "; appendFloat(out, v.pos.y); out += ", "; appendFloat(out, v.pos.z);
+        out += ") N(";
+        appendFloat(out, v.normal.x); out += ", "; appendFloat(out, v.normal.y); out += ", "; appendFloat(out, v.normal.z);
+        out += ")\n";
+        if(out.size() > (1 << 20) - 256) {
+            file.write(out.data(), out.size());
+            out.clear();
+        }
+    }
+    out += "Indices:\n";
+    for(size_t i = 0; i + 2 < idx.size(); i += 3) {
+        out += 'T'; appendUint(out, i / 3); out += ": ";
+        appendUint(out, idx[i]); out += ", "; appendUint(out, idx[i + 1]); out += ", "; appendUint(out, idx[i + 2]);
+        out += '\n';
+        if(out.size() > (1 << 20) - 64) {
+            file.write(out.data(), out.size());
+            out.clear();
+        }
+    }
+    file.write(out.data(), out.size());
+}
+
+}
+
+
+void obj(const std::string &path, std::vector<Vertex> &verts, std::vector<uint32_t> &idx, const ObjOptions &options) {
+
+    MappedFile file(path);
+    const char* data = file.getData();
+    size_t size = file.getSize();
+
+    uint32_t threadCount = options.threadCount ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / MIN_CHUNK_SIZE));
+
+    //split at line starts
+    std::vector<Chunk> chunks(chunkCount);
+    for(size_t i = 0; i < chunkCount; i++) {
+        chunks[i].begin = i == 0 ? data : nextLine(data + size * i / chunkCount, data + size);
+        chunks[i].end = data + size;
+        if(i > 0) {
+            chunks[i - 1].end = chunks[i].begin;
+        }
+    }
+
+    parallelFor(chunkCount, [&chunks](size_t i) {
+        countLines(chunks[i]);
+    });
+
+    uint32_t positionTotal = 0;
+    uint32_t normalTotal = 0;
+    for(Chunk &chunk : chunks) {
+        chunk.positionBase = positionTotal;
+        chunk.normalBase = normalTotal;
+        positionTotal += chunk.positionCount;
+        normalTotal += chunk.normalCount;
+    }
+
+    //every chunk writes its attributes straight into its own slice
+    std::vector<glm::vec3> positions(positionTotal);
+    std::vector<glm::vec3> normals(normalTotal);
+
+    parallelFor(chunkCount, [&](size_t i) {
+        parseChunk(chunks[i], positions.data(), positionTotal, normals.data(), normalTotal);
+    });
+
+    //merge the per chunk vertices, a vertex used by several chunks is kept once
+    std::vector<uint64_t> vertexKeys;
+    size_t indexCount = 0;
+    if(chunkCount == 1) {
+        vertexKeys.swap(chunks[0].vertexKeys);
+        indexCount = chunks[0].localIndices.size();
+    }
+    else {
+        size_t keyCount = 0;
+        for(Chunk &chunk : chunks) {
+            keyCount += chunk.vertexKeys.size();
+        }
+        FlatHashMap vertexMap(keyCount);
+        vertexKeys.reserve(keyCount);
+
+        for(Chunk &chunk : chunks) {
+            chunk.remap.resize(chunk.vertexKeys.size());
+            for(size_t k = 0; k < chunk.vertexKeys.size(); k++) {
+                bool inserted;
+                chunk.remap[k] = vertexMap.findOrInsert(chunk.vertexKeys[k], static_cast<uint32_t>(vertexKeys.size()), inserted);
+                if(inserted) {
+                    vertexKeys.push_back(chunk.vertexKeys[k]);
+                }
+            }
+            chunk.indexBase = indexCount;
+            indexCount += chunk.localIndices.size();
+        }
+    }
+
+    verts.resize(vertexKeys.size());
+    idx.resize(indexCount);
+
+    bool missingNormals = false;
+    for(uint64_t key : vertexKeys) {
+        if(static_cast<uint32_t>(key) == NO_INDEX) {
+            missingNormals = true;
+            break;
+        }
+    }
+
+    parallelFor(chunkCount, [&](size_t i) {
+        size_t vertexBegin = vertexKeys.size() * i / chunkCount;
+        size_t vertexEnd = vertexKeys.size() * (i + 1) / chunkCount;
+        for(size_t k = vertexBegin; k < vertexEnd; k++) {
+            uint32_t normal = static_cast<uint32_t>(vertexKeys[k]);
+            verts[k].pos = positions[vertexKeys[k] >> 32] * options.scale;
+            verts[k].color = options.color;
+            verts[k].normal = normal == NO_INDEX ? glm::vec3(0.f) : normals[normal];
+        }
+
+        Chunk &chunk = chunks[i];
+        if(chunkCount == 1) {
+            std::copy(chunk.localIndices.begin(), chunk.localIndices.end(), idx.begin());
+            return;
+        }
+        for(size_t k = 0; k < chunk.localIndices.size(); k++) {
+            idx[chunk.indexBase + k] = chunk.remap[chunk.localIndices[k]];
+        }
+    });
+
+    if(missingNormals) {
+        //the cross product's length is twice the triangle area, which gives the weighting for free
+        for(size_t i = 0; i + 2 < idx.size(); i += 3) {
+            glm::vec3 faceNormal = glm::cross(verts[idx[i + 1]].pos - verts[idx[i]].pos, verts[idx[i + 2]].pos - verts[idx[i]].pos);
+            for(size_t k = 0; k < 3; k++) {
+                if(static_cast<uint32_t>(vertexKeys[idx[i + k]]) == NO_INDEX) {
+                    verts[idx[i + k]].normal += faceNormal;
+                }
+            }
+        }
+        for(size_t k = 0; k < verts.size(); k++) {
+            float length = glm::length(verts[k].normal);
+            if(static_cast<uint32_t>(vertexKeys[k]) == NO_INDEX && length > 0.f) {
+                verts[k].normal /= length;
+            }
+        }
+    }
+
+    if(!options.dumpPath.empty()) {
+        dump(options.dumpPath, verts, idx);
+    }
+}
@@ -4,164 +4,28 @@
 
 #include <glm/glm.hpp>
 
-// Iostream - STD I/O Library
-#include <iostream>
-
-// fStream - STD File I/O Library
-#include <fstream>
-
-
 #include <vector>
-
-// OBJ_Loader - .obj Loader
-#include "OBJ_Loader.h"
+#include <string>
+#include <cstdint>
 
 #include "vertex.hpp"
 
 
-
-// Main function
-void obj(std::vector<Vertex> &verts, std::vector<uint32_t> &idx) {
-	// Initialize Loader
-	objl::Loader Loader;
-
-	// Load .obj File
-	//bool loadout = Loader.LoadFile("box_stack.obj");
-	//bool loadout = Loader.LoadFile("african_head.obj");
-	bool loadout = Loader.LoadFile("obj/whale.obj");
-
-	// Check to see if it loaded
-
-	// If so continue
-	if (loadout)
-	{
-		// Create/Open e1Out.txt
-		std::ofstream file("e1Out.txt");
-
-		// Go through each loaded mesh and out its contents
-		for (int i = 0; i < Loader.LoadedMeshes.size(); i++)
-		{
-			// Copy one of the loaded meshes to be our current mesh
-			objl::Mesh curMesh = Loader.LoadedMeshes[i];
-
-			// Print Mesh Name
-			file << "Mesh " << i << ": " << curMesh.MeshName << "\n";
-
-			// Print Vertices
-			file << "Vertices:\n";
-
-			// Go through each vertex and print its number,
-			//  position, normal, and texture coordinate
-			for (int j = 0; j < curMesh.Vertices.size(); j++)
-			{
-				file << "V" << j << ": " <<
-					"P(" << curMesh.Vertices[j].Position.X << ", " << curMesh.Vertices[j].Position.Y << ", " << curMesh.Vertices[j].Position.Z << ") " <<
-					"N(" << curMesh.Vertices[j].Normal.X << ", " << curMesh.Vertices[j].Normal.Y << ", " << curMesh.Vertices[j].Normal.Z << ") " <<
-					"TC(" << curMesh.Vertices[j].TextureCoordinate.X << ", " << curMesh.Vertices[j].TextureCoordinate.Y << ")\n";
-
-
-                Vertex v;
-
-                float scale = 0.5f;
-
-                v.pos.x = scale * curMesh.Vertices[j].Position.X;
-                v.pos.y = scale * curMesh.Vertices[j].Position.Y;
-                v.pos.z = scale * curMesh.Vertices[j].Position.Z;
-
-                v.color = glm::vec3(0.f, 0.f, 1.f);
-
-
-
-                v.normal.x = curMesh.Vertices[j].Normal.X;
-                v.normal.y = curMesh.Vertices[j].Normal.Y;
-                v.normal.z = curMesh.Vertices[j].Normal.Z;
-
-
-                //v.uv.x = curMesh.Vertices[j].TextureCoordinate.X;
-                //v.uv.y = curMesh.Vertices[j].TextureCoordinate.Y;
-
-                verts.push_back(v);
-
-			}
-
-			// Print Indices
-			file << "Indices:\n";
-
-			// Go through every 3rd index and print the
-			//	triangle that these indices represent
-			for (int j = 0; j < curMesh.Indices.size(); j += 3)
-			{
-				file << "T" << j / 3 << ": " << curMesh.Indices[j] << ", " << curMesh.Indices[j + 1] << ", " << curMesh.Indices[j + 2] << "\n";
-
-            idx.push_back(curMesh.Indices[j]);
-            idx.push_back(curMesh.Indices[j+ 1]);
-            idx.push_back(curMesh.Indices[j+ 2]);
-
-			}
-
-			// Print Material
-			file << "Material: " << curMesh.MeshMaterial.name << "\n";
-			file << "Ambient Color: " << curMesh.MeshMaterial.Ka.X << ", " << curMesh.MeshMaterial.Ka.Y << ", " << curMesh.MeshMaterial.Ka.Z << "\n";
-			file << "Diffuse Color: " << curMesh.MeshMaterial.Kd.X << ", " << curMesh.MeshMaterial.Kd.Y << ", " << curMesh.MeshMaterial.Kd.Z << "\n";
-			file << "Specular Color: " << curMesh.MeshMaterial.Ks.X << ", " << curMesh.MeshMaterial.Ks.Y << ", " << curMesh.MeshMaterial.Ks.Z << "\n";
-			file << "Specular Exponent: " << curMesh.MeshMaterial.Ns << "\n";
-			file << "Optical Density: " << curMesh.MeshMaterial.Ni << "\n";
-			file << "Dissolve: " << curMesh.MeshMaterial.d << "\n";
-			file << "Illumination: " << curMesh.MeshMaterial.illum << "\n";
-			file << "Ambient Texture Map: " << curMesh.MeshMaterial.map_Ka << "\n";
-			file << "Diffuse Texture Map: " << curMesh.MeshMaterial.map_Kd << "\n";
-			file << "Specular Texture Map: " << curMesh.MeshMaterial.map_Ks << "\n";
-			file << "Alpha Texture Map: " << curMesh.MeshMaterial.map_d << "\n";
-			file << "Bump Map: " << curMesh.MeshMaterial.map_bump << "\n";
-
-			// Leave a space to separate from the next mesh
-			file << "\n";
-		}
-
-		// Close File
-		file.close();
-	}
-	// If not output an error
-	else
-	{
-		// Create/Open e1Out.txt
-		std::ofstream file("e1Out.txt");
-
-		// Output Error
-		file << "Failed to Load File. May have failed to find it or it was not an .obj file.\n";
-
-		// Close File
-		file.close();
-	}
-
-	// Exit the program
-}
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+struct ObjOptions {
+    //uniform scale applied to every position
+    float scale = 0.5f;
+    glm::vec3 color = glm::vec3(0.f, 0.f, 1.f);
+    //write a text dump of the parsed vertices and triangles here, nothing is written when empty
+    std::string dumpPath;
+    //threads used for parsing, 0 uses every hardware thread
+    uint32_t threadCount = 0;
+};
+
+//parse a Wavefront OBJ file into a single indexed triangle list.
+//The file is memory mapped and split at line boundaries into one chunk per thread.
+//Polygons are fan triangulated and corners sharing a position/normal pair become
+//one vertex. Vertices without a normal get an area weighted average of their faces.
+void obj(const std::string &path, std::vector<Vertex> &verts, std::vector<uint32_t> &idx, const ObjOptions &options = ObjOptions());
 
 
 #endif
@@ -0,0 +1,65 @@
+#include "pipelineBuilder.hpp"
+#include "cpuProfiler.hpp"
+
+#include <algorithm>
+
+
+PipelineBuilder::PipelineBuilder(uint32_t threadCount) : threads(threadCount) {
+}
+
+uint32_t PipelineBuilder::add(const std::string &name, std::function<VkPipeline()> build) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    entries.emplace_back();
+    Entry* entry = &entries.back();
+    entry->name = name;
+    entry->queued = std::chrono::steady_clock::now();
+    entry->done = threads.submit([entry, build]() {
+        CPU_ZONE("compile pipeline");
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        entry->pipeline = build();
+        entry->finished = std::chrono::steady_clock::now();
+        entry->compileMs = std::chrono::duration<double, std::milli>(entry->finished - start).count();
+    });
+    return static_cast<uint32_t>(entries.size() - 1);
+}
+
+VkPipeline PipelineBuilder::get(uint32_t id) {
+
+    Entry* entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entry = &entries[id];
+    }
+    //a future can only be read once, later calls just wait on it
+    if(entry->done.valid()) {
+        entry->done.get();
+    }
+    return entry->pipeline;
+}
+
+void PipelineBuilder::printStats(std::ostream &out) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if(entries.empty()) {
+        return;
+    }
+
+    double totalMs = 0.0;
+    std::chrono::steady_clock::time_point firstQueued = entries.front().queued;
+    std::chrono::steady_clock::time_point lastFinished = firstQueued;
+    out << "Pipeline compile times:\n";
+    for(Entry &entry : entries) {
+        if(entry.done.valid()) {
+            entry.done.wait();
+        }
+        out << "  " << entry.name << ": " << entry.compileMs << " ms\n";
+        totalMs += entry.compileMs;
+        firstQueued = std::min(firstQueued, entry.queued);
+        lastFinished = std::max(lastFinished, entry.finished);
+    }
+    double wallMs = std::chrono::duration<double, std::milli>(lastFinished - firstQueued).count();
+    out << "  " << entries.size() << " pipelines on " << threads.getThreadCount() << " threads: " << totalMs << " ms of compiling in "
+        << wallMs << " ms (" << (wallMs > 0.0 ? totalMs / wallMs : 1.0) << "x)\n";
+}
@@ -0,0 +1,50 @@
+#ifndef PIPELINEBUILDER_HPP
+#define PIPELINEBUILDER_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <future>
+#include <functional>
+#include <chrono>
+#include <ostream>
+
+#include "threadPool.hpp"
+
+
+//compiles pipelines concurrently on its own worker threads. Builds start as soon as they
+//are added, so the caller only blocks in get() on the pipelines it needs right away.
+//Builds may share one VkPipelineCache, which the driver synchronizes internally.
+class PipelineBuilder {
+    public:
+        //0 uses one worker per hardware thread
+        explicit PipelineBuilder(uint32_t threadCount = 0);
+
+        //queue a build, the returned id is passed to get()
+        uint32_t add(const std::string &name, std::function<VkPipeline()> build);
+        //wait for one pipeline, rethrows the error if its build failed
+        VkPipeline get(uint32_t id);
+
+        //per pipeline compile times and the speedup over compiling them one after another
+        void printStats(std::ostream &out);
+
+    private:
+        struct Entry {
+            std::string name;
+            std::future<void> done;
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            std::chrono::steady_clock::time_point queued;
+            std::chrono::steady_clock::time_point finished;
+            double compileMs = 0.0;
+        };
+
+        //entries are only appended, so references to them stay valid
+        std::deque<Entry> entries;
+        std::mutex mutex;
+        ThreadPool threads;
+};
+
+
+#endif
@@ -0,0 +1,142 @@
+#include "pipelineCache.hpp"
+
+#include <stdexcept>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <memory>
+
+#include "mappedFile.hpp"
+#include "hash.hpp"
+
+
+static const char PIPELINE_CACHE_MAGIC[8] = {'V', 'U', 'L', 'P', 'I', 'P', 'E', '\0'};
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string &path) : device(device), path(path) {
+
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    std::string data;
+    warm = load(data);
+
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+    pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCreateInfo.initialDataSize = warm ? data.size() : 0;
+    pipelineCacheCreateInfo.pInitialData = warm ? data.data() : nullptr;
+
+    if(vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &cache) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create pipeline cache.");
+    }
+}
+
+PipelineCache::~PipelineCache() {
+    vkDestroyPipelineCache(device, cache, nullptr);
+}
+
+bool PipelineCache::load(std::string &data) {
+
+    std::unique_ptr<MappedFile> file;
+    try {
+        file.reset(new MappedFile(path));
+    } catch(const std::exception &) {
+        rejectReason = "no cache file";
+        return false;
+    }
+
+    const char* bytes = file->getData();
+    size_t size = file->getSize();
+
+    PipelineCacheFileHeader header;
+    if(size < sizeof(header)) {
+        rejectReason = "file too small";
+        return false;
+    }
+    memcpy(&header, bytes, sizeof(header));
+
+    if(memcmp(header.magic, PIPELINE_CACHE_MAGIC, sizeof(PIPELINE_CACHE_MAGIC)) != 0 || header.version != PIPELINE_CACHE_VERSION) {
+        rejectReason = "not a pipeline cache file";
+        return false;
+    }
+    if(header.vendorID != properties.vendorID || header.deviceID != properties.deviceID) {
+        rejectReason = "written for another device";
+        return false;
+    }
+    if(header.driverVersion != properties.driverVersion || memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        rejectReason = "written by another driver version";
+        return false;
+    }
+    if(header.dataSize != size - sizeof(header) || hashBytes(bytes + sizeof(header), header.dataSize) != header.dataHash) {
+        rejectReason = "truncated or corrupt";
+        return false;
+    }
+
+    //the blob has to start with the header version one layout the driver wrote
+    VkPipelineCacheHeaderVersionOne vkHeader;
+    if(header.dataSize < sizeof(vkHeader)) {
+        rejectReason = "truncated or corrupt";
+        return false;
+    }
+    memcpy(&vkHeader, bytes + sizeof(header), sizeof(vkHeader));
+    if(vkHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || vkHeader.headerSize < sizeof(vkHeader) ||
+       vkHeader.vendorID != properties.vendorID || vkHeader.deviceID != properties.deviceID ||
+       memcmp(vkHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        rejectReason = "driver header mismatch";
+        return false;
+    }
+
+    data.assign(bytes + sizeof(header), header.dataSize);
+    return true;
+}
+
+void PipelineCache::save() {
+
+    size_t dataSize = 0;
+    if(vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS) {
+        throw std::runtime_error("Could not get pipeline cache size.");
+    }
+    std::vector<char> data(dataSize);
+    if(vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Could not get pipeline cache data.");
+    }
+
+    PipelineCacheFileHeader header = {};
+    memcpy(header.magic, PIPELINE_CACHE_MAGIC, sizeof(PIPELINE_CACHE_MAGIC));
+    header.version = PIPELINE_CACHE_VERSION;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = dataSize;
+    header.dataHash = hashBytes(data.data(), dataSize);
+
+    //write next to the target and rename, so a crash never leaves a half written cache
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if(!out) {
+            throw std::runtime_error("Could not open " + tmpPath + '.');
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(data.data(), dataSize);
+        if(!out) {
+            throw std::runtime_error("Could not write " + tmpPath + '.');
+        }
+    }
+    if(std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("Could not rename " + tmpPath + " to " + path + '.');
+    }
+}
+
+VkPipelineCache PipelineCache::getHandle() {
+    return cache;
+}
+
+bool PipelineCache::isWarm() {
+    return warm;
+}
+
+const std::string& PipelineCache::getRejectReason() {
+    return rejectReason;
+}
@@ -0,0 +1,58 @@
+#ifndef PIPELINECACHE_HPP
+#define PIPELINECACHE_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <cstdint>
+
+#define PIPELINE_CACHE_VERSION 1
+
+
+//the cache file is this header followed by the vkGetPipelineCacheData blob.
+//The driver would also reject a foreign blob, but checking first lets a
+//mismatch be reported and keeps a corrupt file from reaching the driver at all.
+struct PipelineCacheFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t dataHash;
+};
+
+//VkPipelineCache that is loaded from disk when created and written back with save()
+class PipelineCache {
+    public:
+        //loads path when it was written for this device and driver, otherwise starts empty
+        PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string &path);
+        ~PipelineCache();
+
+        PipelineCache(const PipelineCache&) = delete;
+        PipelineCache& operator=(const PipelineCache&) = delete;
+
+        //writes the current cache contents to a temporary file and renames it over path
+        void save();
+
+        VkPipelineCache getHandle();
+        //true when the cache started from the file on disk
+        bool isWarm();
+        //why the file was not used, empty when it was
+        const std::string& getRejectReason();
+
+    private:
+        bool load(std::string &data);
+
+        VkDevice device;
+        VkPhysicalDeviceProperties properties;
+        std::string path;
+
+        VkPipelineCache cache = VK_NULL_HANDLE;
+        bool warm = false;
+        std::string rejectReason;
+};
+
+
+#endif
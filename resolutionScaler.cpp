@@ -0,0 +1,43 @@
+#include "resolutionScaler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+ResolutionScaler::ResolutionScaler(double targetMs, float minScale) : targetMs(targetMs) {
+
+    if(!(targetMs > 0.0) || !(minScale > 0.f) || minScale > 1.f) {
+        throw std::runtime_error("Could not create resolution scaler, expected a positive target and a min scale in (0, 1].");
+    }
+    minLogArea = 2.0 * std::log(minScale);
+}
+
+float ResolutionScaler::update(double gpuMs) {
+
+    //a zero time (no timestamps yet) says nothing about the load
+    if(gpuMs > 0.0) {
+        double error = std::log(targetMs / gpuMs);
+        logArea += KP * (error - error1) + KI * error + KD * (error - 2.0 * error1 + error2);
+        logArea = std::max(minLogArea, std::min(0.0, logArea));
+        error2 = error1;
+        error1 = error;
+    }
+
+    float scale = getScale();
+    scaleTotal += scale;
+    updates++;
+    return scale;
+}
+
+float ResolutionScaler::getScale() {
+    return static_cast<float>(std::exp(0.5 * logArea));
+}
+
+double ResolutionScaler::getTargetMs() {
+    return targetMs;
+}
+
+float ResolutionScaler::getAverageScale() {
+    return updates == 0 ? 1.f : static_cast<float>(scaleTotal / updates);
+}
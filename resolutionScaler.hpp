@@ -0,0 +1,41 @@
+#ifndef RESOLUTIONSCALER_HPP
+#define RESOLUTIONSCALER_HPP
+
+#include <cstdint>
+
+
+//picks the render resolution from the GPU frame time. A PID controller in velocity form works
+//on the logarithms of the time and of the rendered pixel count: GPU time is roughly proportional
+//to the pixels drawn, so in log space the plant has unit gain whatever the scene costs, and the
+//same gains hold for light and heavy scenes. The velocity form can't wind up at the clamps.
+class ResolutionScaler {
+    public:
+        //scales are fractions of the output width and height, up to 1
+        ResolutionScaler(double targetMs, float minScale);
+
+        //feed the GPU time of a frame, returns the scale to render the next one at
+        float update(double gpuMs);
+        float getScale();
+        double getTargetMs();
+        //over every update so far, 1 before the first
+        float getAverageScale();
+
+    private:
+        static constexpr double KP = 0.3;
+        static constexpr double KI = 0.15;
+        static constexpr double KD = 0.05;
+
+        double targetMs;
+        //log of the pixel fraction, from minLogArea to 0
+        double logArea = 0.0;
+        double minLogArea;
+        //errors of the two previous updates
+        double error1 = 0.0;
+        double error2 = 0.0;
+
+        double scaleTotal = 0.0;
+        uint64_t updates = 0;
+};
+
+
+#endif
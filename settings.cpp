@@ -0,0 +1,225 @@
+#include "settings.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <cstring>
+
+
+static uint32_t parseUint(int argc, char** argv, int &i) {
+    if(i + 1 >= argc) {
+        throw std::runtime_error(std::string("Missing value for ") + argv[i] + '.');
+    }
+    i++;
+    return static_cast<uint32_t>(std::stoul(argv[i]));
+}
+
+static float parseFloat(int argc, char** argv, int &i) {
+    if(i + 1 >= argc) {
+        throw std::runtime_error(std::string("Missing value for ") + argv[i] + '.');
+    }
+    i++;
+    return std::stof(argv[i]);
+}
+
+static std::string parseString(int argc, char** argv, int &i) {
+    if(i + 1 >= argc) {
+        throw std::runtime_error(std::string("Missing value for ") + argv[i] + '.');
+    }
+    i++;
+    return argv[i];
+}
+
+Settings parseSettings(int argc, char** argv) {
+
+    Settings settings;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--frames-in-flight") == 0) {
+            settings.framesInFlight = parseUint(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--headless") == 0) {
+            settings.headless = true;
+        }
+        else if(strcmp(argv[i], "--frames") == 0) {
+            settings.frameCount = parseUint(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--warmup") == 0) {
+            settings.warmupFrames = parseUint(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--camera-path") == 0) {
+            std::string path = parseString(argc, argv, i);
+            if(path == "static") {
+                settings.cameraPath = CAMERA_PATH_STATIC;
+            }
+            else if(path == "orbit") {
+                settings.cameraPath = CAMERA_PATH_ORBIT;
+            }
+            else if(path == "fly") {
+                settings.cameraPath = CAMERA_PATH_FLY;
+            }
+            else {
+                throw std::runtime_error("Unknown camera path " + path + ", expected static, orbit or fly.");
+            }
+        }
+        else if(strcmp(argv[i], "--resize-every") == 0) {
+            settings.resizeEvery = parseUint(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--dynamic-resolution") == 0) {
+            settings.targetGpuMs = parseFloat(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--min-render-scale") == 0) {
+            settings.minRenderScale = parseFloat(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--simulate-gpu-ms") == 0) {
+            settings.simulatedGpuMs = parseFloat(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--bench-json") == 0) {
+            settings.benchJsonPath = parseString(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--host-visible-geometry") == 0) {
+            settings.hostVisibleGeometry = true;
+        }
+        else if(strcmp(argv[i], "--obj") == 0) {
+            settings.objPath = parseString(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--obj-dump") == 0) {
+            settings.objDumpPath = parseString(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--synthetic") == 0) {
+            settings.syntheticTriangles = parseUint(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--no-mesh-cache") == 0) {
+            settings.meshCache = false;
+        }
+        else if(strcmp(argv[i], "--vertex-layout") == 0) {
+            std::string layout = parseString(argc, argv, i);
+            if(layout == "full") {
+                settings.vertexLayout = VERTEX_LAYOUT_FULL;
+            }
+            else if(layout == "half") {
+                settings.vertexLayout = VERTEX_LAYOUT_HALF;
+            }
+            else if(layout == "snorm16") {
+                settings.vertexLayout = VERTEX_LAYOUT_SNORM16;
+            }
+            else {
+                throw std::runtime_error("Unknown vertex layout " + layout + ", expected full, half or snorm16.");
+            }
+        }
+        else if(strcmp(argv[i], "--no-mesh-optimize") == 0) {
+            settings.meshOptimize = false;
+        }
+        else if(strcmp(argv[i], "--instances") == 0) {
+            settings.instanceCount = parseUint(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--no-instancing") == 0) {
+            settings.instancing = false;
+        }
+        else if(strcmp(argv[i], "--gpu-driven") == 0) {
+            settings.gpuDriven = true;
+        }
+        else if(strcmp(argv[i], "--no-indirect-count") == 0) {
+            settings.indirectCount = false;
+        }
+        else if(strcmp(argv[i], "--rerecord") == 0) {
+            settings.rerecord = true;
+        }
+        else if(strcmp(argv[i], "--record-threads") == 0) {
+            settings.recordThreads = parseUint(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--pipeline-cache") == 0) {
+            settings.pipelineCachePath = parseString(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--no-pipeline-cache") == 0) {
+            settings.pipelineCache = false;
+        }
+        else if(strcmp(argv[i], "--shader-dir") == 0) {
+            settings.shaderDir = parseString(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--hot-reload") == 0) {
+            settings.hotReload = true;
+        }
+        else if(strcmp(argv[i], "--pipeline-threads") == 0) {
+            settings.pipelineThreads = parseUint(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--wireframe") == 0) {
+            settings.wireframe = true;
+        }
+        else if(strcmp(argv[i], "--cpu-cull") == 0) {
+            settings.cpuCull = true;
+        }
+        else if(strcmp(argv[i], "--cull-bvh") == 0) {
+            settings.cullBvh = true;
+        }
+        else if(strcmp(argv[i], "--lods") == 0) {
+            settings.lodCount = parseUint(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--lod-error") == 0) {
+            settings.lodError = parseFloat(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--model-ubo") == 0) {
+            settings.modelUbo = true;
+        }
+        else if(strcmp(argv[i], "--gpu-profile") == 0) {
+            settings.gpuProfile = true;
+        }
+        else if(strcmp(argv[i], "--gpu-profile-draws") == 0) {
+            settings.gpuProfileDraws = true;
+        }
+        else if(strcmp(argv[i], "--gpu-trace") == 0) {
+            settings.gpuTracePath = parseString(argc, argv, i);
+        }
+        else if(strcmp(argv[i], "--cpu-profile") == 0) {
+            settings.cpuProfile = true;
+        }
+        else if(strcmp(argv[i], "--cpu-trace") == 0) {
+            settings.cpuTracePath = parseString(argc, argv, i);
+        }
+        else {
+            throw std::runtime_error(std::string("Unknown argument: ") + argv[i]);
+        }
+    }
+
+    if(settings.framesInFlight == 0) {
+        throw std::runtime_error("--frames-in-flight must be at least 1.");
+    }
+    if(settings.instanceCount == 0) {
+        throw std::runtime_error("--instances must be at least 1.");
+    }
+    if(!(settings.lodError > 0.f)) {
+        throw std::runtime_error("--lod-error must be greater than 0.");
+    }
+    if(settings.cullBvh) {
+        settings.cpuCull = true;
+    }
+    if(!settings.benchJsonPath.empty() && !settings.headless) {
+        throw std::runtime_error("--bench-json needs --headless.");
+    }
+    if(settings.resizeEvery > 0 && !settings.headless) {
+        throw std::runtime_error("--resize-every needs --headless, resize the window instead.");
+    }
+    if(settings.gpuProfileDraws || !settings.gpuTracePath.empty()) {
+        settings.gpuProfile = true;
+    }
+    if(!settings.cpuTracePath.empty()) {
+        settings.cpuProfile = true;
+    }
+    if(settings.cpuCull && settings.gpuDriven) {
+        throw std::runtime_error("--cpu-cull and --gpu-driven cannot be combined.");
+    }
+    if(settings.targetGpuMs < 0.f) {
+        throw std::runtime_error("--dynamic-resolution must not be negative.");
+    }
+    if(!(settings.minRenderScale > 0.f && settings.minRenderScale <= 1.f)) {
+        throw std::runtime_error("--min-render-scale must be greater than 0 and at most 1.");
+    }
+    if(settings.simulatedGpuMs > 0.f && settings.targetGpuMs == 0.f) {
+        throw std::runtime_error("--simulate-gpu-ms needs --dynamic-resolution.");
+    }
+    //culled draws and the render area change every frame, so the command buffers have to be recorded every frame
+    if(settings.cpuCull || settings.targetGpuMs > 0.f) {
+        settings.rerecord = true;
+    }
+
+    return settings;
+}
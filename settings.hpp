@@ -0,0 +1,121 @@
+#ifndef SETTINGS_HPP
+#define SETTINGS_HPP
+
+#include <cstdint>
+#include <string>
+
+
+//GPU vertex formats, see vertexLayout.hpp
+enum VertexLayout {
+    VERTEX_LAYOUT_FULL,
+    VERTEX_LAYOUT_HALF,
+    VERTEX_LAYOUT_SNORM16
+};
+
+//scripted camera motion of headless runs, a function of the frame number so runs repeat exactly
+enum CameraPath {
+    CAMERA_PATH_STATIC,
+    CAMERA_PATH_ORBIT,
+    CAMERA_PATH_FLY
+};
+
+struct Settings {
+    //number of frames the CPU may record ahead of the GPU
+    uint32_t framesInFlight = 2;
+
+    //render into offscreen images without a window, surface or swapchain
+    bool headless = false;
+    //number of frames rendered before a headless run exits
+    uint32_t frameCount = 1000;
+    //headless frames rendered before timing starts
+    uint32_t warmupFrames = 0;
+    CameraPath cameraPath = CAMERA_PATH_STATIC;
+    //headless frames between resizes of the offscreen targets, 0 never resizes
+    uint32_t resizeEvery = 0;
+
+    //GPU frame time the render resolution is scaled to meet, 0 renders at the output size
+    float targetGpuMs = 0.f;
+    //smallest fraction of the output width and height rendered
+    float minRenderScale = 0.5f;
+    //full resolution GPU time fed to the scaler in place of timestamps, 0 measures it
+    float simulatedGpuMs = 0.f;
+    //machine readable results of a headless run, skipped when empty
+    std::string benchJsonPath;
+
+    //keep geometry in host visible memory instead of staging it into device local memory
+    bool hostVisibleGeometry = false;
+
+    //model loaded over the plane
+    std::string objPath = "obj/whale.obj";
+    //generate a sphere of about this many triangles instead of loading the OBJ, 0 loads it
+    uint32_t syntheticTriangles = 0;
+    //text dump of the parsed model, skipped when empty
+    std::string objDumpPath;
+    //load the model through a binary mesh file next to it, rebuilt when the OBJ changes
+    bool meshCache = true;
+    //format of the vertex buffer, the compressed ones take a third of the full one's memory
+    VertexLayout vertexLayout = VERTEX_LAYOUT_SNORM16;
+
+    //reorder the model for the vertex cache, overdraw and vertex fetch before it goes into the scene
+    bool meshOptimize = true;
+
+    //copies of the model placed in a grid, drawn with one instanced draw
+    uint32_t instanceCount = 1;
+    //issue one draw per instance instead, for comparison
+    bool instancing = true;
+
+    //cull every instance in a compute pass and draw the survivors with indirect draws
+    bool gpuDriven = false;
+    //ignore VK_KHR_draw_indirect_count and use the plain indirect fallback
+    bool indirectCount = true;
+
+    //record the frame's command buffer every frame instead of once at startup,
+    //with the draws split into secondary command buffers across threads
+    bool rerecord = false;
+    //threads recording secondary command buffers, 0 uses one per hardware thread
+    uint32_t recordThreads = 0;
+
+    //pipeline cache file loaded at startup and written back at shutdown
+    std::string pipelineCachePath = "pipeline.cache";
+    bool pipelineCache = true;
+
+    //directory the SPIR-V shaders are loaded from
+    std::string shaderDir = "shaders";
+    //rebuild pipelines when their SPIR-V files change
+    bool hotReload = false;
+
+    //threads compiling pipelines at startup, 0 uses one per hardware thread
+    uint32_t pipelineThreads = 0;
+    //draw with the wireframe pipeline variant
+    bool wireframe = false;
+
+    //frustum cull the draws on the CPU every frame before recording them, implies rerecord
+    bool cpuCull = false;
+    //with cpuCull, walk the scene BVH instead of testing every draw's sphere
+    bool cullBvh = false;
+
+    //coarser levels of detail generated for every model at load time, 0 disables them
+    uint32_t lodCount = 4;
+    //screen space error in pixels a level of detail may show before a finer one is drawn
+    float lodError = 1.f;
+
+    //bind the model matrix through the dynamic ubo per draw instead of pushing it, for comparison
+    bool modelUbo = false;
+
+    //print min/avg/p99 GPU times of the frame and its passes at exit
+    bool gpuProfile = false;
+    //also time every draw, implies gpuProfile
+    bool gpuProfileDraws = false;
+    //Chrome trace of every GPU zone written at exit, skipped when empty, implies gpuProfile
+    std::string gpuTracePath;
+
+    //print count and time of every CPU zone (startup steps, frame phases) at exit
+    bool cpuProfile = false;
+    //Chrome trace of every CPU zone written at exit, skipped when empty, implies cpuProfile
+    std::string cpuTracePath;
+};
+
+Settings parseSettings(int argc, char** argv);
+
+
+#endif
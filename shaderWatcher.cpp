@@ -0,0 +1,99 @@
+#include "shaderWatcher.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+
+//how long to keep collecting events after the first one
+#define SHADER_WATCH_SETTLE_MS 50
+
+ShaderWatcher::ShaderWatcher(const std::string &directory, std::function<void(const std::vector<std::string>&)> onChange) : onChange(onChange) {
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd < 0) {
+        throw std::runtime_error("Could not initialize inotify.");
+    }
+
+    //editors and compilers often write a temporary file and rename it over the old one,
+    //so watch the directory for both writes and moves instead of the files themselves
+    if(inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(inotifyFd);
+        throw std::runtime_error("Could not watch " + directory + '.');
+    }
+
+    stopFd = eventfd(0, EFD_CLOEXEC);
+    if(stopFd < 0) {
+        close(inotifyFd);
+        throw std::runtime_error("Could not create shader watcher event.");
+    }
+
+    thread = std::thread(&ShaderWatcher::watchLoop, this);
+}
+
+ShaderWatcher::~ShaderWatcher() {
+
+    uint64_t one = 1;
+    if(write(stopFd, &one, sizeof(one)) != sizeof(one)) {
+        std::cout << "Could not stop shader watcher.\n";
+    }
+    thread.join();
+    close(stopFd);
+    close(inotifyFd);
+}
+
+bool ShaderWatcher::readEvents(std::vector<std::string> &changed, int timeoutMs) {
+
+    pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+    if(poll(fds, 2, timeoutMs) < 0) {
+        return true;
+    }
+    if(fds[1].revents & POLLIN) {
+        return false;
+    }
+    if(!(fds[0].revents & POLLIN)) {
+        return true;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for(char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len) {
+            inotify_event* event = reinterpret_cast<inotify_event*>(p);
+            if(event->len > 0 && std::find(changed.begin(), changed.end(), event->name) == changed.end()) {
+                changed.push_back(event->name);
+            }
+        }
+    }
+    return true;
+}
+
+void ShaderWatcher::watchLoop() {
+
+    while(true) {
+        std::vector<std::string> changed;
+        if(!readEvents(changed, -1)) {
+            return;
+        }
+        if(changed.empty()) {
+            continue;
+        }
+
+        //let the rest of a batch of writes land before reporting it
+        size_t count;
+        do {
+            count = changed.size();
+            if(!readEvents(changed, SHADER_WATCH_SETTLE_MS)) {
+                return;
+            }
+        } while(changed.size() != count);
+
+        onChange(changed);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef SHADERWATCHER_HPP
+#define SHADERWATCHER_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+
+
+//watches a directory with inotify on a background thread and reports files that were
+//written or moved into it. Events arriving close together are collected into one call,
+//so a compiler writing several shaders triggers a single rebuild.
+class ShaderWatcher {
+    public:
+        //onChange runs on the watcher thread with the names (not paths) of the changed files
+        ShaderWatcher(const std::string &directory, std::function<void(const std::vector<std::string>&)> onChange);
+        ~ShaderWatcher();
+
+        ShaderWatcher(const ShaderWatcher&) = delete;
+        ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    private:
+        void watchLoop();
+        //read pending events, false once the watcher is stopping
+        bool readEvents(std::vector<std::string> &changed, int timeoutMs);
+
+        std::function<void(const std::vector<std::string>&)> onChange;
+        int inotifyFd = -1;
+        //written by the destructor to wake the thread up
+        int stopFd = -1;
+        std::thread thread;
+};
+
+
+#endif
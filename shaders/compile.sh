@@ -1,3 +1,8 @@
-glslangValidator /home/michael/projects/vulkan/vulkanTri/shaders/shader.vert -V --vn vertShader
+#!/bin/sh
+# compile the GLSL shaders to SPIR-V next to their sources, e.g. shaders/shader.vert.spv.
+# vulest loads these at runtime, and with --hot-reload picks up a recompile without a restart.
+dir=$(dirname "$0")
 
-glslangValidator /home/michael/projects/vulkan/vulkanTri/shaders/shader.frag -V --vn fragShader 
+for shader in shader.vert shader.frag cull.comp; do
+    glslangValidator -V "$dir/$shader" -o "$dir/$shader.spv" || exit 1
+done
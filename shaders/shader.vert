@@ -2,14 +2,28 @@
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
 
-layout (location = 0) in vec3 pos;
+//what these hold depends on the vertex layout, see vertexLayout.hpp
+layout (location = 0) in vec4 pos;
 layout (location = 1) in vec3 color;
-layout (location = 2) in vec3 normal;
+layout (location = 2) in vec4 normal;
+layout (location = 3) in mat4 instanceModel;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragNormal;
 layout(location = 2) out vec3 fragPos;
 
+//per draw model matrix, from push constants unless the pipeline selects the UBO path
+layout (constant_id = 0) const bool modelFromUbo = false;
+
+//0 full floats, 1 half float positions, 2 snorm16 positions times positionScale.
+//The compressed layouts carry an octahedral normal and a material index in pos.w.
+layout (constant_id = 1) const int vertexLayout = 0;
+layout (constant_id = 2) const float positionScale = 1.f;
+
+layout (push_constant) uniform pushM {
+    mat4 model;
+} pushConstantsM;
+
 layout (std140, set = 0, binding = 0) uniform bufM {
     mat4 model;
 } uboM;
@@ -17,13 +31,34 @@ layout (std140, set = 0, binding = 0) uniform bufM {
 layout (std140, set = 1, binding = 0) uniform bufVP {
     mat4 view;
     mat4 projection;
+    vec4 materials[16];
 } uboVP;
 
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.f - abs(e.x) - abs(e.y));
+    if(n.z < 0.f) {
+        n.xy = (1.f - abs(n.yx)) * vec2(n.x >= 0.f ? 1.f : -1.f, n.y >= 0.f ? 1.f : -1.f);
+    }
+    return normalize(n);
+}
+
 void main() {
 
-    mat4 MVP = uboVP.projection * uboVP.view * uboM.model;
-    gl_Position = MVP * vec4(pos, 1.f);
-    fragColor = color;
-    fragNormal = normal;
-    fragPos = vec3(uboM.model * vec4(pos, 1.f));
+    vec3 position = pos.xyz;
+    vec3 vertexNormal = normal.xyz;
+    vec3 vertexColor = color;
+    if(vertexLayout != 0) {
+        //half floats hold the position itself, snorm16 a fraction of the largest coordinate
+        position = vertexLayout == 2 ? pos.xyz * positionScale : pos.xyz;
+        vertexNormal = decodeOctahedral(normal.xy);
+        uint material = uint(round(vertexLayout == 2 ? pos.w * 32767.f : pos.w));
+        vertexColor = uboVP.materials[material].rgb;
+    }
+
+    mat4 model = (modelFromUbo ? uboM.model : pushConstantsM.model) * instanceModel;
+    mat4 MVP = uboVP.projection * uboVP.view * model;
+    gl_Position = MVP * vec4(position, 1.f);
+    fragColor = vertexColor;
+    fragNormal = vertexNormal;
+    fragPos = vec3(model * vec4(position, 1.f));
 }
@@ -0,0 +1,27 @@
+#include "spirv.hpp"
+
+#include <stdexcept>
+#include <cstring>
+
+#include "mappedFile.hpp"
+
+
+static const uint32_t SPIRV_MAGIC = 0x07230203;
+
+std::vector<uint32_t> loadSpirv(const std::string &path) {
+
+    MappedFile file(path);
+
+    //a shader that is still being written shows up here as a short or odd sized file
+    if(file.getSize() < 5 * sizeof(uint32_t) || file.getSize() % sizeof(uint32_t) != 0) {
+        throw std::runtime_error("Invalid SPIR-V file " + path + ": bad size.");
+    }
+
+    std::vector<uint32_t> code(file.getSize() / sizeof(uint32_t));
+    memcpy(code.data(), file.getData(), file.getSize());
+
+    if(code[0] != SPIRV_MAGIC) {
+        throw std::runtime_error("Invalid SPIR-V file " + path + ": bad magic.");
+    }
+    return code;
+}
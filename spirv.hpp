@@ -0,0 +1,13 @@
+#ifndef SPIRV_HPP
+#define SPIRV_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+
+//read a SPIR-V binary, throws when the file is missing or not SPIR-V
+std::vector<uint32_t> loadSpirv(const std::string &path);
+
+
+#endif
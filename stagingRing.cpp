@@ -0,0 +1,213 @@
+#include "stagingRing.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+
+StagingRing::StagingRing(VkDevice device, MemoryAllocator* allocator, uint32_t queueFamilyIndex, VkQueue queue, VkDeviceSize capacity) : device(device), queue(queue), allocator(allocator), capacity(capacity) {
+
+    //keep several chunks in the ring at once so copying into it overlaps with transfers
+    maxChunkSize = capacity / 4;
+
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.size = capacity;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create staging buffer.");
+    }
+
+    VkMemoryRequirements memReqs;
+    vkGetBufferMemoryRequirements(device, buffer, &memReqs);
+
+    //the allocator prefers types without extra flags, so this lands in system memory
+    //rather than the small device local host visible heap
+    allocation = allocator->allocate(memReqs, RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if(vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("Could not bind staging buffer memory.");
+    }
+    pData = static_cast<char*>(allocation.pMapped);
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+    if(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create staging command pool.");
+    }
+}
+
+StagingRing::~StagingRing() {
+
+    finish();
+    for(Batch batch : freeBatches) {
+        vkDestroyFence(device, batch.fence, nullptr);
+    }
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    vkDestroyBuffer(device, buffer, nullptr);
+    allocator->free(allocation);
+}
+
+void StagingRing::upload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+
+    const char* src = static_cast<const char*>(data);
+
+    while(size > 0) {
+        VkDeviceSize chunkSize = std::min(size, maxChunkSize);
+        VkDeviceSize offset = reserve(chunkSize);
+
+        std::memcpy(pData + offset, src, chunkSize);
+
+        PendingCopy copy;
+        copy.dst = dst;
+        copy.region.srcOffset = offset;
+        copy.region.dstOffset = dstOffset;
+        copy.region.size = chunkSize;
+        pendingCopies.push_back(copy);
+
+        src += chunkSize;
+        dstOffset += chunkSize;
+        size -= chunkSize;
+        bytesUploaded += chunkSize;
+    }
+}
+
+VkDeviceSize StagingRing::reserve(VkDeviceSize size) {
+
+    //keep chunks 16 byte aligned inside the ring
+    VkDeviceSize alignedSize = (size + 15) & ~VkDeviceSize(15);
+
+    while(true) {
+        if(used == 0) {
+            head = 0;
+        }
+        //a chunk never straddles the end of the ring, the tail end is skipped instead
+        VkDeviceSize padding = head + alignedSize <= capacity ? 0 : capacity - head;
+
+        if(used + padding + alignedSize <= capacity) {
+            if(padding > 0) {
+                head = 0;
+            }
+            VkDeviceSize offset = head;
+            head += alignedSize;
+            used += padding + alignedSize;
+            pendingConsumed += padding + alignedSize;
+            return offset;
+        }
+
+        if(!pendingCopies.empty()) {
+            flush();
+        }
+        if(inFlightBatches.empty()) {
+            throw std::runtime_error("Staging upload does not fit in the staging ring.");
+        }
+        retireOldestBatch();
+    }
+}
+
+StagingRing::Batch StagingRing::acquireBatch() {
+
+    if(!freeBatches.empty()) {
+        Batch batch = freeBatches.back();
+        freeBatches.pop_back();
+        vkResetCommandBuffer(batch.commandBuffer, 0);
+        vkResetFences(device, 1, &batch.fence);
+        return batch;
+    }
+
+    Batch batch;
+
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = commandPool;
+    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+
+    if(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &batch.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Could not allocate staging command buffer.");
+    }
+
+    VkFenceCreateInfo fenceCreateInfo = {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if(vkCreateFence(device, &fenceCreateInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create staging fence.");
+    }
+    return batch;
+}
+
+void StagingRing::flush() {
+
+    if(pendingCopies.empty()) {
+        return;
+    }
+
+    Batch batch = acquireBatch();
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Could not begin staging command buffer.");
+    }
+
+    //consecutive copies into the same buffer go out as one vkCmdCopyBuffer
+    std::vector<VkBufferCopy> regions;
+    for(size_t i = 0; i < pendingCopies.size(); i++) {
+        regions.push_back(pendingCopies[i].region);
+        if(i + 1 == pendingCopies.size() || pendingCopies[i + 1].dst != pendingCopies[i].dst) {
+            vkCmdCopyBuffer(batch.commandBuffer, buffer, pendingCopies[i].dst, static_cast<uint32_t>(regions.size()), regions.data());
+            regions.clear();
+        }
+    }
+
+    if(vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Could not record staging command buffer.");
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+    if(vkQueueSubmit(queue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+        throw std::runtime_error("Could not submit staging copies.");
+    }
+
+    batch.consumed = pendingConsumed;
+    pendingConsumed = 0;
+    pendingCopies.clear();
+    inFlightBatches.push_back(batch);
+    submitCount++;
+}
+
+void StagingRing::retireOldestBatch() {
+
+    Batch batch = inFlightBatches.front();
+    inFlightBatches.pop_front();
+
+    vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+    used -= batch.consumed;
+    freeBatches.push_back(batch);
+}
+
+void StagingRing::finish() {
+
+    flush();
+    while(!inFlightBatches.empty()) {
+        retireOldestBatch();
+    }
+}
+
+VkDeviceSize StagingRing::getBytesUploaded() {
+    return bytesUploaded;
+}
+
+uint32_t StagingRing::getSubmitCount() {
+    return submitCount;
+}
@@ -0,0 +1,72 @@
+#ifndef STAGINGRING_HPP
+#define STAGINGRING_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <deque>
+
+#include "memoryAllocator.hpp"
+
+
+//persistently mapped host visible ring buffer used to fill device local buffers.
+//uploads are split into chunks, copied into the ring and recorded as vkCmdCopyBuffer
+//regions. Regions are submitted in batches; when the ring is full the oldest batch
+//is waited on and its space reused, so uploads larger than the ring stream through it.
+class StagingRing {
+    public:
+        StagingRing(VkDevice device, MemoryAllocator* allocator, uint32_t queueFamilyIndex, VkQueue queue, VkDeviceSize capacity);
+        ~StagingRing();
+
+        void upload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+        //submit all recorded copies without waiting for them
+        void flush();
+        //submit all recorded copies and wait until every batch has completed
+        void finish();
+
+        VkDeviceSize getBytesUploaded();
+        uint32_t getSubmitCount();
+
+    private:
+        struct Batch {
+            VkCommandBuffer commandBuffer;
+            VkFence fence;
+            VkDeviceSize consumed;
+        };
+
+        struct PendingCopy {
+            VkBuffer dst;
+            VkBufferCopy region;
+        };
+
+        VkDeviceSize reserve(VkDeviceSize size);
+        void retireOldestBatch();
+        Batch acquireBatch();
+
+        VkDevice device;
+        VkQueue queue;
+
+        MemoryAllocator* allocator;
+
+        VkBuffer buffer;
+        Allocation allocation;
+        char* pData;
+        VkCommandPool commandPool;
+
+        VkDeviceSize capacity;
+        VkDeviceSize maxChunkSize;
+        VkDeviceSize head = 0;
+        VkDeviceSize used = 0;
+        //ring space consumed by copies that are recorded but not yet submitted
+        VkDeviceSize pendingConsumed = 0;
+
+        std::vector<PendingCopy> pendingCopies;
+        std::deque<Batch> inFlightBatches;
+        std::vector<Batch> freeBatches;
+
+        VkDeviceSize bytesUploaded = 0;
+        uint32_t submitCount = 0;
+};
+
+
+#endif
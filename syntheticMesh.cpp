@@ -0,0 +1,35 @@
+#include "syntheticMesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+void makeSphereMesh(uint32_t triangleCount, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+
+    //rings times twice as many segments, two triangles per quad
+    uint32_t rings = std::max(2u, static_cast<uint32_t>(std::lround(std::sqrt(triangleCount / 4.0))));
+    uint32_t segments = 2 * rings;
+
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(size_t(rings + 1) * (segments + 1));
+    indices.reserve(size_t(rings) * segments * 6);
+
+    const float pi = 3.14159265f;
+    for(uint32_t r = 0; r <= rings; r++) {
+        float theta = pi * r / rings;
+        for(uint32_t s = 0; s <= segments; s++) {
+            float phi = 2.f * pi * s / segments;
+            glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            vertices.push_back({normal, glm::vec3(0.6f, 0.7f, 0.8f), normal});
+        }
+    }
+    //counter clockwise seen from outside
+    for(uint32_t r = 0; r < rings; r++) {
+        for(uint32_t s = 0; s < segments; s++) {
+            uint32_t a = r * (segments + 1) + s;
+            uint32_t b = a + segments + 1;
+            indices.insert(indices.end(), {a, a + 1, b, a + 1, b + 1, b});
+        }
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef SYNTHETICMESH_HPP
+#define SYNTHETICMESH_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex.hpp"
+
+
+//unit sphere of latitude rings with about triangleCount triangles (at least 16),
+//generated in place of an OBJ so benchmarks can pick any mesh size
+void makeSphereMesh(uint32_t triangleCount, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+
+#endif
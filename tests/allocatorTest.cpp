@@ -0,0 +1,376 @@
+//MemoryAllocator against a fake memory properties table and a fake backend, no GPU or
+//libvulkan needed: memory type selection, alignment, buddy split and merge, dedicated
+//allocations, block release, statistics and the defragmentation hooks. Exits non-zero when a
+//check fails.
+//Build and run with `make allocatortest`.
+
+#include "memoryAllocator.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+
+static int failures = 0;
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+static void check(bool condition, const char* text, int line) {
+    if(!condition) {
+        std::printf("FAILED line %d: %s\n", line, text);
+        failures++;
+    }
+}
+
+//hands out made up handles and, for mapped memory, host memory to point into
+class FakeMemoryBackend : public DeviceMemoryBackend {
+    public:
+        VkResult allocate(uint32_t, VkDeviceSize size, VkDeviceMemory* pMemory) override {
+            //handles are pointers or 64 bit integers depending on the platform
+            *pMemory = (VkDeviceMemory)(uintptr_t)nextHandle++;
+            memory[*pMemory] = std::vector<char>(size);
+            allocationCount++;
+            return VK_SUCCESS;
+        }
+        void free(VkDeviceMemory handle) override {
+            memory.erase(handle);
+        }
+        VkResult map(VkDeviceMemory handle, void** ppData) override {
+            *ppData = memory[handle].data();
+            mapCount++;
+            return VK_SUCCESS;
+        }
+        void unmap(VkDeviceMemory) override {
+            mapCount--;
+        }
+
+        size_t getLiveCount() {
+            return memory.size();
+        }
+        void* getBase(VkDeviceMemory handle) {
+            return memory[handle].data();
+        }
+
+        uint32_t allocationCount = 0;
+        int mapCount = 0;
+
+    private:
+        uintptr_t nextHandle = 1;
+        std::map<VkDeviceMemory, std::vector<char>> memory;
+};
+
+//a discrete GPU: device local VRAM, host visible coherent and host visible cached system memory
+static VkPhysicalDeviceMemoryProperties makeMemoryProperties() {
+
+    VkPhysicalDeviceMemoryProperties memProps = {};
+    memProps.memoryHeapCount = 2;
+    memProps.memoryHeaps[0].size = 256ull * 1024 * 1024;
+    memProps.memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    memProps.memoryHeaps[1].size = 1024ull * 1024 * 1024;
+    memProps.memoryTypeCount = 3;
+    memProps.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    memProps.memoryTypes[0].heapIndex = 0;
+    memProps.memoryTypes[1].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    memProps.memoryTypes[1].heapIndex = 1;
+    memProps.memoryTypes[2].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    memProps.memoryTypes[2].heapIndex = 1;
+    return memProps;
+}
+
+static VkMemoryRequirements makeRequirements(VkDeviceSize size, VkDeviceSize alignment, uint32_t typeBits = 0x7) {
+
+    VkMemoryRequirements memReqs = {};
+    memReqs.size = size;
+    memReqs.alignment = alignment;
+    memReqs.memoryTypeBits = typeBits;
+    return memReqs;
+}
+
+static void testMemoryTypes() {
+
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator(makeMemoryProperties(), &backend);
+
+    CHECK(allocator.findMemoryType(0x7, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == 0);
+    //no unrequested cached bit without asking, the cached type when it is preferred
+    CHECK(allocator.findMemoryType(0x7, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 1);
+    CHECK(allocator.findMemoryType(0x7, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT) == 2);
+    //typeBits leave out type 1
+    CHECK(allocator.findMemoryType(0x5, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 2);
+
+    bool threw = false;
+    try {
+        allocator.findMemoryType(0x1, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    } catch(const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+static void testBuddySplitAndMerge() {
+
+    BuddyBlock block(4096, 256);
+    CHECK(block.getNodeSize(0) == 4096);
+    CHECK(block.getNodeSize(4) == 256);
+
+    //the first small node splits the whole block down to 256 bytes
+    VkDeviceSize offsets[16];
+    uint32_t levels[16];
+    CHECK(block.allocate(200, 1, offsets[0], levels[0]));
+    CHECK(offsets[0] == 0 && levels[0] == 4);
+    //its buddy is next, then the free halves of the levels above
+    CHECK(block.allocate(256, 1, offsets[1], levels[1]));
+    CHECK(offsets[1] == 256 && levels[1] == 4);
+    CHECK(block.allocate(1024, 1, offsets[2], levels[2]));
+    CHECK(offsets[2] == 1024 && levels[2] == 2);
+
+    //nothing of 4096 while any part is taken
+    VkDeviceSize offset;
+    uint32_t level;
+    CHECK(!block.allocate(4096, 1, offset, level));
+
+    //freeing buddies merges them back up to the whole block
+    block.free(offsets[1], levels[1]);
+    block.free(offsets[0], levels[0]);
+    block.free(offsets[2], levels[2]);
+    CHECK(block.allocate(4096, 1, offset, level));
+    CHECK(offset == 0 && level == 0);
+    block.free(offset, level);
+
+    //sixteen minimum nodes fill it, and all come back
+    for(int i = 0; i < 16; i++) {
+        CHECK(block.allocate(1, 1, offsets[i], levels[i]));
+    }
+    CHECK(!block.allocate(1, 1, offset, level));
+    for(int i = 15; i >= 0; i--) {
+        block.free(offsets[i], levels[i]);
+    }
+    CHECK(block.allocate(4096, 1, offset, level));
+    CHECK(!block.allocate(5000, 1, offset, level));
+}
+
+static void testAlignment() {
+
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator(makeMemoryProperties(), &backend, 1024 * 1024);
+
+    //small resources with large alignments, e.g. images, and odd sizes between them
+    std::vector<Allocation> allocations;
+    std::vector<VkDeviceSize> alignments;
+    const VkDeviceSize sizes[] = {100, 256, 4096, 300, 256, 65536, 1000, 256};
+    const VkDeviceSize aligns[] = {4096, 256, 256, 64, 65536, 256, 1, 4096};
+    for(int i = 0; i < 8; i++) {
+        allocations.push_back(allocator.allocate(makeRequirements(sizes[i], aligns[i]), RESOURCE_KIND_IMAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+        alignments.push_back(aligns[i]);
+    }
+    for(size_t i = 0; i < allocations.size(); i++) {
+        CHECK(allocations[i].offset % alignments[i] == 0);
+        CHECK(allocations[i].size == sizes[i]);
+        CHECK(allocations[i].blockIndex != ALLOCATION_DEDICATED);
+        //no two ranges in the same memory overlap
+        for(size_t j = 0; j < i; j++) {
+            if(allocations[i].memory == allocations[j].memory) {
+                CHECK(allocations[i].offset + allocations[i].size <= allocations[j].offset || allocations[j].offset + allocations[j].size <= allocations[i].offset);
+            }
+        }
+    }
+    for(Allocation &allocation : allocations) {
+        allocator.free(allocation);
+        CHECK(allocation.memory == VK_NULL_HANDLE);
+    }
+}
+
+static void testDedicated() {
+
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator(makeMemoryProperties(), &backend, 1024 * 1024);
+
+    //more than half a block gets memory of its own, mapped when host visible
+    Allocation large = allocator.allocate(makeRequirements(600 * 1024, 256), RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    CHECK(large.blockIndex == ALLOCATION_DEDICATED);
+    CHECK(large.offset == 0 && large.size == 600 * 1024);
+    CHECK(large.memoryTypeIndex == 1);
+    CHECK(large.pMapped == backend.getBase(large.memory));
+    CHECK(backend.getLiveCount() == 1);
+
+    MemoryStats stats = allocator.getStats();
+    CHECK(stats.types[1].dedicatedCount == 1 && stats.types[1].blockCount == 0);
+    CHECK(stats.reservedBytes == 600 * 1024);
+
+    allocator.free(large);
+    CHECK(backend.getLiveCount() == 0);
+    CHECK(backend.mapCount == 0);
+    CHECK(allocator.getStats().deviceAllocationCount == 0);
+}
+
+static void testBlockRelease() {
+
+    FakeMemoryBackend backend;
+    {
+        MemoryAllocator allocator(makeMemoryProperties(), &backend, 1024 * 1024);
+        VkMemoryRequirements half = makeRequirements(512 * 1024, 256);
+
+        //two halves fill the first block, the third opens a second one
+        Allocation a = allocator.allocate(half, RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        Allocation b = allocator.allocate(half, RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        CHECK(a.memory == b.memory && a.offset != b.offset);
+        CHECK((char*)b.pMapped - (char*)a.pMapped == (ptrdiff_t)b.offset - (ptrdiff_t)a.offset);
+        CHECK(backend.getLiveCount() == 1);
+        Allocation c = allocator.allocate(half, RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        CHECK(c.memory != a.memory);
+        CHECK(backend.getLiveCount() == 2);
+
+        //buffers and images never share a block
+        Allocation image = allocator.allocate(makeRequirements(256, 256), RESOURCE_KIND_IMAGE, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        CHECK(image.memory != a.memory && image.memory != c.memory);
+        CHECK(backend.getLiveCount() == 3);
+        allocator.free(image);
+
+        //an empty block goes back to the driver while another block of its pool remains
+        allocator.free(c);
+        CHECK(backend.getLiveCount() == 2);
+        allocator.free(a);
+        allocator.free(b);
+        CHECK(backend.getLiveCount() == 2);
+
+        //the kept block is reused instead of allocating again
+        uint32_t before = backend.allocationCount;
+        Allocation d = allocator.allocate(half, RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        CHECK(backend.allocationCount == before);
+        allocator.free(d);
+    }
+    //the destructor releases the blocks that were kept
+    CHECK(backend.getLiveCount() == 0);
+    CHECK(backend.mapCount == 0);
+}
+
+static void testStats() {
+
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator(makeMemoryProperties(), &backend, 1024 * 1024);
+
+    //300 bytes round up to a 512 byte node, 256 bytes aligned to 4096 take a 4096 byte node
+    Allocation a = allocator.allocate(makeRequirements(300, 4), RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    Allocation b = allocator.allocate(makeRequirements(256, 4096), RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    Allocation c = allocator.allocate(makeRequirements(800 * 1024, 256), RESOURCE_KIND_IMAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    MemoryStats stats = allocator.getStats();
+    MemoryTypeStats &type = stats.types[0];
+    CHECK(stats.types.size() == 3);
+    CHECK(type.blockCount == 1);
+    CHECK(type.dedicatedCount == 1);
+    CHECK(type.allocationCount == 3);
+    CHECK(type.reservedBytes == 1024 * 1024 + 800 * 1024);
+    CHECK(type.allocatedBytes == 512 + 4096 + 800 * 1024);
+    CHECK(type.requestedBytes == 300 + 256 + 800 * 1024);
+    CHECK(stats.deviceAllocationCount == 2);
+    CHECK(stats.totalDeviceAllocations == 2);
+    CHECK(stats.reservedBytes == type.reservedBytes);
+    CHECK(stats.types[1].reservedBytes == 0 && stats.types[2].reservedBytes == 0);
+
+    allocator.free(a);
+    allocator.free(b);
+    allocator.free(c);
+    stats = allocator.getStats();
+    //the last block of the pool is kept, so it is still reserved
+    CHECK(stats.allocatedBytes == 0 && stats.requestedBytes == 0);
+    CHECK(stats.types[0].blockCount == 1 && stats.types[0].allocationCount == 0);
+    CHECK(stats.reservedBytes == 1024 * 1024);
+    CHECK(stats.totalDeviceAllocations == 2);
+}
+
+static void testDefragmentation() {
+
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator(makeMemoryProperties(), &backend, 1024 * 1024);
+    VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+    //two halves fill block 0, two aligned allocations go to block 1, then block 0 gets a hole
+    //that starts with a small unaligned allocation
+    Allocation a = allocator.allocate(makeRequirements(512 * 1024, 256), RESOURCE_KIND_BUFFER, hostVisible);
+    Allocation b = allocator.allocate(makeRequirements(512 * 1024, 256), RESOURCE_KIND_BUFFER, hostVisible);
+    Allocation c = allocator.allocate(makeRequirements(200 * 1024, 65536), RESOURCE_KIND_BUFFER, hostVisible);
+    Allocation d = allocator.allocate(makeRequirements(1000, 4096), RESOURCE_KIND_BUFFER, hostVisible);
+    Allocation dedicated = allocator.allocate(makeRequirements(600 * 1024, 256), RESOURCE_KIND_BUFFER, hostVisible);
+    CHECK(c.blockIndex == 1 && d.blockIndex == 1);
+    allocator.free(a);
+    Allocation small = allocator.allocate(makeRequirements(256, 1), RESOURCE_KIND_BUFFER, hostVisible);
+    CHECK(small.memory == b.memory);
+    CHECK(backend.getLiveCount() == 3);
+
+    //every sub-allocation is listed with its requirements, dedicated ones are not
+    std::vector<Allocation> live = allocator.getLiveAllocations();
+    CHECK(live.size() == 4);
+    for(const Allocation &allocation : live) {
+        CHECK(allocation.blockIndex != ALLOCATION_DEDICATED);
+        if(allocation.memory == c.memory && allocation.offset == c.offset) {
+            CHECK(allocation.size == c.size && allocation.alignment == 65536 && allocation.level == c.level);
+        }
+    }
+
+    //nothing comes before block 0 and dedicated memory doesn't move
+    Allocation destination;
+    CHECK(!allocator.allocateMoveDestination(b, destination));
+    CHECK(!allocator.allocateMoveDestination(dedicated, destination));
+
+    //block 1 moves into the hole of block 0, keeping alignment and contents
+    for(Allocation &source : live) {
+        if(source.blockIndex != 1) {
+            continue;
+        }
+        std::memset(source.pMapped, 0x5a, source.size);
+        CHECK(allocator.allocateMoveDestination(source, destination));
+        CHECK(destination.memory == b.memory && destination.blockIndex == 0);
+        CHECK(destination.offset % source.alignment == 0);
+        CHECK(destination.size == source.size && destination.alignment == source.alignment);
+        CHECK(destination.offset + destination.size <= b.offset || b.offset + b.size <= destination.offset);
+        std::memcpy(destination.pMapped, source.pMapped, source.size);
+        allocator.free(source);
+        CHECK(static_cast<unsigned char*>(destination.pMapped)[destination.size - 1] == 0x5a);
+    }
+
+    //the emptied block went back to the driver and the moved ranges are live in block 0
+    CHECK(backend.getLiveCount() == 2);
+    live = allocator.getLiveAllocations();
+    CHECK(live.size() == 4);
+    for(const Allocation &allocation : live) {
+        CHECK(allocation.blockIndex == 0);
+    }
+    MemoryStats stats = allocator.getStats();
+    CHECK(stats.types[1].allocationCount == 5 && stats.types[1].blockCount == 1);
+    CHECK(stats.requestedBytes == 512 * 1024 + 256 + 200 * 1024 + 1000 + 600 * 1024);
+
+    //no room left in block 0 for another half, the source stays as it was
+    Allocation e = allocator.allocate(makeRequirements(512 * 1024, 256), RESOURCE_KIND_BUFFER, hostVisible);
+    CHECK(e.blockIndex == 1);
+    CHECK(!allocator.allocateMoveDestination(e, destination));
+    CHECK(allocator.getLiveAllocations().size() == 5);
+
+    allocator.free(e);
+    for(Allocation &allocation : live) {
+        allocator.free(allocation);
+    }
+    allocator.free(dedicated);
+    CHECK(allocator.getStats().requestedBytes == 0);
+}
+
+int main() {
+
+    testMemoryTypes();
+    testBuddySplitAndMerge();
+    testAlignment();
+    testDedicated();
+    testBlockRelease();
+    testStats();
+    testDefragmentation();
+
+    if(failures > 0) {
+        std::printf("allocator tests: %d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("allocator tests passed\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "threadPool.hpp"
+
+#include <atomic>
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+
+    if(threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(threadCount);
+    for(uint32_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for(std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task) {
+
+    std::packaged_task<void()> packagedTask(std::move(task));
+    std::future<void> future = packagedTask.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(packagedTask));
+    }
+    condition.notify_one();
+    return future;
+}
+
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)> &task) {
+
+    //one task per worker, each pulling indices until they run out
+    std::atomic<uint32_t> next(0);
+    uint32_t taskCount = std::min(count, getThreadCount());
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(taskCount);
+    for(uint32_t t = 0; t < taskCount; t++) {
+        futures.push_back(submit([&]() {
+            for(uint32_t i = next++; i < count; i = next++) {
+                task(i);
+            }
+        }));
+    }
+
+    //wait for all of them before rethrowing, they reference this frame
+    for(std::future<void> &future : futures) {
+        future.wait();
+    }
+    for(std::future<void> &future : futures) {
+        future.get();
+    }
+}
+
+uint32_t ThreadPool::getThreadCount() {
+    return static_cast<uint32_t>(workers.size());
+}
+
+void ThreadPool::workerLoop() {
+
+    while(true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() {return stopping || !tasks.empty();});
+            if(tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <cstdint>
+
+
+//fixed set of worker threads pulling tasks from one queue.
+//Exceptions thrown by a task are rethrown from its future.
+class ThreadPool {
+    public:
+        //0 starts one worker per hardware thread
+        explicit ThreadPool(uint32_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        std::future<void> submit(std::function<void()> task);
+        //runs task(i) for every i in [0, count) on the workers and returns once all are done
+        void parallelFor(uint32_t count, const std::function<void(uint32_t)> &task);
+
+        uint32_t getThreadCount();
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread> workers;
+        std::deque<std::packaged_task<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+};
+
+
+#endif
@@ -0,0 +1,89 @@
+//offline converter from OBJ to the binary mesh format read by MeshCache.
+//build with `make meshconv`, then
+//    tools/meshconv -o scene.vmesh [--scale S] [--no-optimize] a.obj [b.obj ...]
+//writes every input as its own mesh range in one file, each optimized as the app does on import.
+
+#include "obj.hpp"
+#include "meshCache.hpp"
+#include "hash.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+int main(int argc, char** argv) {
+
+    std::string outPath;
+    std::vector<std::string> inputs;
+    ObjOptions options;
+    bool optimize = true;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            options.scale = std::stof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--no-optimize") == 0) {
+            optimize = false;
+        }
+        else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if(outPath.empty() || inputs.empty()) {
+        std::cerr << "usage: meshconv -o OUT.vmesh [--scale S] [--no-optimize] IN.obj...\n";
+        return 1;
+    }
+
+    try {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::vector<Vertex> verts;
+        std::vector<uint32_t> idx;
+        std::vector<MeshRange> meshes;
+        uint64_t sourceHash = 0;
+
+        for(const std::string &input : inputs) {
+            std::vector<Vertex> meshVerts;
+            std::vector<uint32_t> meshIdx;
+            obj(input, meshVerts, meshIdx, options);
+            MeshOptimizeReport report;
+            if(optimize) {
+                report = optimizeMesh(meshVerts, meshIdx);
+            }
+
+            uint32_t firstVertex = static_cast<uint32_t>(verts.size());
+            uint32_t firstIndex = static_cast<uint32_t>(idx.size());
+            verts.insert(verts.end(), meshVerts.begin(), meshVerts.end());
+            for(uint32_t index : meshIdx) {
+                idx.push_back(index + firstVertex);
+            }
+            meshes.push_back(MeshCache::makeRange(verts.data(), firstVertex, static_cast<uint32_t>(meshVerts.size()), firstIndex, static_cast<uint32_t>(meshIdx.size())));
+
+            sourceHash = MeshCache::hashFile(input, sourceHash);
+            std::cout << input << ": " << meshVerts.size() << " vertices, " << meshIdx.size() / 3 << " triangles";
+            if(optimize) {
+                std::cout << ", ACMR " << report.before.acmr << " -> " << report.after.acmr << ", ATVR " << report.before.atvr << " -> " << report.after.atvr;
+            }
+            std::cout << '\n';
+        }
+        sourceHash = hashBytes(&options.scale, sizeof(options.scale), sourceHash);
+        sourceHash = hashBytes(&options.color, sizeof(options.color), sourceHash);
+        sourceHash = hashBytes(&optimize, sizeof(optimize), sourceHash);
+
+        MeshCache::write(outPath, verts.data(), verts.size(), idx.data(), idx.size(), meshes, sourceHash);
+
+        std::cout << "wrote " << outPath << " (" << meshes.size() << " meshes) in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
+    } catch(const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
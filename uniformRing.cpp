@@ -0,0 +1,75 @@
+#include "uniformRing.hpp"
+
+#include <stdexcept>
+
+
+UniformRing::UniformRing(VkDevice device, MemoryAllocator* allocator, VkDeviceSize regionSize, uint32_t regionCount, VkDeviceSize alignment)
+    : device(device), allocator(allocator), regionCount(regionCount), alignment(alignment) {
+
+    //regions start on an aligned offset too, so offsets within them stay aligned
+    this->regionSize = (regionSize + alignment - 1) / alignment * alignment;
+    if(this->regionSize * regionCount > UINT32_MAX) {
+        throw std::runtime_error("Uniform ring does not fit in 32 bit dynamic offsets.");
+    }
+
+    heads.reset(new std::atomic<VkDeviceSize>[regionCount]);
+    for(uint32_t i = 0; i < regionCount; i++) {
+        heads[i] = 0;
+    }
+
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    bufferCreateInfo.size = this->regionSize * regionCount;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create uniform ring buffer.");
+    }
+
+    VkMemoryRequirements memReqs;
+    vkGetBufferMemoryRequirements(device, buffer, &memReqs);
+
+    allocation = allocator->allocate(memReqs, RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if(vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("Could not bind uniform ring memory.");
+    }
+    pData = static_cast<char*>(allocation.pMapped);
+}
+
+UniformRing::~UniformRing() {
+
+    vkDestroyBuffer(device, buffer, nullptr);
+    allocator->free(allocation);
+}
+
+void UniformRing::reset(uint32_t region) {
+    heads[region].store(0, std::memory_order_relaxed);
+}
+
+uint32_t UniformRing::allocate(uint32_t region, VkDeviceSize size) {
+
+    VkDeviceSize alignedSize = (size + alignment - 1) / alignment * alignment;
+    VkDeviceSize head = heads[region].fetch_add(alignedSize, std::memory_order_relaxed);
+    if(head + alignedSize > regionSize) {
+        throw std::runtime_error("Uniform ring region is full.");
+    }
+
+    VkDeviceSize peak = peakUsage.load(std::memory_order_relaxed);
+    while(head + alignedSize > peak && !peakUsage.compare_exchange_weak(peak, head + alignedSize, std::memory_order_relaxed)) {
+    }
+
+    return static_cast<uint32_t>(region * regionSize + head);
+}
+
+void* UniformRing::getPointer(uint32_t offset) {
+    return pData + offset;
+}
+
+VkBuffer UniformRing::getBuffer() {
+    return buffer;
+}
+
+VkDeviceSize UniformRing::getPeakUsage() {
+    return peakUsage.load(std::memory_order_relaxed);
+}
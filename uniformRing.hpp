@@ -0,0 +1,60 @@
+#ifndef UNIFORMRING_HPP
+#define UNIFORMRING_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <memory>
+#include <cstring>
+
+#include "memoryAllocator.hpp"
+
+
+//persistently mapped buffer for transient uniform data, split into one region per command
+//buffer slot. Allocations bump the region's head with a single atomic add, so any number
+//of recording threads can fill the same region without locks. Every allocation is aligned
+//to the device's dynamic offset alignment, so its offset can be used as a dynamic offset.
+//A region is reset once the GPU has finished with the commands that read it.
+class UniformRing {
+    public:
+        UniformRing(VkDevice device, MemoryAllocator* allocator, VkDeviceSize regionSize, uint32_t regionCount, VkDeviceSize alignment);
+        ~UniformRing();
+
+        UniformRing(const UniformRing&) = delete;
+        UniformRing& operator=(const UniformRing&) = delete;
+
+        //only once the fence of the last submission reading the region has signaled
+        void reset(uint32_t region);
+
+        //returns the offset from the start of the buffer, throws when the region is full
+        uint32_t allocate(uint32_t region, VkDeviceSize size);
+        //copy value into a new allocation
+        template<typename T>
+        uint32_t push(uint32_t region, const T &value) {
+            uint32_t offset = allocate(region, sizeof(T));
+            std::memcpy(pData + offset, &value, sizeof(T));
+            return offset;
+        }
+        void* getPointer(uint32_t offset);
+
+        VkBuffer getBuffer();
+        //largest number of bytes any region held since creation
+        VkDeviceSize getPeakUsage();
+
+    private:
+        VkDevice device;
+        MemoryAllocator* allocator;
+
+        VkBuffer buffer;
+        Allocation allocation;
+        char* pData;
+
+        VkDeviceSize regionSize;
+        uint32_t regionCount;
+        VkDeviceSize alignment;
+        std::unique_ptr<std::atomic<VkDeviceSize>[]> heads;
+        std::atomic<VkDeviceSize> peakUsage{0};
+};
+
+
+#endif
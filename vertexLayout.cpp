@@ -0,0 +1,80 @@
+#include "vertexLayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+uint16_t floatToHalf(float value) {
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    //NaN stays NaN, everything too large for a half becomes infinity
+    if(magnitude > 0x7f800000) {
+        return sign | 0x7e00;
+    }
+    if(magnitude >= 0x477ff000) {
+        return sign | 0x7c00;
+    }
+    //too small even for a denormal half
+    if(magnitude < 0x33000000) {
+        return sign;
+    }
+
+    int32_t exponent = static_cast<int32_t>(magnitude >> 23) - 127 + 15;
+    uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+    uint32_t shift = exponent > 0 ? 13 : static_cast<uint32_t>(14 - exponent);
+    uint32_t half = exponent > 0 ? (static_cast<uint32_t>(exponent) << 10) | ((mantissa >> 13) & 0x3ff) : mantissa >> shift;
+
+    //round to nearest even, a carry out of the mantissa correctly bumps the exponent
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if(remainder > halfway || (remainder == halfway && (half & 1))) {
+        half++;
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+int16_t floatToSnorm16(float value) {
+    return static_cast<int16_t>(std::lround(std::max(-1.f, std::min(1.f, value)) * 32767.f));
+}
+
+Snorm16x2 encodeOctahedral(glm::vec3 normal) {
+
+    float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if(sum == 0.f) {
+        return {0, 0};
+    }
+    glm::vec2 folded(normal.x / sum, normal.y / sum);
+
+    //the lower hemisphere is folded over the diagonals
+    if(normal.z < 0.f) {
+        glm::vec2 mirrored((1.f - std::fabs(folded.y)) * (folded.x >= 0.f ? 1.f : -1.f), (1.f - std::fabs(folded.x)) * (folded.y >= 0.f ? 1.f : -1.f));
+        folded = mirrored;
+    }
+    return {floatToSnorm16(folded.x), floatToSnorm16(folded.y)};
+}
+
+FullVertex FullVertex::encode(const Vertex &vertex, uint32_t, float) {
+    return {vertex.pos, vertex.color, vertex.normal};
+}
+
+HalfVertex HalfVertex::encode(const Vertex &vertex, uint32_t material, float) {
+
+    HalfVertex encoded;
+    encoded.pos = {floatToHalf(vertex.pos.x), floatToHalf(vertex.pos.y), floatToHalf(vertex.pos.z), floatToHalf(static_cast<float>(material))};
+    encoded.normal = encodeOctahedral(vertex.normal);
+    return encoded;
+}
+
+Snorm16Vertex Snorm16Vertex::encode(const Vertex &vertex, uint32_t material, float positionScale) {
+
+    Snorm16Vertex encoded;
+    glm::vec3 scaled = vertex.pos / positionScale;
+    encoded.pos = {floatToSnorm16(scaled.x), floatToSnorm16(scaled.y), floatToSnorm16(scaled.z), static_cast<int16_t>(material)};
+    encoded.normal = encodeOctahedral(vertex.normal);
+    return encoded;
+}
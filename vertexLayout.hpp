@@ -0,0 +1,134 @@
+#ifndef VERTEXLAYOUT_HPP
+#define VERTEXLAYOUT_HPP
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "vertex.hpp"
+
+//materials the compressed layouts can index, their colors live in the VP uniform
+#define MAX_MATERIALS 16
+
+
+//GPU side vertex layouts. Vertex stays the working format on the CPU (parsing, LODs, picking)
+//and is encoded into one of these when the vertex buffer is uploaded.
+//Every layout provides locations 0 to 2 (position, color, normal) so one vertex shader, told
+//the layout by a specialization constant, reads all of them.
+
+//packed attribute types, each maps to its Vulkan format below
+struct Half4 {
+    uint16_t x, y, z, w;
+};
+
+struct Snorm16x4 {
+    int16_t x, y, z, w;
+};
+
+struct Snorm16x2 {
+    int16_t x, y;
+};
+
+template<typename T>
+struct AttributeFormat;
+
+template<>
+struct AttributeFormat<glm::vec3> {
+    static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+};
+
+template<>
+struct AttributeFormat<Half4> {
+    static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
+};
+
+template<>
+struct AttributeFormat<Snorm16x4> {
+    static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SNORM;
+};
+
+template<>
+struct AttributeFormat<Snorm16x2> {
+    static constexpr VkFormat format = VK_FORMAT_R16G16_SNORM;
+};
+
+//the format follows the member's type, so changing a layout can't leave its description behind
+template<typename Attribute>
+constexpr VkVertexInputAttributeDescription vertexAttribute(uint32_t location, size_t offset) {
+    return {location, 0, AttributeFormat<Attribute>::format, static_cast<uint32_t>(offset)};
+}
+
+uint16_t floatToHalf(float value);
+int16_t floatToSnorm16(float value);
+//unit vector folded onto the octahedron and flattened to two snorm16 components
+Snorm16x2 encodeOctahedral(glm::vec3 normal);
+
+
+//the uncompressed layout, 36 bytes, a copy of Vertex
+struct FullVertex {
+    glm::vec3 pos;
+    glm::vec3 color;
+    glm::vec3 normal;
+
+    static FullVertex encode(const Vertex &vertex, uint32_t material, float positionScale);
+};
+
+//12 bytes: half float position with the material index in w, octahedral normal.
+//Half floats keep 11 bits of mantissa, so precision drops the further a vertex is from the origin.
+struct HalfVertex {
+    Half4 pos;
+    Snorm16x2 normal;
+
+    static HalfVertex encode(const Vertex &vertex, uint32_t material, float positionScale);
+};
+
+//12 bytes: position as snorm16 of the scene's largest coordinate, so precision is the same
+//everywhere, with the material index in w, octahedral normal
+struct Snorm16Vertex {
+    Snorm16x4 pos;
+    Snorm16x2 normal;
+
+    static Snorm16Vertex encode(const Vertex &vertex, uint32_t material, float positionScale);
+};
+
+static_assert(sizeof(FullVertex) == 36, "FullVertex must match Vertex");
+static_assert(sizeof(HalfVertex) == 12, "HalfVertex must stay packed");
+static_assert(sizeof(Snorm16Vertex) == 12, "Snorm16Vertex must stay packed");
+
+
+template<typename Layout>
+struct VertexLayoutTraits;
+
+template<>
+struct VertexLayoutTraits<FullVertex> {
+    static constexpr std::array<VkVertexInputAttributeDescription, 3> attributes = {{
+        vertexAttribute<decltype(FullVertex::pos)>(0, offsetof(FullVertex, pos)),
+        vertexAttribute<decltype(FullVertex::color)>(1, offsetof(FullVertex, color)),
+        vertexAttribute<decltype(FullVertex::normal)>(2, offsetof(FullVertex, normal))
+    }};
+};
+
+//color is per material in the compressed layouts, location 1 reads the position again and is unused
+template<>
+struct VertexLayoutTraits<HalfVertex> {
+    static constexpr std::array<VkVertexInputAttributeDescription, 3> attributes = {{
+        vertexAttribute<decltype(HalfVertex::pos)>(0, offsetof(HalfVertex, pos)),
+        vertexAttribute<decltype(HalfVertex::pos)>(1, offsetof(HalfVertex, pos)),
+        vertexAttribute<decltype(HalfVertex::normal)>(2, offsetof(HalfVertex, normal))
+    }};
+};
+
+template<>
+struct VertexLayoutTraits<Snorm16Vertex> {
+    static constexpr std::array<VkVertexInputAttributeDescription, 3> attributes = {{
+        vertexAttribute<decltype(Snorm16Vertex::pos)>(0, offsetof(Snorm16Vertex, pos)),
+        vertexAttribute<decltype(Snorm16Vertex::pos)>(1, offsetof(Snorm16Vertex, pos)),
+        vertexAttribute<decltype(Snorm16Vertex::normal)>(2, offsetof(Snorm16Vertex, normal))
+    }};
+};
+
+
+#endif
@@ -8,19 +8,51 @@
 #include "glm/gtx/string_cast.hpp"
 #include <cstring>
 #include <fstream>
+#include <chrono>
+#include <numeric>
+#include <cmath>
+#include "spirv.hpp"
 
 
 #include <vulkan/vulkan_core.h>
 
 
-VulkanBase::VulkanBase(Window* pWindow, Scene* pScene, bool enableValidationLayers) : pWindow(pWindow), pScene(pScene), enableValidationLayers(enableValidationLayers) {
+//fixed function permutations of the main graphics pipeline, all built at startup
+static const GraphicsVariant graphicsVariants[GRAPHICS_VARIANT_COUNT] = {
+    {"default", VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, true, false},
+    {"wireframe", VK_POLYGON_MODE_LINE, VK_CULL_MODE_NONE, true, false},
+    {"depth only", VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, false, false},
+    {"shadow", VK_POLYGON_MODE_FILL, VK_CULL_MODE_FRONT_BIT, false, true},
+    {"two sided", VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, true, false},
+};
+
+//objects, instances, models, VP, visible world matrices, draw commands, draw count, levels of detail
+static const VkDescriptorType cullBindingTypes[8] = {
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+};
+
 
-vertices = *(pScene->getVerts());
-indices = *(pScene->getInds());
+VulkanBase::VulkanBase(Window* pWindow, Scene* pScene, bool enableValidationLayers, Settings settings) : enableValidationLayers(enableValidationLayers), settings(settings), pScene(pScene), pWindow(pWindow) {
+
+if(settings.headless) {
+    //offscreen targets need neither a surface nor a swapchain
+    requiredDeviceExtensions.clear();
+}
+if(settings.targetGpuMs > 0.f) {
+    resolutionScaler = new ResolutionScaler(settings.targetGpuMs, settings.minRenderScale);
+}
 
 };
 
 void VulkanBase::createInstance() {
+    CPU_ZONE("createInstance");
 
     VkApplicationInfo appInfo = {};
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -113,6 +145,9 @@ std::vector<const char*> VulkanBase::getRequiredLayers(bool print) {
 
 std::vector<const char*> VulkanBase::getRequiredInstanceExtensions(bool print) {
 
+    if(settings.headless) {
+        return {};
+    }
     return pWindow->getRequiredVulkanExtensions(print);
 }
 
@@ -134,6 +169,7 @@ std::vector<VkExtensionProperties> VulkanBase::getAvailableInstanceExtensions(bo
 
 
 void VulkanBase::createLogicalDevice() {
+    CPU_ZONE("createLogicalDevice");
 
     findSuitablePhysicalDevice(true);
 
@@ -159,13 +195,49 @@ void VulkanBase::createLogicalDevice() {
     createInfo.ppEnabledLayerNames = requiredLayers.data();
     createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size());
     createInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
-    createInfo.pEnabledFeatures = nullptr;
+    VkPhysicalDeviceFeatures enabledFeatures = {};
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    //the wireframe pipeline variant is skipped without it
+    enabledFeatures.fillModeNonSolid = supportedFeatures.fillModeNonSolid;
+    fillModeNonSolidSupported = supportedFeatures.fillModeNonSolid == VK_TRUE;
+    if(settings.wireframe && !fillModeNonSolidSupported) {
+        throw std::runtime_error("Could not enable wireframe rendering: fillModeNonSolid is not supported.");
+    }
+    if(settings.gpuDriven) {
+        //every visible object's draw points at its own instance slot
+        if(!supportedFeatures.drawIndirectFirstInstance) {
+            throw std::runtime_error("Could not enable GPU driven rendering: drawIndirectFirstInstance is not supported.");
+        }
+        enabledFeatures.drawIndirectFirstInstance = VK_TRUE;
+        enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect == VK_TRUE;
+
+        drawIndirectCountSupported = settings.indirectCount && isDeviceExtensionAvailable("VK_KHR_draw_indirect_count");
+        if(drawIndirectCountSupported) {
+            requiredDeviceExtensions.push_back("VK_KHR_draw_indirect_count");
+            createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size());
+            createInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
+        }
+    }
+    createInfo.pEnabledFeatures = &enabledFeatures;
 
     if(vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
         throw std::runtime_error("failed to create logical device.");
     } 
     vkGetDeviceQueue(device, graphicsQueueIndex, 0, &graphicsQueue);
     vkGetDeviceQueue(device, presentQueueIndex, 0, &presentQueue);
+    vkGetDeviceQueue(device, transferQueueIndex, 0, &transferQueue);
+
+    if(drawIndirectCountSupported) {
+        pfnCmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+        drawIndirectCountSupported = pfnCmdDrawIndexedIndirectCount != nullptr;
+    }
+
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps);
+    memoryBackend = new VulkanMemoryBackend(device);
+    allocator = new MemoryAllocator(memProps, memoryBackend);
 }
 
 void VulkanBase::findSuitablePhysicalDevice(bool print) {
@@ -199,7 +271,11 @@ void VulkanBase::findSuitablePhysicalDevice(bool print) {
                 physicalDeviceIdx = i;
                 graphicsQueueIndex = static_cast<uint32_t>(k);
                 foundGraphicsQueue = true;
+                timestampValidBits = queueProperties[k].timestampValidBits;
             } 
+            if(settings.headless) {
+                continue;
+            }
             VkBool32 presentSupport;
             vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevices[i], static_cast<uint32_t>(k), surface, &presentSupport);
 
@@ -209,17 +285,52 @@ void VulkanBase::findSuitablePhysicalDevice(bool print) {
             }
         }
     }
+    if(settings.headless) {
+        //nothing is presented, the graphics queue stands in for the present queue
+        presentQueueIndex = graphicsQueueIndex;
+        foundPresentQueue = foundGraphicsQueue;
+    }
     if (!foundGraphicsQueue || !foundPresentQueue || !checkPhysicalDeviceExtensions(true)) {
         throw std::runtime_error("Could not find suitable physical device.");
     }
 
-    uniqueQueues = {graphicsQueueIndex, presentQueueIndex};
+    //prefer a transfer only family (a DMA engine on discrete GPUs) for uploads
+    transferQueueIndex = graphicsQueueIndex;
+    uint32_t queueCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueProperties(queueCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueCount, queueProperties.data());
+    for(uint32_t k = 0; k < queueCount; k++) {
+        VkQueueFlags flags = queueProperties[k].queueFlags;
+        if((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            transferQueueIndex = k;
+            break;
+        }
+    }
+
+    uniqueQueues = {graphicsQueueIndex, presentQueueIndex, transferQueueIndex};
+    deviceName = physicalDeviceProperties[physicalDeviceIdx].deviceName;
 
     if(print) {
         std::cout << "Found suitable device: " << physicalDeviceProperties[physicalDeviceIdx].deviceName << std::endl;
     }
 }
 
+bool VulkanBase::isDeviceExtensionAvailable(const char* extensionName) {
+
+    uint32_t propertyCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &propertyCount, nullptr);
+    std::vector<VkExtensionProperties> extensionProperties(propertyCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &propertyCount, extensionProperties.data());
+
+    for(VkExtensionProperties properties : extensionProperties) {
+        if(strcmp(properties.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool VulkanBase::checkPhysicalDeviceExtensions(bool print) {
 
     uint32_t propertyCount;
@@ -246,6 +357,12 @@ bool VulkanBase::checkPhysicalDeviceExtensions(bool print) {
 }
 
 void VulkanBase::createSurface() {
+    CPU_ZONE("createSurface");
+
+    if(settings.headless) {
+        surface = VK_NULL_HANDLE;
+        return;
+    }
 
     if(SDL_Vulkan_CreateSurface(pWindow->getWindow(), instance, &surface) != SDL_TRUE) {
         throw std::runtime_error("Could not create surface.");
@@ -253,13 +370,20 @@ void VulkanBase::createSurface() {
 }
 
 void VulkanBase::createSwapchain() {
+    CPU_ZONE("createSwapchain");
+
+    if(settings.headless) {
+        createOffscreenTargets();
+        return;
+    }
     
     VkSurfaceCapabilitiesKHR surfaceCapabilities;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities);
 
     surfaceFormat = getSurfaceFormat();
     uint32_t minImageCount = getMinImageCount(surfaceCapabilities);
-    VkExtent2D swapExtent = getSwapExtent(surfaceCapabilities);
+    extent = getSwapExtent(surfaceCapabilities);
+    renderExtent = extent;
     VkPresentModeKHR presentMode = getPresentMode();
 
     VkSwapchainCreateInfoKHR swapchainInfo = {};
@@ -269,9 +393,16 @@ void VulkanBase::createSwapchain() {
     swapchainInfo.minImageCount = minImageCount;
     swapchainInfo.imageFormat = surfaceFormat.format;
     swapchainInfo.imageColorSpace = surfaceFormat.colorSpace;
-    swapchainInfo.imageExtent = swapExtent;
+    swapchainInfo.imageExtent = extent;
     swapchainInfo.imageArrayLayers = 1;
     swapchainInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    //the scaled scene is blitted into the swapchain image
+    if(resolutionScaler) {
+        if(!(surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+            throw std::runtime_error("Could not create swapchain, the surface cannot be blitted to for --dynamic-resolution.");
+        }
+        swapchainInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
     if(graphicsQueue != presentQueue) {
         swapchainInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
         swapchainInfo.queueFamilyIndexCount = 2;
@@ -284,11 +415,16 @@ void VulkanBase::createSwapchain() {
     swapchainInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     swapchainInfo.presentMode = presentMode;
     swapchainInfo.clipped = VK_TRUE;
-    swapchainInfo.oldSwapchain = VK_NULL_HANDLE;
+    //on a resize the old swapchain hands its resources over instead of being torn down first
+    VkSwapchainKHR oldSwapchain = swapchain;
+    swapchainInfo.oldSwapchain = oldSwapchain;
 
     if (vkCreateSwapchainKHR(device, &swapchainInfo, nullptr, &swapchain) != VK_SUCCESS) {
         throw std::runtime_error("Could not create swapchain.");
      }
+    if(oldSwapchain != VK_NULL_HANDLE) {
+        vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+    }
 
     uint32_t swapChainImageCount;
     vkGetSwapchainImagesKHR(device, swapchain, &swapChainImageCount, nullptr);
@@ -296,6 +432,48 @@ void VulkanBase::createSwapchain() {
     vkGetSwapchainImagesKHR(device, swapchain, &swapChainImageCount, swapchainImages.data());
 }
 
+void VulkanBase::createOffscreenTargets() {
+
+    //one color target per frame in flight, in place of the swapchain images
+    swapchain = VK_NULL_HANDLE;
+    extent = requestedExtent;
+    renderExtent = extent;
+    surfaceFormat.format = VK_FORMAT_R8G8B8A8_UNORM;
+    surfaceFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+
+    swapchainImages.resize(settings.framesInFlight);
+    offscreenAllocations.resize(settings.framesInFlight);
+
+    for(size_t i = 0; i < swapchainImages.size(); i++) {
+        VkImageCreateInfo imageCreateInfo = {};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = surfaceFormat.format;
+        imageCreateInfo.extent.width = extent.width;
+        imageCreateInfo.extent.height = extent.height;
+        imageCreateInfo.extent.depth = 1;
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if(vkCreateImage(device, &imageCreateInfo, nullptr, &swapchainImages[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Could not create offscreen image.");
+        }
+
+        VkMemoryRequirements memReqs;
+        vkGetImageMemoryRequirements(device, swapchainImages[i], &memReqs);
+
+        offscreenAllocations[i] = allocator->allocate(memReqs, RESOURCE_KIND_IMAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if(vkBindImageMemory(device, swapchainImages[i], offscreenAllocations[i].memory, offscreenAllocations[i].offset) != VK_SUCCESS) {
+            throw std::runtime_error("Could not bind offscreen image memory.");
+        }
+    }
+}
+
 VkSurfaceFormatKHR VulkanBase::getSurfaceFormat() {
 
     uint32_t surfaceFormatCount;
@@ -323,14 +501,19 @@ uint32_t VulkanBase::getMinImageCount(VkSurfaceCapabilitiesKHR surfaceCapabiliti
 
 VkExtent2D VulkanBase::getSwapExtent(VkSurfaceCapabilitiesKHR surfaceCapabilities) {
 
+    //most surfaces fix the extent to the window's size, the rest take the requested one
+    if(surfaceCapabilities.currentExtent.width != UINT32_MAX) {
+        return surfaceCapabilities.currentExtent;
+    }
+
     VkExtent2D minExtent = surfaceCapabilities.minImageExtent;
     VkExtent2D maxExtent = surfaceCapabilities.maxImageExtent;
 
-    VkExtent2D extent = {SCREEN_WIDTH, SCREEN_HEIGHT};
-    extent.width = std::max(minExtent.width, std::min(maxExtent.width, extent.width));
-    extent.height = std::max(minExtent.height, std::min(maxExtent.height, extent.height));
+    VkExtent2D swapExtent = requestedExtent;
+    swapExtent.width = std::max(minExtent.width, std::min(maxExtent.width, swapExtent.width));
+    swapExtent.height = std::max(minExtent.height, std::min(maxExtent.height, swapExtent.height));
 
-    return extent;
+    return swapExtent;
 }
 
 VkPresentModeKHR VulkanBase::getPresentMode() {
@@ -349,6 +532,7 @@ VkPresentModeKHR VulkanBase::getPresentMode() {
         
 
 void VulkanBase::createImageViews() {
+    CPU_ZONE("createImageViews");
 
     swapchainImageViews.resize(swapchainImages.size());
 
@@ -375,117 +559,551 @@ void VulkanBase::createImageViews() {
 }
 
 void VulkanBase::createCommandBuffers() {
+    CPU_ZONE("createCommandBuffers");
+
+    //one entry per draw call, so the draws can be split evenly between recording threads
+    drawItems.clear();
+    for(uint32_t j = 0; j < pScene->getModelCount() && !settings.gpuDriven; j++) {
+        uint32_t firstInstance = pScene->getFirstInstance(j);
+        uint32_t instanceCount = pScene->getInstanceCount(j);
+        if(settings.instancing) {
+            drawItems.push_back(makeDrawItem(j, firstInstance, instanceCount));
+        }
+        else {
+            for(uint32_t k = 0; k < instanceCount; k++) {
+                drawItems.push_back(makeDrawItem(j, firstInstance + k, 1));
+            }
+        }
+    }
+    drawCount = settings.gpuDriven ? 0 : static_cast<uint32_t>(drawItems.size());
+
+    //every draw is recorded until the first cull, the padding lets the cull write whole SIMD lanes
+    if(settings.cpuCull) {
+        createDrawBounds();
+    }
+    visibleItems.resize(std::max(drawItems.size(), drawBounds.paddedSize()));
+    std::iota(visibleItems.begin(), visibleItems.end(), 0);
+    visibleCount = drawItems.size();
+
+    if(settings.rerecord) {
+        createFrameCommands();
+        return;
+    }
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.queueFamilyIndex = graphicsQueueIndex;
+
+    if(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command pool."); 
+    }
+
+    allocateCommandBuffers();
+}
+
+void VulkanBase::allocateCommandBuffers() {
 
+    //one prerecorded command buffer per framebuffer, the old ones go back to the pool first
+    if(!commandBuffers.empty()) {
+        vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+    }
     commandBuffers.resize(framebuffers.size());
 
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {}; 
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = commandPool;
+    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = commandBuffers.size();
+
+    if(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, commandBuffers.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Could not allocate command buffers.");
+    } 
+
+    recordCommandBuffers();
+}
+
+void VulkanBase::recordCommandBuffers() {
+
+    CPU_ZONE("recordCommandBuffers");
+
+    //nothing is in flight here, so every region can be filled from the start again
+    vkResetCommandPool(device, commandPool, 0);
+    for(size_t i = 0; i < commandBuffers.size(); i++) {
+        uniformRing->reset(i);
+        vpOffsets[i] = uniformRing->allocate(i, sizeof(VP));
+        writeVPSlice(i);
+    }
+
+    std::chrono::steady_clock::time_point recordStart = std::chrono::steady_clock::now();
+
+    //levels of detail are picked for the camera at record time, draw() records again once they change
+    updateLodParameters();
+    recordedLods.resize(drawItems.size());
+    for(size_t d = 0; d < drawItems.size(); d++) {
+        recordedLods[d] = selectLod(drawItems[d]);
+    }
+    recordedLodCameraPos = lodCameraPos;
+    recordedLodScale = lodScale;
+    for(size_t i = 0; i < commandBuffers.size(); i++) {
+
+        VkCommandBufferBeginInfo commandBufferBeginInfo = {};
+        commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+        if(vkBeginCommandBuffer(commandBuffers[i], &commandBufferBeginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("Could not begin command buffer.");
+        }
+
+        reserveGpuZones(i);
+        beginFrameCommands(commandBuffers[i], i, VK_SUBPASS_CONTENTS_INLINE);
+
+        recordDrawState(commandBuffers[i], i);
+        if(settings.gpuDriven) {
+            recordIndirectDraws(commandBuffers[i], i);
+        }
+        triangleCount = recordDrawItems(commandBuffers[i], i, 0, visibleCount);
+
+        endFrameCommands(commandBuffers[i], i);
+    }    
+
+    recordTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count() / commandBuffers.size();
+}
+
+void VulkanBase::createFrameCommands() {
+
+    uint32_t threadCount = settings.recordThreads;
+    if(threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    recordThreads = new ThreadPool(threadCount);
+
+    //each slice gets its own pool per frame, so no two threads ever touch the same pool
+    sliceCount = std::max<uint32_t>(1, std::min<uint32_t>(threadCount, drawItems.size()));
+    frameCommands.resize(settings.framesInFlight);
+
     VkCommandPoolCreateInfo commandPoolCreateInfo = {};
-        commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        commandPoolCreateInfo.queueFamilyIndex = graphicsQueueIndex;
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = graphicsQueueIndex;
+
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {}; 
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandBufferCount = 1;
 
-        if(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS) {
+    for(FrameCommands &frame : frameCommands) {
+        if(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &frame.primaryPool) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create command pool."); 
         }
-
-        VkCommandBufferAllocateInfo commandBufferAllocateInfo = {}; 
-        commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        commandBufferAllocateInfo.commandPool = commandPool;
+        commandBufferAllocateInfo.commandPool = frame.primaryPool;
         commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        commandBufferAllocateInfo.commandBufferCount = commandBuffers.size();
-
-        if(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, commandBuffers.data()) != VK_SUCCESS) {
+        if(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &frame.primary) != VK_SUCCESS) {
             throw std::runtime_error("Could not allocate command buffers.");
-        } 
+        }
+
+        frame.slicePools.resize(sliceCount);
+        frame.secondaries.resize(sliceCount);
+        for(uint32_t s = 0; s < sliceCount; s++) {
+            if(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &frame.slicePools[s]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create command pool."); 
+            }
+            commandBufferAllocateInfo.commandPool = frame.slicePools[s];
+            commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            if(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &frame.secondaries[s]) != VK_SUCCESS) {
+                throw std::runtime_error("Could not allocate secondary command buffers.");
+            }
+        }
+    }
+}
+
+VulkanBase::DrawItem VulkanBase::makeDrawItem(uint32_t model, uint32_t firstInstance, uint32_t instanceCount) {
+
+    const std::vector<glm::mat4> &instances = pScene->getInstanceTransforms();
+    const Bounds &bounds = pScene->getBounds(model);
+
+    DrawItem item;
+    item.model = model;
+    item.firstInstance = firstInstance;
+    item.instanceCount = instanceCount;
+    item.errorScale = 0.f;
+
+    //box around the world space spheres of all the draw's instances, then a sphere around those
+    std::vector<glm::vec4> spheres(instanceCount);
+    glm::vec3 boxMin(1e30f);
+    glm::vec3 boxMax(-1e30f);
+    for(uint32_t k = 0; k < instanceCount; k++) {
+        glm::mat4 world = models[model] * instances[firstInstance + k];
+        glm::vec3 center = glm::vec3(world * glm::vec4(bounds.center, 1.f));
+        float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+        spheres[k] = glm::vec4(center, bounds.radius * scale);
+        boxMin = glm::min(boxMin, center - glm::vec3(spheres[k].w));
+        boxMax = glm::max(boxMax, center + glm::vec3(spheres[k].w));
+        item.errorScale = std::max(item.errorScale, scale);
+    }
 
-        for(size_t i = 0; i < commandBuffers.size(); i++) {
+    glm::vec3 center = 0.5f * (boxMin + boxMax);
+    float radius = 0.f;
+    for(const glm::vec4 &sphere : spheres) {
+        radius = std::max(radius, glm::length(glm::vec3(sphere) - center) + sphere.w);
+    }
+    item.sphere = glm::vec4(center, radius);
+    return item;
+}
 
-            VkCommandBufferBeginInfo commandBufferBeginInfo = {};
-            commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+void VulkanBase::createDrawBounds() {
 
-            if(vkBeginCommandBuffer(commandBuffers[i], &commandBufferBeginInfo) != VK_SUCCESS) {
-            throw std::runtime_error("Could not begin command buffer.");
+    if(settings.cullBvh) {
+        const std::vector<glm::mat4> &instances = pScene->getInstanceTransforms();
+        instanceDrawItems.resize(instances.size());
+        for(uint32_t d = 0; d < drawItems.size(); d++) {
+            std::fill_n(instanceDrawItems.begin() + drawItems[d].firstInstance, drawItems[d].instanceCount, d);
+        }
+        drawItemStamps.assign(drawItems.size(), 0);
+        return;
+    }
 
+    drawBounds.clear();
+    drawBounds.reserve(drawItems.size());
+    for(const DrawItem &item : drawItems) {
+        drawBounds.add(glm::vec3(item.sphere), item.sphere.w);
+    }
+
+    cullPath = getBestCullPath();
+    std::cout << "cpu cull: " << drawBounds.size() << " bounding spheres, " << getCullPathName(cullPath) << " path" << std::endl;
+}
+
+void VulkanBase::cullDraws() {
+
+    CPU_ZONE("cullDraws");
+    std::chrono::steady_clock::time_point cullStart = std::chrono::steady_clock::now();
+
+    Frustum frustum = extractFrustum(VP.projection * VP.view);
+    if(settings.cullBvh) {
+        sceneBvh.cullFrustum(frustum, visibleObjects);
+        uint64_t stamp = cullSamples + 1;
+        visibleCount = 0;
+        for(uint32_t object : visibleObjects) {
+            uint32_t item = instanceDrawItems[object];
+            if(drawItemStamps[item] != stamp) {
+                drawItemStamps[item] = stamp;
+                visibleItems[visibleCount++] = item;
             }
+        }
+    }
+    else {
+        visibleCount = cullSpheres(frustum, drawBounds, visibleItems.data(), cullPath);
+    }
+    drawCount = static_cast<uint32_t>(visibleCount);
+
+    cullTimeTotalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+    cullSamples++;
+    cullTimeMs = cullTimeTotalMs / cullSamples;
+}
 
-        VkClearValue clearValues[2];
-        clearValues[0].color = {0.f, 0.f, 0.f, 0.f};
-        clearValues[1].depthStencil.depth = 1.f;
-        VkRenderPassBeginInfo  renderPassBeginInfo = {};
-        renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassBeginInfo.renderPass = renderPass;
-        renderPassBeginInfo.framebuffer = framebuffers[i];
-        renderPassBeginInfo.renderArea.extent.width = SCREEN_WIDTH;
-        renderPassBeginInfo.renderArea.extent.height = SCREEN_HEIGHT;
-        renderPassBeginInfo.clearValueCount = 2;
-        renderPassBeginInfo.pClearValues = clearValues;
+VkCommandBuffer VulkanBase::recordFrame(uint32_t imageIndex) {
 
+    CPU_ZONE("recordFrame");
 
-    vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    if(settings.cpuCull) {
+        cullDraws();
+    }
 
+    std::chrono::steady_clock::time_point recordStart = std::chrono::steady_clock::now();
+
+    //the frame's fence has signaled, so everything recorded from its pools is done
+    FrameCommands &frame = frameCommands[currentFrame];
+    vkResetCommandPool(device, frame.primaryPool, 0);
+    for(VkCommandPool pool : frame.slicePools) {
+        vkResetCommandPool(device, pool, 0);
+    }
+    uniformRing->reset(currentFrame);
+    vpOffsets[currentFrame] = uniformRing->allocate(currentFrame, sizeof(VP));
+    writeVPSlice(currentFrame);
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = framebuffers[imageIndex];
+
+    updateLodParameters();
+    reserveGpuZones(imageIndex);
+    size_t itemCount = visibleCount;
+    std::vector<uint64_t> sliceTriangles(sliceCount, 0);
+    recordThreads->parallelFor(sliceCount, [&](uint32_t s) {
+        CPU_ZONE("record slice");
+        VkCommandBuffer secondary = frame.secondaries[s];
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        if(vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("Could not begin secondary command buffer.");
+        }
+
+        //secondary command buffers inherit no state from the primary
+        recordDrawState(secondary, imageIndex);
+        if(settings.gpuDriven && s == 0) {
+            recordIndirectDraws(secondary, imageIndex);
+        }
+        sliceTriangles[s] = recordDrawItems(secondary, imageIndex, itemCount * s / sliceCount, itemCount * (s + 1) / sliceCount);
+
+        if(vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+            throw std::runtime_error("Could not record secondary command buffer.");
+        }
+    });
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if(vkBeginCommandBuffer(frame.primary, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Could not begin command buffer.");
+    }
+    beginFrameCommands(frame.primary, imageIndex, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    vkCmdExecuteCommands(frame.primary, sliceCount, frame.secondaries.data());
+    endFrameCommands(frame.primary, imageIndex);
+    triangleCount = std::accumulate(sliceTriangles.begin(), sliceTriangles.end(), uint64_t(0));
+
+    recordTimeTotalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+    recordSamples++;
+    recordTimeMs = recordTimeTotalMs / recordSamples;
+
+    return frame.primary;
+}
+
+void VulkanBase::beginFrameCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkSubpassContents contents) {
+
+    if(gpuProfiler) {
+        gpuProfiler->recordReset(commandBuffer, imageIndex);
+        gpuProfiler->beginZone(commandBuffer, imageIndex, gpuZones.frame);
+    }
+
+    if(settings.gpuDriven) {
+        if(gpuProfiler) {
+            gpuProfiler->beginZone(commandBuffer, imageIndex, gpuZones.cull);
+        }
+        recordCulling(commandBuffer, imageIndex);
+        if(gpuProfiler) {
+            gpuProfiler->endZone(commandBuffer, imageIndex, gpuZones.cull);
+        }
+    }
+
+    VkClearValue clearValues[2];
+    clearValues[0].color = {0.f, 0.f, 0.f, 0.f};
+    clearValues[1].depthStencil.depth = 1.f;
+    VkRenderPassBeginInfo  renderPassBeginInfo = {};
+    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassBeginInfo.renderPass = renderPass;
+    renderPassBeginInfo.framebuffer = framebuffers[imageIndex];
+    renderPassBeginInfo.renderArea.extent = renderExtent;
+    renderPassBeginInfo.clearValueCount = 2;
+    renderPassBeginInfo.pClearValues = clearValues;
+
+    if(gpuProfiler) {
+        gpuProfiler->beginZone(commandBuffer, imageIndex, gpuZones.renderPass);
+    }
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, contents);
+}
+
+void VulkanBase::endFrameCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+
+    vkCmdEndRenderPass(commandBuffer);
+
+    if(gpuProfiler) {
+        gpuProfiler->endZone(commandBuffer, imageIndex, gpuZones.renderPass);
+    }
+    if(resolutionScaler) {
+        if(gpuProfiler) {
+            gpuProfiler->beginZone(commandBuffer, imageIndex, gpuZones.upscale);
+        }
+        recordUpscale(commandBuffer, imageIndex);
+        if(gpuProfiler) {
+            gpuProfiler->endZone(commandBuffer, imageIndex, gpuZones.upscale);
+        }
+    }
+    if(gpuProfiler) {
+        gpuProfiler->endZone(commandBuffer, imageIndex, gpuZones.frame);
+    }
+
+    if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Could not record command buffer.");
+    }
+}
+
+void VulkanBase::recordUpscale(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+
+    //the output image's old contents are dropped. Submission waits for the acquire at color
+    //attachment output, which this barrier's source stage chains onto.
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = swapchainImages[imageIndex];
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    //the render pass left the scene image in transfer src layout, visible to transfers
+    VkImageBlit blit = {};
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.mipLevel = 0;
+    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.layerCount = 1;
+    blit.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1};
+    blit.dstSubresource = blit.srcSubresource;
+    blit.dstOffsets[1] = {static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1};
+    vkCmdBlitImage(commandBuffer, sceneImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, upscaleFilter);
+
+    //into the layout the render pass leaves the output in without scaling
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = settings.headless ? VK_ACCESS_TRANSFER_READ_BIT : 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = settings.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, settings.headless ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void VulkanBase::updateRenderExtent() {
+
+    //with --simulate-gpu-ms the time follows the pixels of the previous frame, so runs repeat exactly
+    double gpuMs = 0.0;
+    if(settings.simulatedGpuMs > 0.f) {
+        float scale = resolutionScaler->getScale();
+        gpuMs = settings.simulatedGpuMs * scale * scale;
+    }
+    else if(gpuProfiler) {
+        //a frame's time arrives frames in flight later, each sample is fed once
+        uint64_t samples;
+        double lastMs = gpuProfiler->getLastMs("frame", samples);
+        if(samples > scaledGpuSamples) {
+            scaledGpuSamples = samples;
+            gpuMs = lastMs;
+        }
+    }
+
+    float scale = resolutionScaler->update(gpuMs);
+    renderExtent.width = std::max(1u, static_cast<uint32_t>(std::lround(extent.width * scale)));
+    renderExtent.height = std::max(1u, static_cast<uint32_t>(std::lround(extent.height * scale)));
+}
+
+void VulkanBase::recordDrawState(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
-    
     VkViewport viewport = {};
     viewport.x = 0.f;
     viewport.y = 0.f;
-    viewport.width = (float) SCREEN_WIDTH;
-    viewport.height = (float) SCREEN_HEIGHT;
+    viewport.width = (float) renderExtent.width;
+    viewport.height = (float) renderExtent.height;
     viewport.minDepth = 0.f;
     viewport.maxDepth = 1.f;
 
     VkRect2D scissor;
-    scissor.extent.width = SCREEN_WIDTH;
-    scissor.extent.height = SCREEN_HEIGHT;
+    scissor.extent = renderExtent;
     scissor.offset.x = 0.f;
     scissor.offset.y = 0.f;
-    
 
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-    vkCmdSetViewport(commandBuffers[i], 0, 1, &viewport);
-    vkCmdSetScissor(commandBuffers[i], 0, 1, &scissor);
+    //GPU driven draws take their instance data from the cull pass output
+    VkBuffer vertexBuffers[] = {vertBuffer, settings.gpuDriven ? cullOutputBuffer : instanceBuffer};
+    VkDeviceSize offsets[] = {0, settings.gpuDriven ? imageIndex * cullRegionSize : 0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
 
-    
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &vertBuffer, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32); 
 
+    uint32_t vpOffset = vpOffsets[getUniformRegion(imageIndex)];
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &descriptorSets[1], 1, &vpOffset);
 
-    vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32); 
-    
-    uint32_t dynamicOffsets[2];
-    dynamicOffsets[0] = 0;
-    dynamicOffsets[1] = sizeof(models[0]);
+    //the shader references the model ubo on both paths, so set 0 always has to be bound
+    uint32_t modelOffset = 0;
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[0], 1, &modelOffset);
+}
 
-    vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &descriptorSets[1], 0, nullptr);
+void VulkanBase::updateLodParameters() {
 
-    uint32_t start = 0;
-    uint32_t end;
-    for(size_t j = 0; j < pScene->getModelCount(); j++) { 
-    vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[0], 1, &dynamicOffsets[j]);
-        end = pScene->modelMarkers[j];
-        uint32_t num = end - start;
-        vkCmdDrawIndexed(commandBuffers[i], num, 1, start, 0, 0);
-        start = end;
-    }
+    //a model space error e at distance d covers e * lodScale / d pixels over --lod-error
+    lodCameraPos = glm::vec3(glm::inverse(VP.view)[3]);
+    lodScale = 0.5f * renderExtent.height * std::fabs(VP.projection[1][1]) / settings.lodError;
+}
 
-    vkCmdEndRenderPass(commandBuffers[i]);
+uint32_t VulkanBase::selectLod(const DrawItem &item) {
 
-    if(vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-        throw std::runtime_error("Could not record command buffer.");
+    //the coarsest level that stays under the threshold at the draw's nearest point, an
+    //instanced draw picks the level of its nearest instance for all of them
+    float distance = std::max(glm::length(glm::vec3(item.sphere) - lodCameraPos) - item.sphere.w, 1e-3f);
+    uint32_t level = 0;
+    for(uint32_t l = 1; l < pScene->getLodCount(item.model); l++) {
+        if(pScene->getLod(item.model, l).error * item.errorScale * lodScale > distance) {
+            break;
+        }
+        level = l;
     }
+    return level;
+}
+
+bool VulkanBase::recordedLodsChanged() {
 
+    CPU_ZONE("check LODs");
+    updateLodParameters();
+    if(lodCameraPos == recordedLodCameraPos && lodScale == recordedLodScale) {
+        return false;
+    }
+    for(size_t d = 0; d < drawItems.size(); d++) {
+        if(selectLod(drawItems[d]) != recordedLods[d]) {
+            return true;
+        }
+    }
+    return false;
+}
 
+uint64_t VulkanBase::recordDrawItems(VkCommandBuffer commandBuffer, uint32_t imageIndex, size_t first, size_t last) {
 
-        }    
+    uint32_t region = getUniformRegion(imageIndex);
+    uint64_t triangles = 0;
+    uint32_t firstDrawZone = gpuZones.firstDraw;
 
+    //every draw sets its own model matrix, either pushed or by rebinding the ubo at its offset
+    for(size_t d = first; d < last; d++) {
+        const DrawItem &item = drawItems[visibleItems[d]];
+        const LodRange &lod = pScene->getLod(item.model, selectLod(item));
+        if(settings.modelUbo) {
+            uint32_t modelOffset = uniformRing->push(region, models[item.model]);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[0], 1, &modelOffset);
+        }
+        else {
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(models[0]), &models[item.model]);
+        }
+        if(firstDrawZone != GpuProfiler::NO_ZONE) {
+            gpuProfiler->beginZone(commandBuffer, imageIndex, firstDrawZone + d);
+        }
+        vkCmdDrawIndexed(commandBuffer, lod.indexCount, item.instanceCount, lod.firstIndex, 0, item.firstInstance);
+        if(firstDrawZone != GpuProfiler::NO_ZONE) {
+            gpuProfiler->endZone(commandBuffer, imageIndex, firstDrawZone + d);
+        }
+        triangles += uint64_t(lod.indexCount / 3) * item.instanceCount;
+    }
+    return triangles;
 }
 
 void VulkanBase::createDepthBuffer() {
+    CPU_ZONE("createDepthBuffer");
 
     VkImageCreateInfo depthImageCreateInfo = {};
     depthImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     depthImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
     depthImageCreateInfo.format = VK_FORMAT_D16_UNORM;
-    depthImageCreateInfo.extent.width = SCREEN_WIDTH;
-    depthImageCreateInfo.extent.height = SCREEN_HEIGHT;
+    depthImageCreateInfo.extent.width = extent.width;
+    depthImageCreateInfo.extent.height = extent.height;
     depthImageCreateInfo.extent.depth = 1;
     depthImageCreateInfo.mipLevels = 1;
     depthImageCreateInfo.arrayLayers = 1;
@@ -504,21 +1122,8 @@ void VulkanBase::createDepthBuffer() {
     VkMemoryRequirements depthMemRequirements;
     vkGetImageMemoryRequirements(device, depthImage, &depthMemRequirements);
 
-    VkPhysicalDeviceMemoryProperties physicalDeviceMemProps;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemProps);
-
-    uint32_t memoryTypeIndex;
-    getMemoryTypeIndex(physicalDevice, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryTypeIndex);
-
-    VkMemoryAllocateInfo depthMemAlloc = {};
-    depthMemAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    depthMemAlloc.allocationSize = depthMemRequirements.size;
-    depthMemAlloc.memoryTypeIndex = memoryTypeIndex;
-
-    if(vkAllocateMemory(device, &depthMemAlloc, nullptr, &depthMemory) != VK_SUCCESS) {
-        throw std::runtime_error("Could not allocate memory for depth image.");
-    }
-    if(vkBindImageMemory(device, depthImage, depthMemory, 0) != VK_SUCCESS) {
+    depthAllocation = allocator->allocate(depthMemRequirements, RESOURCE_KIND_IMAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if(vkBindImageMemory(device, depthImage, depthAllocation.memory, depthAllocation.offset) != VK_SUCCESS) {
         throw std::runtime_error("Could not bind depth memory to depth image.");
     }
 
@@ -542,39 +1147,90 @@ void VulkanBase::createDepthBuffer() {
     }
 }
 
-void VulkanBase::getMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t memoryFlagBitMask, uint32_t &memoryTypeIndex) {
+void VulkanBase::createSceneTarget() {
+    CPU_ZONE("createSceneTarget");
+
+    if(!resolutionScaler) {
+        return;
+    }
+
+    //the scene image and the output share the surface format
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, surfaceFormat.format, &formatProperties);
+    VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    if((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures) {
+        throw std::runtime_error("Could not blit the surface format for --dynamic-resolution.");
+    }
+    upscaleFilter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+    VkImageCreateInfo imageCreateInfo = {};
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.format = surfaceFormat.format;
+    imageCreateInfo.extent.width = extent.width;
+    imageCreateInfo.extent.height = extent.height;
+    imageCreateInfo.extent.depth = 1;
+    imageCreateInfo.mipLevels = 1;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateImage(device, &imageCreateInfo, nullptr, &sceneImage) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create scene image.");
+    }
 
-    VkPhysicalDeviceMemoryProperties physicalDeviceMemProps;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemProps);
+    VkMemoryRequirements memReqs;
+    vkGetImageMemoryRequirements(device, sceneImage, &memReqs);
 
-    for(size_t i = 0; i < physicalDeviceMemProps.memoryTypeCount; i++) {
-       if((physicalDeviceMemProps.memoryTypes[i].propertyFlags & memoryFlagBitMask) == memoryFlagBitMask) {
-            memoryTypeIndex = i;
-            return;
-       } 
+    sceneAllocation = allocator->allocate(memReqs, RESOURCE_KIND_IMAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if(vkBindImageMemory(device, sceneImage, sceneAllocation.memory, sceneAllocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("Could not bind scene image memory.");
     }
 
-    throw std::runtime_error("Could not find suitable memory type.");
+    VkImageViewCreateInfo imageViewCreateInfo = {};
+    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewCreateInfo.image = sceneImage;
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = surfaceFormat.format;
+    imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+    if(vkCreateImageView(device, &imageViewCreateInfo, nullptr, &sceneImageView) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create scene image view.");
+    }
 }
 
 void VulkanBase::createUniformBuffers() {
+    CPU_ZONE("createUniformBuffers");
 
-    models.resize(2);
-    models[0] = glm::mat4(1.f);
-    models[0][3] = glm::vec4(0.f, 1.f, -10.f, 1.f);
-    models[1] = glm::mat4(1.f);
+    //one matrix per scene model, the first one is lifted over the plane
+    models.assign(pScene->getModelCount(), glm::mat4(1.f));
+    if(!models.empty()) {
+        models[0][3] = glm::vec4(0.f, 1.f, -10.f, 1.f);
+    }
+    //GPU driven draws read world matrices from the cull pass and bind this identity slot
+    models.push_back(glm::mat4(1.f));
     cam->updateView();
-    VP.projection = glm::perspective(45.f, (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.f);
-    //account for glm y down
-    VP.projection[1][1] *= -1;
+    updateProjection();
 
+        //every model matrix, read by the cull pass. Draws get theirs from push constants or the ring.
         VkBufferCreateInfo uboCreateInfoM = {};
         uboCreateInfoM.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        uboCreateInfoM.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+        uboCreateInfoM.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
         uboCreateInfoM.size = sizeof(models[0]) * models.size();
         uboCreateInfoM.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        ubo.resize(2);
+        ubo.resize(1);
         if(vkCreateBuffer(device, &uboCreateInfoM, nullptr, &ubo[0]) != VK_SUCCESS) {
             throw std::runtime_error("Could not create UBO.");
         }
@@ -582,71 +1238,43 @@ void VulkanBase::createUniformBuffers() {
         VkMemoryRequirements uboMemReqsM;
         vkGetBufferMemoryRequirements(device, ubo[0], &uboMemReqsM);
 
-        uint32_t memoryTypeIndexM;
-        getMemoryTypeIndex(physicalDevice, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memoryTypeIndexM);
-
-        VkMemoryAllocateInfo uboAllocInfoM = {};
-        uboAllocInfoM.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        uboAllocInfoM.allocationSize = uboMemReqsM.size;
-        uboAllocInfoM.memoryTypeIndex = memoryTypeIndexM;
+        //host visible blocks stay mapped for their whole lifetime
+        uboAllocations.resize(1);
+        uboAllocations[0] = allocator->allocate(uboMemReqsM, RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-        uboMemory.resize(2);
-        if(vkAllocateMemory(device, &uboAllocInfoM, nullptr, &uboMemory[0]) != VK_SUCCESS) {
-            throw std::runtime_error("Could not allocate UBO memory.");
-        }
-
-        if(vkBindBufferMemory(device, ubo[0], uboMemory[0], 0) != VK_SUCCESS) {
+        if(vkBindBufferMemory(device, ubo[0], uboAllocations[0].memory, uboAllocations[0].offset) != VK_SUCCESS) {
             throw std::runtime_error("Could not bind ubo to memory.");
         }
 
-        //void* pData;
-        pUboData.resize(2);
-        if(vkMapMemory(device, uboMemory[0], 0, uboMemReqsM.size, 0, &pUboData[0])) {
-            throw std::runtime_error("Could not map ubo memory.");
-        }
+        pUboData.resize(1);
+        pUboData[0] = uboAllocations[0].pMapped;
 
         std::memcpy(pUboData[0], models.data(), sizeof(models[0]) * models.size());
 
+    createUniformRing();
+}
 
-        VkBufferCreateInfo uboCreateInfo = {};
-        uboCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        uboCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-        uboCreateInfo.size = sizeof(VP);
-       uboCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        if(vkCreateBuffer(device, &uboCreateInfo, nullptr, &ubo[1]) != VK_SUCCESS) {
-            throw std::runtime_error("Could not create UBO.");
-        }
-
-        VkMemoryRequirements uboMemReqs;
-        vkGetBufferMemoryRequirements(device, ubo[1], &uboMemReqs);
-
-        uint32_t memoryTypeIndex;
-        getMemoryTypeIndex(physicalDevice, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memoryTypeIndex);
-
-        VkMemoryAllocateInfo uboAllocInfo = {};
-        uboAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        uboAllocInfo.allocationSize = uboMemReqs.size;
-        uboAllocInfo.memoryTypeIndex = memoryTypeIndex;
-
-        if(vkAllocateMemory(device, &uboAllocInfo, nullptr, &uboMemory[1]) != VK_SUCCESS) {
-            throw std::runtime_error("Could not allocate UBO memory.");
-        }
+void VulkanBase::createUniformRing() {
 
-        if(vkBindBufferMemory(device, ubo[1], uboMemory[1], 0) != VK_SUCCESS) {
-            throw std::runtime_error("Could not bind ubo to memory.");
-        }
+    //transient uniforms (VP and, on the ubo path, one model matrix per draw) come from a ring with
+    //a region per command buffer slot: per frame in flight when re-recording, otherwise per image
+    VkPhysicalDeviceProperties physicalDeviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+    VkDeviceSize alignment = physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
+    auto alignUp = [alignment](VkDeviceSize value) {return (value + alignment - 1) / alignment * alignment;};
 
-        //void* pData;
-        if(vkMapMemory(device, uboMemory[1], 0, uboMemReqs.size, 0, &pUboData[1])) {
-            throw std::runtime_error("Could not map ubo memory.");
-        }
-    
+    //every instance may be its own draw, plus the identity matrix of GPU driven draws
+    VkDeviceSize maxDraws = pScene->getInstanceTransforms().size() + pScene->getModelCount() + 1;
+    VkDeviceSize regionSize = alignUp(sizeof(VP)) + alignUp(sizeof(glm::mat4)) * (settings.modelUbo ? maxDraws : 1);
+    uint32_t regionCount = settings.rerecord ? settings.framesInFlight : static_cast<uint32_t>(swapchainImages.size());
 
-    updateMVP();
+    uniformRing = new UniformRing(device, allocator, regionSize, regionCount, alignment);
+    vpOffsets.assign(regionCount, 0);
+    vpSliceDirty.assign(regionCount, true);
 }
 
 void VulkanBase::createDescriptorSet() {
+    CPU_ZONE("createDescriptorSet");
 
     VkDescriptorSetLayoutBinding layoutBindings[2];
     layoutBindings[0] = {};
@@ -657,7 +1285,7 @@ void VulkanBase::createDescriptorSet() {
 
     layoutBindings[1] = {};
     layoutBindings[1].binding = 0;
-    layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     layoutBindings[1].descriptorCount = 1;
     layoutBindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
@@ -682,10 +1310,16 @@ void VulkanBase::createDescriptorSet() {
         throw std::runtime_error("Could not create descriptor set layout.");
     }
 
+    //the model matrix, 64 of the 128 bytes every device guarantees
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(glm::mat4);
+
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-    pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
     pipelineLayoutCreateInfo.setLayoutCount = 2;
     pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
 
@@ -695,7 +1329,7 @@ void VulkanBase::createDescriptorSet() {
 
     
    VkDescriptorPoolSize poolSizes[1];
-   poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+   poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
    poolSizes[0].descriptorCount = 2;
 
    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
@@ -719,13 +1353,19 @@ void VulkanBase::createDescriptorSet() {
        throw std::runtime_error("Could not allocate descriptor sets.");
    }
 
+   writeUniformRingDescriptors();
+}
+
+void VulkanBase::writeUniformRingDescriptors() {
+
    VkDescriptorBufferInfo uboInfoM = {};
-   uboInfoM.buffer = ubo[0];
+   uboInfoM.buffer = uniformRing->getBuffer();
    uboInfoM.offset = 0;
-   uboInfoM.range = sizeof(models);
+   //the window each dynamic offset selects: one model matrix
+   uboInfoM.range = sizeof(models[0]);
 
    VkDescriptorBufferInfo uboInfoVP = {};
-   uboInfoVP.buffer = ubo[1];
+   uboInfoVP.buffer = uniformRing->getBuffer();
    uboInfoVP.offset = 0;
    uboInfoVP.range = sizeof(VP);
 
@@ -746,13 +1386,15 @@ void VulkanBase::createDescriptorSet() {
    writeDescriptorSets[1].dstBinding = 0;
    writeDescriptorSets[1].dstArrayElement = 0;
    writeDescriptorSets[1].descriptorCount = 1;
-   writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+   writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
    writeDescriptorSets[1].pBufferInfo = &uboInfoVP;
 
    vkUpdateDescriptorSets(device, 2, writeDescriptorSets, 0, nullptr);
 }
 
 void VulkanBase::createRenderPass() {
+    CPU_ZONE("createRenderPass");
+
     VkAttachmentDescription attachmentDescription[2];
 
     attachmentDescription[0] = {};
@@ -763,7 +1405,8 @@ void VulkanBase::createRenderPass() {
     attachmentDescription[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachmentDescription[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     attachmentDescription[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    attachmentDescription[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    //offscreen targets are left ready to be copied out, the scene image ready to be scaled up
+    attachmentDescription[0].finalLayout = settings.headless || resolutionScaler ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     attachmentDescription[1] = {};
     attachmentDescription[1].format = depthFormat;
@@ -794,14 +1437,29 @@ void VulkanBase::createRenderPass() {
     subpass.preserveAttachmentCount = 0;
     subpass.pPreserveAttachments = nullptr;
 
-    VkSubpassDependency subpassDependency = {};
-    subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    subpassDependency.dstSubpass = 0;
-    subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependency.srcAccessMask = 0;
-    subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    subpassDependency.dependencyFlags = 0;
+    //frames in flight share the depth image, so this frame's depth clear waits for the previous
+    //frame's depth tests as well as for the swapchain image
+    VkSubpassDependency subpassDependencies[2] = {};
+    subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    subpassDependencies[0].dstSubpass = 0;
+    subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    subpassDependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    subpassDependencies[0].dependencyFlags = 0;
+
+    //every frame draws into the one scene image, after the previous frame's blit has read it,
+    //and its own blit reads it after the pass
+    if(resolutionScaler) {
+        subpassDependencies[0].srcStageMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+        subpassDependencies[1].srcSubpass = 0;
+        subpassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        subpassDependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        subpassDependencies[1].dependencyFlags = 0;
+    }
 
     VkRenderPassCreateInfo renderPassCreateInfo = {};
     renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -809,8 +1467,8 @@ void VulkanBase::createRenderPass() {
     renderPassCreateInfo.pAttachments = attachmentDescription;
     renderPassCreateInfo.subpassCount = 1;
     renderPassCreateInfo.pSubpasses = &subpass;
-    renderPassCreateInfo.dependencyCount = 1;
-    renderPassCreateInfo.pDependencies = &subpassDependency;
+    renderPassCreateInfo.dependencyCount = resolutionScaler ? 2 : 1;
+    renderPassCreateInfo.pDependencies = subpassDependencies;
 
     if(vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &renderPass) != VK_SUCCESS) {
         throw std::runtime_error("Could not create render pass.");
@@ -819,6 +1477,7 @@ void VulkanBase::createRenderPass() {
 }
 
 void VulkanBase::createFramebuffers() {
+    CPU_ZONE("createFramebuffers");
 
     framebuffers.resize(swapchainImageViews.size());
 
@@ -830,131 +1489,599 @@ void VulkanBase::createFramebuffers() {
     framebufferCreateInfo.renderPass = renderPass;
     framebufferCreateInfo.attachmentCount = 2;
     framebufferCreateInfo.pAttachments = attachments; 
-    framebufferCreateInfo.width = SCREEN_WIDTH;
-    framebufferCreateInfo.height = SCREEN_HEIGHT;
+    framebufferCreateInfo.width = extent.width;
+    framebufferCreateInfo.height = extent.height;
     framebufferCreateInfo.layers = 1;
     
     for(size_t i = 0; i < framebuffers.size(); i++) {
-        attachments[0] =  swapchainImageViews[i];
+        attachments[0] = resolutionScaler ? sceneImageView : swapchainImageViews[i];
 
         if(vkCreateFramebuffer(device, &framebufferCreateInfo, nullptr, &framebuffers[i]) != VK_SUCCESS)
         throw std::runtime_error("Could not create framebuffer.");
     }
 }
 
-void VulkanBase::createVertexBuffer() {
+void VulkanBase::createStagingRing() {
+    CPU_ZONE("createStagingRing");
 
+    uploadStart = std::chrono::steady_clock::now();
+    stagingRing = new StagingRing(device, allocator, transferQueueIndex, transferQueue, STAGING_RING_SIZE);
+}
 
-    VkBufferCreateInfo vertBufferCreateInfo = {};
-    vertBufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    vertBufferCreateInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    vertBufferCreateInfo.size = sizeof(vertices[0]) * vertices.size();
-    vertBufferCreateInfo.queueFamilyIndexCount = graphicsQueueIndex;
-    vertBufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+void VulkanBase::createGeometryBuffer(VkBufferUsageFlags usage, const void* data, VkDeviceSize size, VkBuffer &buffer, Allocation &allocation) {
 
-    if(vkCreateBuffer(device, &vertBufferCreateInfo, nullptr, &vertBuffer) != VK_SUCCESS) {
-        throw std::runtime_error("Could not create vertex buffer.");
-    }
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.size = size;
 
-    VkMemoryRequirements memReqs;
-    vkGetBufferMemoryRequirements(device, vertBuffer, &memReqs);
+    //a dedicated transfer queue writes the buffer, the graphics queue reads it
+    uint32_t queueFamilyIndices[2] = {transferQueueIndex, graphicsQueueIndex};
+    if(!settings.hostVisibleGeometry && transferQueueIndex != graphicsQueueIndex) {
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferCreateInfo.queueFamilyIndexCount = 2;
+        bufferCreateInfo.pQueueFamilyIndices = queueFamilyIndices;
+    } else {
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+    if(!settings.hostVisibleGeometry) {
+        bufferCreateInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    }
 
-    uint32_t memoryTypeIndex;
-    getMemoryTypeIndex(physicalDevice, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memoryTypeIndex);
+    if(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create geometry buffer.");
+    }
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memReqs.size;
-    allocInfo.memoryTypeIndex = memoryTypeIndex;
+    VkMemoryRequirements memReqs;
+    vkGetBufferMemoryRequirements(device, buffer, &memReqs);
 
-    if(vkAllocateMemory(device, &allocInfo, nullptr, &vertBufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("Could not allocate vertex buffer memory.");
-    }
+    uint32_t memoryFlags = settings.hostVisibleGeometry ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    allocation = allocator->allocate(memReqs, RESOURCE_KIND_BUFFER, memoryFlags);
 
-    if(vkBindBufferMemory(device, vertBuffer, vertBufferMemory, 0) != VK_SUCCESS) {
-        throw std::runtime_error("Could not bind vertex buffer to memory.");
+    if(vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("Could not bind geometry buffer to memory.");
     }
 
-    void* pData;
-    if(vkMapMemory(device, vertBufferMemory, 0, memReqs.size, 0, &pData)) {
-        throw std::runtime_error("Could not map vertex buffer memory.");
+    if(!settings.hostVisibleGeometry) {
+        stagingRing->upload(buffer, 0, data, size);
+        return;
     }
 
-    std::memcpy(pData, vertices.data(), sizeof(vertices[0]) * vertices.size());
-    vkUnmapMemory(device, vertBufferMemory);
+    std::memcpy(allocation.pMapped, data, size);
 }
 
-void VulkanBase::createIndexBuffer() {
+void VulkanBase::createVertexBuffer() {
+    CPU_ZONE("createVertexBuffer");
 
-    VkBufferCreateInfo indexBufferCreateInfo = {};
-    indexBufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    indexBufferCreateInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-    indexBufferCreateInfo.size = sizeof(indices[0]) * indices.size();
-    indexBufferCreateInfo.queueFamilyIndexCount = graphicsQueueIndex;
-    indexBufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    const std::vector<Vertex> &vertices = pScene->getVerts();
 
-    if(vkCreateBuffer(device, &indexBufferCreateInfo, nullptr, &indexBuffer) != VK_SUCCESS) {
-        throw std::runtime_error("Could not create index buffer.");
+    //the compressed layouts drop the vertex color, every model becomes one material with the color of its first vertex
+    if(settings.vertexLayout != VERTEX_LAYOUT_FULL && pScene->getModelCount() > MAX_MATERIALS) {
+        throw std::runtime_error("Could not create vertex buffer: more than " + std::to_string(MAX_MATERIALS) + " models need --vertex-layout full.");
+    }
+    for(uint32_t j = 0; j < pScene->getModelCount() && j < MAX_MATERIALS; j++) {
+        if(pScene->getVertexCount(j) > 0) {
+            VP.materials[j] = glm::vec4(vertices[pScene->getFirstVertex(j)].color, 1.f);
+        }
     }
 
-    VkMemoryRequirements memReqs;
-    vkGetBufferMemoryRequirements(device, indexBuffer, &memReqs);
+    positionScale = 0.f;
+    for(const Vertex &vertex : vertices) {
+        positionScale = std::max(positionScale, std::max(std::fabs(vertex.pos.x), std::max(std::fabs(vertex.pos.y), std::fabs(vertex.pos.z))));
+    }
+    positionScale = std::max(positionScale, 1e-6f);
+
+    switch(settings.vertexLayout) {
+        case VERTEX_LAYOUT_FULL:
+            //the same bytes as Vertex, uploaded straight from the scene's arena
+            vertexAttributes = VertexLayoutTraits<FullVertex>::attributes;
+            vertexStride = sizeof(FullVertex);
+            createGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertices.data(), sizeof(vertices[0]) * vertices.size(), vertBuffer, vertBufferAllocation);
+            break;
+        case VERTEX_LAYOUT_HALF:
+            uploadVertices<HalfVertex>();
+            break;
+        case VERTEX_LAYOUT_SNORM16:
+            uploadVertices<Snorm16Vertex>();
+            break;
+    }
 
-    uint32_t memoryTypeIndex;
-    getMemoryTypeIndex(physicalDevice, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memoryTypeIndex);
+    std::cout << "Vertex layout: " << vertexStride << " bytes per vertex, " << vertexStride * vertices.size() / (1024.0 * 1024.0) << " MB ("
+              << sizeof(Vertex) * vertices.size() / (1024.0 * 1024.0) << " MB as full floats)\n";
+}
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memReqs.size;
-    allocInfo.memoryTypeIndex = memoryTypeIndex;
+template<typename Layout>
+void VulkanBase::uploadVertices() {
 
-    if(vkAllocateMemory(device, &allocInfo, nullptr, &indexBufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("Could not allocate index buffer memory.");
+    const std::vector<Vertex> &vertices = pScene->getVerts();
+    std::vector<Layout> encoded(vertices.size());
+    for(uint32_t j = 0; j < pScene->getModelCount(); j++) {
+        uint32_t first = pScene->getFirstVertex(j);
+        for(uint32_t v = first; v < first + pScene->getVertexCount(j); v++) {
+            encoded[v] = Layout::encode(vertices[v], j, positionScale);
+        }
     }
 
-    if(vkBindBufferMemory(device, indexBuffer, indexBufferMemory, 0) != VK_SUCCESS) {
-        throw std::runtime_error("Could not bind index buffer to memory.");
-    }
+    vertexAttributes = VertexLayoutTraits<Layout>::attributes;
+    vertexStride = sizeof(Layout);
+    createGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, encoded.data(), sizeof(encoded[0]) * encoded.size(), vertBuffer, vertBufferAllocation);
+}
 
-    void* pData;
-    if(vkMapMemory(device, indexBufferMemory, 0, memReqs.size, 0, &pData)) {
-        throw std::runtime_error("Could not map index buffer memory.");
-    }
+void VulkanBase::createIndexBuffer() {
+    CPU_ZONE("createIndexBuffer");
+
+    const std::vector<uint32_t> &indices = pScene->getInds();
+    createGeometryBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indices.data(), sizeof(indices[0]) * indices.size(), indexBuffer, indexBufferAllocation);
+}
 
-    std::memcpy(pData, indices.data(), sizeof(indices[0]) * indices.size());
-    vkUnmapMemory(device, indexBufferMemory);
+void VulkanBase::createInstanceBuffer() {
+    CPU_ZONE("createInstanceBuffer");
 
+    const std::vector<glm::mat4> &transforms = pScene->getInstanceTransforms();
+    createGeometryBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, transforms.data(), sizeof(transforms[0]) * transforms.size(), instanceBuffer, instanceBufferAllocation);
 }
 
-void VulkanBase::createGraphicsPipeline() {
+void VulkanBase::createCullingResources() {
+    CPU_ZONE("createCullingResources");
 
-    #include "shaders/vert.spv"
-    VkShaderModuleCreateInfo vertShaderModuleCreateInfo = {};
-    vertShaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    vertShaderModuleCreateInfo.codeSize = sizeof(vertShader);
-    vertShaderModuleCreateInfo.pCode = vertShader;
+    if(!settings.gpuDriven) {
+        return;
+    }
+
+    //matches Object and Lod in shaders/cull.comp
+    struct GpuObject {
+        glm::vec4 sphere;
+        uint32_t modelIndex;
+        uint32_t instanceIndex;
+        uint32_t firstLod;
+        uint32_t lodCount;
+    };
+    struct GpuLod {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float error;
+        uint32_t pad;
+    };
+
+    std::vector<GpuLod> lods;
+    std::vector<GpuObject> objects;
+    for(uint32_t j = 0; j < pScene->getModelCount(); j++) {
+
+        const Bounds &bounds = pScene->getBounds(j);
+        uint32_t firstLod = static_cast<uint32_t>(lods.size());
+        for(uint32_t l = 0; l < pScene->getLodCount(j); l++) {
+            const LodRange &lod = pScene->getLod(j, l);
+            lods.push_back({lod.firstIndex, lod.indexCount, lod.error, 0});
+        }
 
-    if(vkCreateShaderModule(device, &vertShaderModuleCreateInfo, nullptr, &vertShaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("Could not create vertex shader module.");
+        for(uint32_t k = 0; k < pScene->getInstanceCount(j); k++) {
+            GpuObject object;
+            object.sphere = glm::vec4(bounds.center, bounds.radius);
+            object.modelIndex = j;
+            object.instanceIndex = pScene->getFirstInstance(j) + k;
+            object.firstLod = firstLod;
+            object.lodCount = pScene->getLodCount(j);
+            objects.push_back(object);
+        }
+    }
+    objectCount = static_cast<uint32_t>(objects.size());
+
+    createGeometryBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, objects.data(), sizeof(objects[0]) * objects.size(), objectBuffer, objectBufferAllocation);
+    createGeometryBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, lods.data(), sizeof(lods[0]) * lods.size(), lodBuffer, lodBufferAllocation);
+
+    //per image region: visible world matrices | draw commands | draw count
+    VkPhysicalDeviceProperties physicalDeviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+    VkDeviceSize alignment = std::max<VkDeviceSize>(physicalDeviceProperties.limits.minStorageBufferOffsetAlignment, 16);
+    auto alignUp = [alignment](VkDeviceSize value) {return (value + alignment - 1) / alignment * alignment;};
+
+    cullDrawsOffset = alignUp(sizeof(glm::mat4) * objectCount);
+    cullCountOffset = alignUp(cullDrawsOffset + sizeof(VkDrawIndexedIndirectCommand) * objectCount);
+    cullRegionSize = alignUp(cullCountOffset + sizeof(uint32_t));
+
+    createCullOutputBuffer();
+
+    VkDescriptorSetLayoutBinding layoutBindings[8];
+    for(uint32_t b = 0; b < 8; b++) {
+        layoutBindings[b] = {};
+        layoutBindings[b].binding = b;
+        layoutBindings[b].descriptorType = cullBindingTypes[b];
+        layoutBindings[b].descriptorCount = 1;
+        layoutBindings[b].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
     }
 
-    #include "shaders/frag.spv"
-    VkShaderModuleCreateInfo fragShaderModuleCreateInfo = {};
-    fragShaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    fragShaderModuleCreateInfo.codeSize = sizeof(fragShader);
-    fragShaderModuleCreateInfo.pCode = fragShader;
+    VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+    layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutCreateInfo.bindingCount = 8;
+    layoutCreateInfo.pBindings = layoutBindings;
 
-    if(vkCreateShaderModule(device, &fragShaderModuleCreateInfo, nullptr, &fragShaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("Could not create fragment shader module.");
+    if(vkCreateDescriptorSetLayout(device, &layoutCreateInfo, nullptr, &cullSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create cull descriptor set layout.");
     }
 
-    std::vector<VkPipelineShaderStageCreateInfo> shaderStagesCreateInfo(2);
-    VkPipelineShaderStageCreateInfo vertShaderStageCreateInfo = {};
-    vertShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = 2 * sizeof(uint32_t) + sizeof(float);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = &cullSetLayout;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+    if(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create cull pipeline layout.");
+    }
+
+    VkDescriptorPoolSize poolSizes[3];
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 4;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[1].descriptorCount = 1;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    poolSizes[2].descriptorCount = 3;
+
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+    descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolCreateInfo.maxSets = 1;
+    descriptorPoolCreateInfo.poolSizeCount = 3;
+    descriptorPoolCreateInfo.pPoolSizes = poolSizes;
+
+    if(vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &cullDescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create cull descriptor pool.");
+    }
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocInfo = {};
+    descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocInfo.descriptorPool = cullDescriptorPool;
+    descriptorSetAllocInfo.descriptorSetCount = 1;
+    descriptorSetAllocInfo.pSetLayouts = &cullSetLayout;
+
+    if(vkAllocateDescriptorSets(device, &descriptorSetAllocInfo, &cullDescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Could not allocate cull descriptor set.");
+    }
+
+    writeCullDescriptors();
+
+    std::cout << "GPU driven: " << objectCount << " objects, "
+              << (drawIndirectCountSupported ? "vkCmdDrawIndexedIndirectCount" : multiDrawIndirectSupported ? "vkCmdDrawIndexedIndirect fallback" : "one vkCmdDrawIndexedIndirect per object fallback") << '\n';
+}
+
+void VulkanBase::createCullOutputBuffer() {
+
+    //one region per swapchain image
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.size = cullRegionSize * swapchainImages.size();
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &cullOutputBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create cull output buffer.");
+    }
+
+    VkMemoryRequirements memReqs;
+    vkGetBufferMemoryRequirements(device, cullOutputBuffer, &memReqs);
+    cullOutputAllocation = allocator->allocate(memReqs, RESOURCE_KIND_BUFFER, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if(vkBindBufferMemory(device, cullOutputBuffer, cullOutputAllocation.memory, cullOutputAllocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("Could not bind cull output buffer to memory.");
+    }
+}
+
+void VulkanBase::writeCullDescriptors() {
+
+    //the dynamic bindings are offset by the image's VP slice and output region when bound
+    VkDescriptorBufferInfo bufferInfos[8];
+    bufferInfos[0] = {objectBuffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[1] = {instanceBuffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[2] = {ubo[0], 0, VK_WHOLE_SIZE};
+    bufferInfos[3] = {uniformRing->getBuffer(), 0, sizeof(VP)};
+    bufferInfos[4] = {cullOutputBuffer, 0, sizeof(glm::mat4) * objectCount};
+    bufferInfos[5] = {cullOutputBuffer, cullDrawsOffset, sizeof(VkDrawIndexedIndirectCommand) * objectCount};
+    bufferInfos[6] = {cullOutputBuffer, cullCountOffset, sizeof(uint32_t)};
+    bufferInfos[7] = {lodBuffer, 0, VK_WHOLE_SIZE};
+
+    VkWriteDescriptorSet writeDescriptorSets[8];
+    for(uint32_t b = 0; b < 8; b++) {
+        writeDescriptorSets[b] = {};
+        writeDescriptorSets[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeDescriptorSets[b].dstSet = cullDescriptorSet;
+        writeDescriptorSets[b].dstBinding = b;
+        writeDescriptorSets[b].descriptorCount = 1;
+        writeDescriptorSets[b].descriptorType = cullBindingTypes[b];
+        writeDescriptorSets[b].pBufferInfo = &bufferInfos[b];
+    }
+    vkUpdateDescriptorSets(device, 8, writeDescriptorSets, 0, nullptr);
+}
+
+VkPipeline VulkanBase::buildCullPipeline() {
+
+    VkShaderModule cullShaderModule = createShaderModule(settings.shaderDir + "/cull.comp.spv");
+
+    VkComputePipelineCreateInfo pipelineCreateInfo = {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineCreateInfo.stage.module = cullShaderModule;
+    pipelineCreateInfo.stage.pName = "main";
+    pipelineCreateInfo.layout = cullPipelineLayout;
+
+    VkPipeline newPipeline;
+    VkResult result = vkCreateComputePipelines(device, getPipelineCacheHandle(), 1, &pipelineCreateInfo, nullptr, &newPipeline);
+    vkDestroyShaderModule(device, cullShaderModule, nullptr);
+    if(result != VK_SUCCESS) {
+        throw std::runtime_error("Could not create cull pipeline.");
+    }
+    return newPipeline;
+}
+
+void VulkanBase::recordCulling(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+
+    VkDeviceSize regionOffset = imageIndex * cullRegionSize;
+    vkCmdFillBuffer(commandBuffer, cullOutputBuffer, regionOffset + cullCountOffset, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier clearBarrier = {};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    uint32_t dynamicOffsets[4];
+    dynamicOffsets[0] = vpOffsets[getUniformRegion(imageIndex)];
+    dynamicOffsets[1] = static_cast<uint32_t>(regionOffset);
+    dynamicOffsets[2] = static_cast<uint32_t>(regionOffset);
+    dynamicOffsets[3] = static_cast<uint32_t>(regionOffset);
+
+    //without a draw count every object keeps its own slot
+    updateLodParameters();
+    struct {
+        uint32_t objectCount;
+        uint32_t compact;
+        float lodScale;
+    } pushConstants = {objectCount, drawIndirectCountSupported ? 1u : 0u, lodScale};
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSet, 4, dynamicOffsets);
+    vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, (objectCount + 63) / 64, 1, 1);
+
+    VkMemoryBarrier cullBarrier = {};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanBase::recordIndirectDraws(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+
+    //the instance data already holds world matrices
+    uint32_t identityOffset = uniformRing->push(getUniformRegion(imageIndex), models.back());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[0], 1, &identityOffset);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(models[0]), &models.back());
+
+    VkDeviceSize drawsOffset = imageIndex * cullRegionSize + cullDrawsOffset;
+    uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    if(gpuZones.indirectDraws != GpuProfiler::NO_ZONE) {
+        gpuProfiler->beginZone(commandBuffer, imageIndex, gpuZones.indirectDraws);
+    }
+
+    if(drawIndirectCountSupported) {
+        pfnCmdDrawIndexedIndirectCount(commandBuffer, cullOutputBuffer, drawsOffset, cullOutputBuffer, imageIndex * cullRegionSize + cullCountOffset, objectCount, stride);
+        drawCount = 1;
+    }
+    else if(multiDrawIndirectSupported) {
+        vkCmdDrawIndexedIndirect(commandBuffer, cullOutputBuffer, drawsOffset, objectCount, stride);
+        drawCount = 1;
+    }
+    else {
+        for(uint32_t k = 0; k < objectCount; k++) {
+            vkCmdDrawIndexedIndirect(commandBuffer, cullOutputBuffer, drawsOffset + k * stride, 1, stride);
+        }
+        drawCount = objectCount;
+    }
+
+    if(gpuZones.indirectDraws != GpuProfiler::NO_ZONE) {
+        gpuProfiler->endZone(commandBuffer, imageIndex, gpuZones.indirectDraws);
+    }
+}
+
+void VulkanBase::createSceneBvh() {
+    CPU_ZONE("createSceneBvh");
+
+    //picking needs a window, culling --cull-bvh
+    if(settings.headless && !settings.cullBvh) {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+
+    //world space box of every instance, around the transformed corners of its model's box
+    const std::vector<glm::mat4> &instances = pScene->getInstanceTransforms();
+    std::vector<Aabb> bounds(instances.size());
+    instanceModels.resize(instances.size());
+    for(uint32_t j = 0; j < pScene->getModelCount(); j++) {
+        const Bounds &modelBounds = pScene->getBounds(j);
+        for(uint32_t k = pScene->getFirstInstance(j); k < pScene->getFirstInstance(j) + pScene->getInstanceCount(j); k++) {
+            glm::mat4 world = models[j] * instances[k];
+            Aabb box = {glm::vec3(1e30f), glm::vec3(-1e30f)};
+            for(int corner = 0; corner < 8; corner++) {
+                glm::vec3 local(corner & 1 ? modelBounds.max.x : modelBounds.min.x, corner & 2 ? modelBounds.max.y : modelBounds.min.y, corner & 4 ? modelBounds.max.z : modelBounds.min.z);
+                glm::vec3 point = glm::vec3(world * glm::vec4(local, 1.f));
+                box.min = glm::min(box.min, point);
+                box.max = glm::max(box.max, point);
+            }
+            bounds[k] = box;
+            instanceModels[k] = j;
+        }
+    }
+    sceneBvh.build(std::move(bounds));
+
+    std::cout << "Scene BVH: " << sceneBvh.getObjectCount() << " objects, " << sceneBvh.getNodeCount() << " nodes, depth " << sceneBvh.getDepth() << ", built in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count() << " ms" << std::endl;
+}
+
+bool VulkanBase::pick(int x, int y, uint32_t &model, uint32_t &instance, float &distance) {
+
+    if(sceneBvh.getObjectCount() == 0) {
+        return false;
+    }
+
+    //from the camera through the pixel's point on the far plane, y is already flipped in the projection
+    glm::vec4 ndc(2.f * (x + 0.5f) / extent.width - 1.f, 2.f * (y + 0.5f) / extent.height - 1.f, 1.f, 1.f);
+    glm::vec4 farPoint = glm::inverse(VP.projection * VP.view) * ndc;
+    glm::vec3 origin = glm::vec3(glm::inverse(VP.view)[3]);
+    glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+    const std::vector<Vertex> &vertices = pScene->getVerts();
+    const std::vector<uint32_t> &indices = pScene->getInds();
+    const std::vector<glm::mat4> &instances = pScene->getInstanceTransforms();
+
+    //the exact hit against the model's triangles, in model space. The direction is not
+    //renormalized there, so distances along it stay world space distances.
+    auto intersect = [&](uint32_t object) {
+        uint32_t j = instanceModels[object];
+        glm::mat4 toModel = glm::inverse(models[j] * instances[object]);
+        glm::vec3 modelOrigin = glm::vec3(toModel * glm::vec4(origin, 1.f));
+        glm::vec3 modelDirection = glm::vec3(toModel * glm::vec4(direction, 0.f));
+
+        uint32_t start = pScene->getFirstIndex(j);
+        uint32_t end = start + pScene->getIndexCount(j);
+        float nearest = -1.f;
+        for(uint32_t i = start; i + 3 <= end; i += 3) {
+            float t = intersectTriangle(modelOrigin, modelDirection, vertices[indices[i]].pos, vertices[indices[i + 1]].pos, vertices[indices[i + 2]].pos);
+            if(t >= 0.f && (nearest < 0.f || t < nearest)) {
+                nearest = t;
+            }
+        }
+        return nearest;
+    };
+
+    uint32_t object;
+    if(!sceneBvh.raycast(origin, direction, intersect, object, distance)) {
+        return false;
+    }
+    model = instanceModels[object];
+    instance = object - pScene->getFirstInstance(model);
+    return true;
+}
+
+void VulkanBase::finishUploads() {
+    CPU_ZONE("finishUploads");
+
+    stagingRing->finish();
+
+    double uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+    VkDeviceSize geometryBytes = vertexStride * pScene->getVerts().size() + sizeof(uint32_t) * pScene->getInds().size() + sizeof(glm::mat4) * pScene->getInstanceTransforms().size();
+    std::cout << "Geometry upload: " << geometryBytes / (1024.0 * 1024.0) << " MB in " << uploadMs << " ms, "
+              << (settings.hostVisibleGeometry ? "host visible" : "device local") << ", "
+              << stagingRing->getSubmitCount() << " staging submits on queue family " << transferQueueIndex << '\n';
+}
+
+void VulkanBase::createGraphicsPipeline() {
+    CPU_ZONE("createGraphicsPipeline");
+
+    std::chrono::steady_clock::time_point pipelineStart = std::chrono::steady_clock::now();
+    pipelineBuilder = new PipelineBuilder(settings.pipelineThreads);
+
+    //every variant starts compiling now, but only the ones the first frame draws with are waited on
+    drawVariant = settings.wireframe ? GRAPHICS_VARIANT_WIREFRAME : GRAPHICS_VARIANT_DEFAULT;
+    graphicsPipelines.assign(GRAPHICS_VARIANT_COUNT, VK_NULL_HANDLE);
+    graphicsPipelineIds.assign(GRAPHICS_VARIANT_COUNT, UINT32_MAX);
+    for(uint32_t v = 0; v < GRAPHICS_VARIANT_COUNT; v++) {
+        if(isGraphicsVariantSupported(v)) {
+            graphicsPipelineIds[v] = pipelineBuilder->add(graphicsVariants[v].name, [this, v]() {return buildGraphicsPipeline(graphicsVariants[v]);});
+        }
+    }
+    uint32_t cullPipelineId = UINT32_MAX;
+    if(settings.gpuDriven) {
+        cullPipelineId = pipelineBuilder->add("cull", [this]() {return buildCullPipeline();});
+    }
+
+    graphicsPipelines[drawVariant] = pipelineBuilder->get(graphicsPipelineIds[drawVariant]);
+    pipeline = graphicsPipelines[drawVariant];
+    if(settings.gpuDriven) {
+        cullPipeline = pipelineBuilder->get(cullPipelineId);
+    }
+    pipelineCreateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count();
+
+    std::cout << "Pipelines for the first frame ready in " << pipelineCreateMs << " ms ("
+              << (!pipelineCache ? "no pipeline cache" : pipelineCache->isWarm() ? "warm pipeline cache" : "cold pipeline cache") << ")\n";
+}
+
+bool VulkanBase::isGraphicsVariantSupported(uint32_t variant) {
+    return graphicsVariants[variant].polygonMode == VK_POLYGON_MODE_FILL || fillModeNonSolidSupported;
+}
+
+void VulkanBase::collectPipelines() {
+
+    //waits for the variants still compiling in the background
+    for(uint32_t v = 0; v < GRAPHICS_VARIANT_COUNT; v++) {
+        if(graphicsPipelines[v] == VK_NULL_HANDLE && graphicsPipelineIds[v] != UINT32_MAX) {
+            //nothing draws with these yet, so a failed build only loses the variant
+            try {
+                graphicsPipelines[v] = pipelineBuilder->get(graphicsPipelineIds[v]);
+            } catch(const std::exception &e) {
+                std::cout << "Pipeline variant " << graphicsVariants[v].name << " not available: " << e.what() << '\n';
+            }
+            graphicsPipelineIds[v] = UINT32_MAX;
+        }
+    }
+}
+
+VkShaderModule VulkanBase::createShaderModule(const std::string &path) {
+
+    std::vector<uint32_t> code = loadSpirv(path);
+
+    VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+    shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderModuleCreateInfo.codeSize = code.size() * sizeof(uint32_t);
+    shaderModuleCreateInfo.pCode = code.data();
+
+    VkShaderModule shaderModule;
+    if(vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create shader module from " + path + '.');
+    }
+    return shaderModule;
+}
+
+VkPipeline VulkanBase::buildGraphicsPipeline(const GraphicsVariant &variant) {
+
+    VkShaderModule vertShaderModule = createShaderModule(settings.shaderDir + "/shader.vert.spv");
+    VkShaderModule fragShaderModule;
+    try {
+        fragShaderModule = createShaderModule(settings.shaderDir + "/shader.frag.spv");
+    } catch(...) {
+        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        throw;
+    }
+
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStagesCreateInfo(2);
+    VkPipelineShaderStageCreateInfo vertShaderStageCreateInfo = {};
+    vertShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
     vertShaderStageCreateInfo.module = vertShaderModule;
     vertShaderStageCreateInfo.pName = "main";
 
+    struct {
+        VkBool32 modelFromUbo;
+        int32_t vertexLayout;
+        float positionScale;
+    } specializationData = {settings.modelUbo ? VK_TRUE : VK_FALSE, static_cast<int32_t>(settings.vertexLayout), positionScale};
+    VkSpecializationMapEntry specializationMapEntries[3] = {
+        {0, offsetof(decltype(specializationData), modelFromUbo), sizeof(VkBool32)},
+        {1, offsetof(decltype(specializationData), vertexLayout), sizeof(int32_t)},
+        {2, offsetof(decltype(specializationData), positionScale), sizeof(float)}
+    };
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 3;
+    specializationInfo.pMapEntries = specializationMapEntries;
+    specializationInfo.dataSize = sizeof(specializationData);
+    specializationInfo.pData = &specializationData;
+    vertShaderStageCreateInfo.pSpecializationInfo = &specializationInfo;
+
     VkPipelineShaderStageCreateInfo fragShaderStageCreateInfo = {};
     fragShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -972,37 +2099,37 @@ void VulkanBase::createGraphicsPipeline() {
     dynamicState.dynamicStateCount = 0;
 
 
-    VkVertexInputAttributeDescription attribDescription[3];
-    attribDescription[0] = {};
-    attribDescription[0].location = 0;
-    attribDescription[0].binding = 0;
-    attribDescription[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attribDescription[0].offset = 0;
+    //the vertex layout's own attributes, then the instance matrix
+    VkVertexInputAttributeDescription attribDescription[7];
+    std::copy(vertexAttributes.begin(), vertexAttributes.end(), attribDescription);
 
-    attribDescription[1] = {};
-    attribDescription[1].location = 1;
-    attribDescription[1].binding = 0;
-    attribDescription[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attribDescription[1].offset = 12;
+    //the instance matrix takes one location per column
+    for(uint32_t column = 0; column < 4; column++) {
+        attribDescription[3 + column] = {};
+        attribDescription[3 + column].location = 3 + column;
+        attribDescription[3 + column].binding = 1;
+        attribDescription[3 + column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attribDescription[3 + column].offset = column * sizeof(glm::vec4);
+    }
 
-    attribDescription[2] = {};
-    attribDescription[2].location = 2;
-    attribDescription[2].binding = 0;
-    attribDescription[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attribDescription[2].offset = 24;
+    VkVertexInputBindingDescription bindingDescriptions[2];
+    bindingDescriptions[0] = {};
+    bindingDescriptions[0].binding = 0;
+    bindingDescriptions[0].stride = vertexStride;
+    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    VkVertexInputBindingDescription bindingDescription = {};
-    bindingDescription.binding = 0;
-    bindingDescription.stride = sizeof(vertices[0]);
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    bindingDescriptions[1] = {};
+    bindingDescriptions[1].binding = 1;
+    bindingDescriptions[1].stride = sizeof(glm::mat4);
+    bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
 
     VkPipelineVertexInputStateCreateInfo vertInputStateCreateInfo = {};
     vertInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertInputStateCreateInfo.vertexAttributeDescriptionCount = 3;
+    vertInputStateCreateInfo.vertexAttributeDescriptionCount = 7;
     vertInputStateCreateInfo.pVertexAttributeDescriptions = attribDescription;
-    vertInputStateCreateInfo.vertexBindingDescriptionCount = 1;
-    vertInputStateCreateInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertInputStateCreateInfo.vertexBindingDescriptionCount = 2;
+    vertInputStateCreateInfo.pVertexBindingDescriptions = bindingDescriptions;
 
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
     inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -1011,18 +2138,19 @@ void VulkanBase::createGraphicsPipeline() {
 
     VkPipelineRasterizationStateCreateInfo rastCreateInfo = {};
     rastCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rastCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-    rastCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+    rastCreateInfo.polygonMode = variant.polygonMode;
+    rastCreateInfo.cullMode = variant.cullMode;
     //rastCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
     rastCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     rastCreateInfo.depthClampEnable = VK_FALSE;
     rastCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-    rastCreateInfo.depthBiasEnable = VK_FALSE;
-    rastCreateInfo.depthBiasConstantFactor = 0;
+    rastCreateInfo.depthBiasEnable = variant.depthBias ? VK_TRUE : VK_FALSE;
+    rastCreateInfo.depthBiasConstantFactor = variant.depthBias ? 1.25f : 0.f;
+    rastCreateInfo.depthBiasSlopeFactor = variant.depthBias ? 1.75f : 0.f;
     rastCreateInfo.lineWidth = 1.f;
 
     VkPipelineColorBlendAttachmentState colorBlendAttachmentState = {};
-    colorBlendAttachmentState.colorWriteMask = 0xf;
+    colorBlendAttachmentState.colorWriteMask = variant.colorWrite ? 0xf : 0;
     colorBlendAttachmentState.blendEnable = VK_FALSE;
     colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
     colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
@@ -1095,88 +2223,620 @@ void VulkanBase::createGraphicsPipeline() {
     pipelineCreateInfo.renderPass = renderPass;
     pipelineCreateInfo.subpass = 0;
 
-    if(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
-        throw std::runtime_error("Could not create pipeline.");
-    }
+    VkPipeline newPipeline;
+    VkResult result = vkCreateGraphicsPipelines(device, getPipelineCacheHandle(), 1, &pipelineCreateInfo, nullptr, &newPipeline);
     vkDestroyShaderModule(device, vertShaderModule, nullptr);
     vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    if(result != VK_SUCCESS) {
+        throw std::runtime_error("Could not create pipeline.");
+    }
+    return newPipeline;
 }
 
-        void VulkanBase::draw() {
+void VulkanBase::startShaderHotReload() {
+    CPU_ZONE("startShaderHotReload");
+
+    if(!settings.hotReload) {
+        return;
+    }
+
+    shaderWatcher = new ShaderWatcher(settings.shaderDir, [this](const std::vector<std::string> &changed) {
+        reloadShaders(changed);
+    });
+    std::cout << "Watching " << settings.shaderDir << " for SPIR-V changes\n";
+}
 
-            uint32_t imageIndex;
-            if(vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex) != VK_SUCCESS) {
-                    throw std::runtime_error("Could not aquire next swapchain image.");
-                    }
+void VulkanBase::reloadShaders(const std::vector<std::string> &changed) {
 
-           VkPipelineStageFlags pipelineStageFlags = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    //runs on the watcher thread. Only the pipelines using a changed file are rebuilt,
+    //the live ones are swapped out by draw() at the start of the next frame.
+    bool graphicsChanged = false;
+    bool cullChanged = false;
+    for(const std::string &name : changed) {
+        graphicsChanged |= name == "shader.vert.spv" || name == "shader.frag.spv";
+        cullChanged |= name == "cull.comp.spv" && settings.gpuDriven;
+    }
+
+    if(!graphicsChanged && !cullChanged) {
+        return;
+    }
+
+    //the variants are rebuilt in parallel like at startup
+    std::chrono::steady_clock::time_point reloadStart = std::chrono::steady_clock::now();
+    std::vector<uint32_t> ids(GRAPHICS_VARIANT_COUNT, UINT32_MAX);
+    uint32_t cullId = UINT32_MAX;
+    for(uint32_t v = 0; v < GRAPHICS_VARIANT_COUNT && graphicsChanged; v++) {
+        if(isGraphicsVariantSupported(v)) {
+            ids[v] = pipelineBuilder->add(std::string(graphicsVariants[v].name) + " (reload)", [this, v]() {return buildGraphicsPipeline(graphicsVariants[v]);});
+        }
+    }
+    if(cullChanged) {
+        cullId = pipelineBuilder->add("cull (reload)", [this]() {return buildCullPipeline();});
+    }
+
+    std::vector<VkPipeline> newPipelines(GRAPHICS_VARIANT_COUNT, VK_NULL_HANDLE);
+    VkPipeline newCullPipeline = VK_NULL_HANDLE;
+    std::string error;
+    for(uint32_t v = 0; v < GRAPHICS_VARIANT_COUNT; v++) {
+        try {
+            if(ids[v] != UINT32_MAX) {
+                newPipelines[v] = pipelineBuilder->get(ids[v]);
+            }
+        } catch(const std::exception &e) {
+            error = e.what();
+        }
+    }
+    try {
+        if(cullId != UINT32_MAX) {
+            newCullPipeline = pipelineBuilder->get(cullId);
+        }
+    } catch(const std::exception &e) {
+        error = e.what();
+    }
 
-           VkSubmitInfo submitInfo = {};
-           submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-           submitInfo.waitSemaphoreCount = 1;
-           submitInfo.pWaitSemaphores = &imageAvailableSemaphore;
-           submitInfo.pWaitDstStageMask = &pipelineStageFlags;
-           submitInfo.commandBufferCount = 1;
-           submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
-           submitInfo.signalSemaphoreCount = 1;
-           submitInfo.pSignalSemaphores = &renderFinishedSemaphore;
+    if(!error.empty()) {
+        //a broken shader keeps the old pipelines running
+        std::cout << "Shader reload failed: " << error << '\n';
+        for(VkPipeline newPipeline : newPipelines) {
+            if(newPipeline != VK_NULL_HANDLE) {
+                vkDestroyPipeline(device, newPipeline, nullptr);
+            }
+        }
+        if(newCullPipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, newCullPipeline, nullptr);
+        }
+        return;
+    }
 
+    std::lock_guard<std::mutex> lock(pendingPipelineMutex);
+    //a rebuild that was never picked up is simply replaced
+    if(graphicsChanged) {
+        for(VkPipeline pendingPipeline : pendingPipelines) {
+            if(pendingPipeline != VK_NULL_HANDLE) {
+                vkDestroyPipeline(device, pendingPipeline, nullptr);
+            }
+        }
+        pendingPipelines = newPipelines;
+    }
+    if(newCullPipeline != VK_NULL_HANDLE) {
+        if(pendingCullPipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, pendingCullPipeline, nullptr);
+        }
+        pendingCullPipeline = newCullPipeline;
+    }
+    pipelinesPending = true;
 
-           if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
-               throw std::runtime_error("Could not submit draw command buffer");
-           } 
+    std::cout << "Reloaded " << (graphicsChanged ? "graphics " : "") << (cullChanged ? "cull " : "") << "pipeline in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - reloadStart).count() << " ms\n";
+}
 
+void VulkanBase::swapPendingPipelines() {
 
-           VkPresentInfoKHR presentInfo = {};
-           presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-           presentInfo.swapchainCount = 1;
-           presentInfo.pSwapchains = &swapchain;
-           presentInfo.pImageIndices = &imageIndex;
-           presentInfo.waitSemaphoreCount = 1;
-           presentInfo.pWaitSemaphores = &renderFinishedSemaphore;
-           presentInfo.pResults = nullptr;
+    std::vector<VkPipeline> newPipelines;
+    VkPipeline newCullPipeline;
+    {
+        std::lock_guard<std::mutex> lock(pendingPipelineMutex);
+        newPipelines.swap(pendingPipelines);
+        newCullPipeline = pendingCullPipeline;
+        pendingCullPipeline = VK_NULL_HANDLE;
+        pipelinesPending = false;
+    }
 
-           if (vkQueuePresentKHR(presentQueue, &presentInfo) != VK_SUCCESS) {
-               throw std::runtime_error("Could not present.");
-           }
+    //the old pipelines may still be in use by frames in flight
+    collectPipelines();
+    vkWaitForFences(device, static_cast<uint32_t>(inFlightFences.size()), inFlightFences.data(), VK_TRUE, UINT64_MAX);
 
-           vkQueueWaitIdle(presentQueue);
+    for(uint32_t v = 0; v < newPipelines.size(); v++) {
+        if(newPipelines[v] != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, graphicsPipelines[v], nullptr);
+            graphicsPipelines[v] = newPipelines[v];
         }
+    }
+    pipeline = graphicsPipelines[drawVariant];
+    if(newCullPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, cullPipeline, nullptr);
+        cullPipeline = newCullPipeline;
+    }
 
+    //prerecorded command buffers hold the old handles
+    if(!settings.rerecord) {
+        recordCommandBuffers();
+    }
+}
 
-        void VulkanBase::createSyncObjects() {
-    
-            VkSemaphoreCreateInfo semaphoreCreateInfo = {};
-            semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-            if((vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS) 
-            ||
-//
-            (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS)) 
-            {
-                throw std::runtime_error("Could not create semaphores.");
+void VulkanBase::createPipelineCache() {
+    CPU_ZONE("createPipelineCache");
+
+    if(!settings.pipelineCache) {
+        return;
+    }
+
+    pipelineCache = new PipelineCache(device, physicalDevice, settings.pipelineCachePath);
+    if(!pipelineCache->isWarm()) {
+        std::cout << "Pipeline cache " << settings.pipelineCachePath << " not used (" << pipelineCache->getRejectReason() << "), starting cold\n";
+    }
+}
+
+VkPipelineCache VulkanBase::getPipelineCacheHandle() {
+    return pipelineCache ? pipelineCache->getHandle() : VK_NULL_HANDLE;
+}
+
+void VulkanBase::draw() {
+
+    CPU_ZONE("draw");
+
+    if(pipelinesPending) {
+        swapPendingPipelines();
+    }
+
+    //a minimized window has nothing to render to until it is restored
+    if(resizePending && !recreateSwapchain()) {
+        return;
+    }
+
+    //prerecorded draws keep the levels they were recorded with, so they are recorded again as soon
+    //as the camera selects another level for any of them
+    if(!settings.rerecord && settings.lodCount > 0 && recordedLodsChanged()) {
+        waitIdle();
+        recordCommandBuffers();
+    }
+
+    //wait until the GPU is done with the frame that last used this slot
+    {
+        CPU_ZONE("wait for frame");
+        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    uint32_t imageIndex;
+    {
+        CPU_ZONE("acquire");
+        if(settings.headless) {
+            imageIndex = currentFrame;
+        }
+        else {
+            //a suboptimal image can still be presented, the swapchain is replaced after that
+            VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+            if(result == VK_ERROR_OUT_OF_DATE_KHR) {
+                resizePending = true;
+                return;
             }
+            if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+                throw std::runtime_error("Could not aquire next swapchain image.");
+            }
+        }
+
+        //the swapchain can hand out images out of order, so also wait on whichever frame is still rendering to this image
+        if(imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+            vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        }
+    }
+    imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+
+    //the previous submission of this command buffer has completed, so its timestamps are available
+    if(gpuProfiler) {
+        gpuProfiler->collect(imageIndex);
+    }
+
+    //the resolution of this frame, from the newest GPU time collected
+    if(resolutionScaler) {
+        updateRenderExtent();
+    }
+
+    //re-recorded frames write the current VP while recording
+    if(!settings.rerecord && vpSliceDirty[imageIndex]) {
+        writeVPSlice(imageIndex);
+    }
+
+    VkCommandBuffer commandBuffer = settings.rerecord ? recordFrame(imageIndex) : commandBuffers[imageIndex];
+
+    VkPipelineStageFlags pipelineStageFlags = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = settings.headless ? 0 : 1;
+    submitInfo.pWaitSemaphores = &imageAvailableSemaphores[currentFrame];
+    submitInfo.pWaitDstStageMask = &pipelineStageFlags;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = settings.headless ? 0 : 1;
+    submitInfo.pSignalSemaphores = &renderFinishedSemaphores[currentFrame];
+
+    vkResetFences(device, 1, &inFlightFences[currentFrame]);
+
+    {
+        CPU_ZONE("submit");
+        if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+            throw std::runtime_error("Could not submit draw command buffer");
+        }
+    }
+    if(gpuProfiler) {
+        gpuProfiler->submitted(imageIndex);
+    }
+
+    if(settings.headless) {
+        currentFrame = (currentFrame + 1) % settings.framesInFlight;
+        return;
+    }
+
+    CPU_ZONE("present");
+    VkPresentInfoKHR presentInfo = {};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &swapchain;
+    presentInfo.pImageIndices = &imageIndex;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
+    presentInfo.pResults = nullptr;
+
+    VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        resizePending = true;
+    }
+    else if(result != VK_SUCCESS) {
+        throw std::runtime_error("Could not present.");
+    }
+
+    currentFrame = (currentFrame + 1) % settings.framesInFlight;
+}
+
+
+void VulkanBase::resize(uint32_t width, uint32_t height) {
+
+    requestedExtent = {width, height};
+    resizePending = true;
+}
+
+uint32_t VulkanBase::getSwapchainRecreateCount() {
+    return swapchainRecreations;
+}
+
+bool VulkanBase::recreateSwapchain() {
+
+    CPU_ZONE("recreateSwapchain");
+
+    VkExtent2D newExtent = requestedExtent;
+    if(!settings.headless) {
+        VkSurfaceCapabilitiesKHR surfaceCapabilities;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities);
+        newExtent = getSwapExtent(surfaceCapabilities);
+    }
+    if(newExtent.width == 0 || newExtent.height == 0) {
+        return false;
+    }
+
+    //frames in flight still read the framebuffers and the depth image
+    waitIdle();
+
+    //the render pass, pipelines and descriptors don't depend on the extent and are kept
+    size_t imageCount = swapchainImages.size();
+    destroySwapchainResources();
+    createSwapchain();
+    createImageViews();
+    createDepthBuffer();
+    createSceneTarget();
+    createFramebuffers();
+    if(swapchainImages.size() != imageCount) {
+        resizePerImageState();
+    }
+
+    updateProjection();
+    updateMVP();
+    std::fill(imagesInFlight.begin(), imagesInFlight.end(), VK_NULL_HANDLE);
+    //prerecorded command buffers hold the old framebuffers and render area
+    if(!settings.rerecord) {
+        recordCommandBuffers();
+    }
+
+    resizePending = false;
+    swapchainRecreations++;
+    return true;
+}
+
+void VulkanBase::resizePerImageState() {
+
+    //nothing is in flight, so the old regions, slots and command buffers can go right away
+    imagesInFlight.assign(swapchainImages.size(), VK_NULL_HANDLE);
+    //re-recording keeps a ring region per frame in flight instead
+    if(!settings.rerecord) {
+        delete uniformRing;
+        createUniformRing();
+        writeUniformRingDescriptors();
+    }
+    if(settings.gpuDriven) {
+        vkDestroyBuffer(device, cullOutputBuffer, nullptr);
+        allocator->free(cullOutputAllocation);
+        createCullOutputBuffer();
+        writeCullDescriptors();
+    }
+    if(gpuProfiler) {
+        gpuProfiler->setSlotCount(static_cast<uint32_t>(swapchainImages.size()));
+    }
+    if(!settings.rerecord) {
+        allocateCommandBuffers();
+    }
+}
+
+void VulkanBase::destroySwapchainResources() {
+
+    for(VkFramebuffer framebuffer : framebuffers) {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    vkDestroyImageView(device, depthImageView, nullptr);
+    vkDestroyImage(device, depthImage, nullptr);
+    allocator->free(depthAllocation);
+    if(resolutionScaler) {
+        vkDestroyImageView(device, sceneImageView, nullptr);
+        vkDestroyImage(device, sceneImage, nullptr);
+        allocator->free(sceneAllocation);
+    }
+    for (VkImageView imageView : swapchainImageViews) {
+        vkDestroyImageView(device, imageView, nullptr);
+    }
+    //swapchain images belong to the swapchain, offscreen ones to the engine
+    if(settings.headless) {
+        for(size_t i = 0; i < swapchainImages.size(); i++) {
+            vkDestroyImage(device, swapchainImages[i], nullptr);
+            allocator->free(offscreenAllocations[i]);
+        }
+    }
+}
+
+void VulkanBase::updateProjection() {
+
+    VP.projection = glm::perspective(45.f, (float)extent.width / (float)extent.height, 0.1f, 100.f);
+    //account for glm y down
+    VP.projection[1][1] *= -1;
+}
+
+void VulkanBase::createGpuProfiler() {
+    CPU_ZONE("createGpuProfiler");
+
+    if(timestampValidBits == 0) {
+        std::cout << "Graphics queue does not support timestamps, GPU time will not be reported.\n";
+        return;
+    }
+
+    VkPhysicalDeviceProperties physicalDeviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+
+    //frame, cull, render pass, indirect draws and upscale, then one zone per draw item
+    uint32_t maxZones = 5;
+    if(settings.gpuProfileDraws && !settings.gpuDriven) {
+        for(uint32_t j = 0; j < pScene->getModelCount(); j++) {
+            maxZones += settings.instancing ? 1 : pScene->getInstanceCount(j);
+        }
+    }
+    gpuProfiler = new GpuProfiler(device, physicalDeviceProperties.limits.timestampPeriod, timestampValidBits,
+                                  static_cast<uint32_t>(swapchainImages.size()), maxZones, !settings.gpuTracePath.empty());
+}
+
+void VulkanBase::reserveGpuZones(uint32_t imageIndex) {
+
+    gpuZones = GpuZones();
+    if(!gpuProfiler) {
+        return;
+    }
+
+    gpuProfiler->beginSlot(imageIndex);
+    gpuZones.frame = gpuProfiler->reserveZones(imageIndex, "frame");
+    if(settings.gpuDriven) {
+        gpuZones.cull = gpuProfiler->reserveZones(imageIndex, "cull");
+    }
+    gpuZones.renderPass = gpuProfiler->reserveZones(imageIndex, "render pass");
+    if(resolutionScaler) {
+        gpuZones.upscale = gpuProfiler->reserveZones(imageIndex, "upscale");
+    }
+    if(settings.gpuProfileDraws) {
+        if(settings.gpuDriven) {
+            gpuZones.indirectDraws = gpuProfiler->reserveZones(imageIndex, "indirect draws");
+        }
+        //tagged with the draw item, so the trace tells the draws apart
+        gpuZones.firstDraw = gpuProfiler->reserveZones(imageIndex, "draw", static_cast<uint32_t>(visibleCount), visibleItems.data());
+    }
+}
+
+double VulkanBase::getLastGpuTimeMs() {
+    return gpuProfiler ? gpuProfiler->getStats("frame").lastMs : 0.0;
+}
+
+double VulkanBase::getAverageGpuTimeMs() {
+
+    if(!gpuProfiler) {
+        return 0.0;
+    }
+    GpuProfiler::ZoneStats frame = gpuProfiler->getStats("frame");
+    return frame.samples == 0 ? 0.0 : frame.totalMs / frame.samples;
+}
+
+uint64_t VulkanBase::getTriangleCount() {
+    return triangleCount;
+}
+
+GpuProfiler::ZoneStats VulkanBase::getGpuFrameStats() {
+    return gpuProfiler ? gpuProfiler->getStats("frame") : GpuProfiler::ZoneStats{"frame", 0, 0.0, 0.0, 0.0, 0.0, 0.0};
+}
+
+void VulkanBase::clearGpuStats() {
+
+    waitIdle();
+    if(gpuProfiler) {
+        gpuProfiler->clearStats();
+    }
+}
+
+float VulkanBase::getRenderScale() {
+    return resolutionScaler ? resolutionScaler->getScale() : 1.f;
+}
+
+float VulkanBase::getAverageRenderScale() {
+    return resolutionScaler ? resolutionScaler->getAverageScale() : 1.f;
+}
+
+MemoryStats VulkanBase::getMemoryStats() {
+    return allocator->getStats();
+}
+
+std::string VulkanBase::getDeviceName() {
+    return deviceName;
+}
+
+double VulkanBase::getCullTimeMs() {
+    return cullTimeMs;
+}
+
+uint32_t VulkanBase::getDrawCount() {
+    return drawCount;
+}
+
+double VulkanBase::getRecordTimeMs() {
+    return recordTimeMs;
+}
+
+void VulkanBase::waitIdle() {
+    vkDeviceWaitIdle(device);
+    //every submission is done, so the last frames' timestamps can be read as well
+    if(gpuProfiler) {
+        gpuProfiler->collectAll();
+    }
+}
+
+void VulkanBase::createSyncObjects() {
+    CPU_ZONE("createSyncObjects");
+
+    imageAvailableSemaphores.resize(settings.framesInFlight);
+    renderFinishedSemaphores.resize(settings.framesInFlight);
+    inFlightFences.resize(settings.framesInFlight);
+    imagesInFlight.assign(swapchainImages.size(), VK_NULL_HANDLE);
+
+    VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
+    //fences start signaled so the first wait on each frame slot returns immediately
+    VkFenceCreateInfo fenceCreateInfo = {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    for(size_t i = 0; i < settings.framesInFlight; i++) {
+        if((vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS) 
+        ||
+        (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)) 
+        {
+            throw std::runtime_error("Could not create semaphores.");
+        }
+
+        if(vkCreateFence(device, &fenceCreateInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Could not create fence.");
         }
+    }
+}
 
-//TODO: use push constants instead of ubo buffer
 void VulkanBase::updateMVP() {
 
+    CPU_ZONE("updateMVP");
     //MVP = projection * view * model;
-    std::memcpy(pUboData[1], &VP, sizeof(VP));
+    //slices still in use by the GPU are refreshed by draw() once their image comes back around
+    std::fill(vpSliceDirty.begin(), vpSliceDirty.end(), true);
+}
+
+void VulkanBase::writeVPSlice(uint32_t region) {
+
+    std::memcpy(uniformRing->getPointer(vpOffsets[region]), &VP, sizeof(VP));
+    vpSliceDirty[region] = false;
+}
+
+uint32_t VulkanBase::getUniformRegion(uint32_t imageIndex) {
+    return settings.rerecord ? currentFrame : imageIndex;
 }
 
 void VulkanBase::cleanUp() {
-    vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
-    vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-    vkDestroyPipeline(device, pipeline, nullptr);
-    vkFreeMemory(device, indexBufferMemory, nullptr);
+    //stop the watcher first so no rebuild races the teardown
+    delete shaderWatcher;
+    vkDeviceWaitIdle(device);
+    collectPipelines();
+    for(VkPipeline pendingPipeline : pendingPipelines) {
+        if(pendingPipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, pendingPipeline, nullptr);
+        }
+    }
+    if(pendingCullPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, pendingCullPipeline, nullptr);
+    }
+    for(size_t i = 0; i < settings.framesInFlight; i++) {
+        vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
+        vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
+        vkDestroyFence(device, inFlightFences[i], nullptr);
+    }
+    if(gpuProfiler) {
+        gpuProfiler->collectAll();
+        if(settings.gpuProfile) {
+            gpuProfiler->printStats(std::cout);
+        }
+        if(!settings.gpuTracePath.empty()) {
+            try {
+                gpuProfiler->writeChromeTrace(settings.gpuTracePath);
+                std::cout << "GPU trace written to " << settings.gpuTracePath << ".\n";
+            } catch(const std::exception &e) {
+                std::cout << e.what() << '\n';
+            }
+        }
+        delete gpuProfiler;
+    }
+    for(VkPipeline graphicsPipeline : graphicsPipelines) {
+        if(graphicsPipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, graphicsPipeline, nullptr);
+        }
+    }
+    pipelineBuilder->printStats(std::cout);
+    delete pipelineBuilder;
+    if(pipelineCache) {
+        //a failed save only costs the next start its warm cache
+        try {
+            pipelineCache->save();
+        } catch(const std::exception &e) {
+            std::cout << e.what() << '\n';
+        }
+        delete pipelineCache;
+    }
+    delete stagingRing;
     vkDestroyBuffer(device, indexBuffer, nullptr);
-    vkFreeMemory(device, vertBufferMemory, nullptr);
-    vkDestroyBuffer(device, vertBuffer, nullptr);
-    for(VkFramebuffer framebuffer : framebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    allocator->free(indexBufferAllocation);
+    vkDestroyBuffer(device, instanceBuffer, nullptr);
+    allocator->free(instanceBufferAllocation);
+    if(settings.gpuDriven) {
+        vkDestroyPipeline(device, cullPipeline, nullptr);
+        vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+        vkDestroyDescriptorPool(device, cullDescriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(device, cullSetLayout, nullptr);
+        vkDestroyBuffer(device, cullOutputBuffer, nullptr);
+        allocator->free(cullOutputAllocation);
+        vkDestroyBuffer(device, objectBuffer, nullptr);
+        allocator->free(objectBufferAllocation);
+        vkDestroyBuffer(device, lodBuffer, nullptr);
+        allocator->free(lodBufferAllocation);
     }
+    vkDestroyBuffer(device, vertBuffer, nullptr);
+    allocator->free(vertBufferAllocation);
+    destroySwapchainResources();
     vkDestroyRenderPass(device, renderPass, nullptr);
     for(VkDescriptorSetLayout descriptorSetLayout : descriptorSetLayouts) {
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
@@ -1184,20 +2844,31 @@ void VulkanBase::cleanUp() {
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 
-    vkFreeMemory(device, uboMemory[0], nullptr);
     vkDestroyBuffer(device, ubo[0], nullptr);
-    vkFreeMemory(device, uboMemory[1], nullptr);
-    vkDestroyBuffer(device, ubo[1], nullptr);
+    allocator->free(uboAllocations[0]);
+    std::cout << "Uniform ring peak usage: " << uniformRing->getPeakUsage() << " bytes per region\n";
+    delete uniformRing;
+    delete resolutionScaler;
     delete cam;
-    vkDestroyImageView(device, depthImageView, nullptr);
-    vkDestroyImage(device, depthImage, nullptr);
-    vkFreeMemory(device, depthMemory, nullptr);
-    vkDestroyCommandPool(device, commandPool, nullptr);
-    for (VkImageView imageView : swapchainImageViews) {
-        vkDestroyImageView(device, imageView, nullptr);
+    if(settings.rerecord) {
+        delete recordThreads;
+        for(FrameCommands &frame : frameCommands) {
+            for(VkCommandPool pool : frame.slicePools) {
+                vkDestroyCommandPool(device, pool, nullptr);
+            }
+            vkDestroyCommandPool(device, frame.primaryPool, nullptr);
+        }
+    }
+    else {
+        vkDestroyCommandPool(device, commandPool, nullptr);
+    }
+    if(!settings.headless) {
+        vkDestroySwapchainKHR(device, swapchain, nullptr);
+        vkDestroySurfaceKHR(instance, surface, nullptr);
     }
-    vkDestroySwapchainKHR(device, swapchain, nullptr);
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    allocator->printStats(std::cout);
+    delete allocator;
+    delete memoryBackend;
     vkDestroyDevice(device, nullptr);
     vkDestroyInstance(instance, nullptr);
 }
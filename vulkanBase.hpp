@@ -7,18 +7,57 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <array>
 
 #include "window.hpp"
 #include "camera.hpp"
 #include "vertex.hpp"
+#include "vertexLayout.hpp"
 #include "model.hpp"
+#include "settings.hpp"
+#include "stagingRing.hpp"
+#include "memoryAllocator.hpp"
+#include "vulkanMemoryBackend.hpp"
+#include "threadPool.hpp"
+#include "pipelineCache.hpp"
+#include "shaderWatcher.hpp"
+#include "pipelineBuilder.hpp"
+#include "uniformRing.hpp"
+#include "frustumCull.hpp"
+#include "bvh.hpp"
+#include "gpuProfiler.hpp"
+#include "cpuProfiler.hpp"
+#include "resolutionScaler.hpp"
+
+#define STAGING_RING_SIZE (16 * 1024 * 1024)
+
+enum GraphicsVariantIndex {
+    GRAPHICS_VARIANT_DEFAULT,
+    GRAPHICS_VARIANT_WIREFRAME,
+    GRAPHICS_VARIANT_DEPTH_ONLY,
+    GRAPHICS_VARIANT_SHADOW,
+    GRAPHICS_VARIANT_TWO_SIDED,
+    GRAPHICS_VARIANT_COUNT
+};
+
+struct GraphicsVariant {
+    const char* name;
+    VkPolygonMode polygonMode;
+    VkCullModeFlags cullMode;
+    bool colorWrite;
+    //slope scaled depth bias, for rendering shadow maps
+    bool depthBias;
+};
 
 
 class VulkanBase {
     public:
         Camera* cam = new Camera(&VP.view, glm::vec3(0.f, -.7071f, -.7071f), glm::vec3(0.f, .7071f, -.7071f), glm::vec3(0.f, 1.f, 0.f));
 
-        VulkanBase(Window* pWindow, Scene* pScene, bool enableValidationLayers);
+        VulkanBase(Window* pWindow, Scene* pScene, bool enableValidationLayers, Settings settings = Settings());
         void createInstance();
         std::vector<VkLayerProperties>getAvailableLayers(bool print);
         std::vector<const char*>getRequiredLayers(bool print);
@@ -31,6 +70,7 @@ class VulkanBase {
         void createLogicalDevice();
 
         void createSwapchain();
+        void createOffscreenTargets();
         VkSurfaceFormatKHR getSurfaceFormat();
         uint32_t getMinImageCount(VkSurfaceCapabilitiesKHR surfaceCapabilities);
         VkExtent2D getSwapExtent(VkSurfaceCapabilitiesKHR surfaceCapabilities);
@@ -38,30 +78,105 @@ class VulkanBase {
 
         void createImageViews();
         void createCommandBuffers(); 
+        //prerecorded mode, one per framebuffer
+        void allocateCommandBuffers();
         void createDepthBuffer();
-        void getMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t memoryFlagBitMask, uint32_t &memoryTypeIndex);
+        //with --dynamic-resolution, the image the scene is drawn into before it is scaled up
+        void createSceneTarget();
         void createUniformBuffers();
+        //transient uniforms, a region per command buffer slot
+        void createUniformRing();
         void createDescriptorSet();
+        void writeUniformRingDescriptors();
         void createRenderPass();
         void createFramebuffers();
 
+        void createStagingRing();
         void createVertexBuffer();
         void createIndexBuffer();
-
+        void createInstanceBuffer();
+        void createCullingResources();
+        void createCullOutputBuffer();
+        void writeCullDescriptors();
+        //BVH over every instance of every model, for --cull-bvh and picking
+        void createSceneBvh();
+        void finishUploads();
+
+        void createPipelineCache();
         void createGraphicsPipeline();
+        //rebuild pipelines whose SPIR-V changes on disk, see --hot-reload
+        void startShaderHotReload();
 
+        //timestamp zones around the frame, its passes and with --gpu-profile-draws every draw
+        void createGpuProfiler();
         void createSyncObjects();
 
         void draw();
+        //the swapchain and everything sized by it are recreated before the next frame
+        void resize(uint32_t width, uint32_t height);
+        uint32_t getSwapchainRecreateCount();
 
 
         void updateMVP();        
+        //nearest instance under the pixel x, y of the drawable, not window coordinates on high DPI displays
+        bool pick(int x, int y, uint32_t &model, uint32_t &instance, float &distance);
+
+        void waitIdle();
+        double getLastGpuTimeMs();
+        double getAverageGpuTimeMs();
+        uint32_t getDrawCount();
+        double getRecordTimeMs();
+        double getCullTimeMs();
+        //triangles in the last recorded frame's direct draws
+        uint64_t getTriangleCount();
+        //times of the frame zone, zeroes without timestamps
+        GpuProfiler::ZoneStats getGpuFrameStats();
+        //waits for the GPU, then drops the GPU times collected so far
+        void clearGpuStats();
+        //fraction of the output width and height the last frame was rendered at, and its average
+        float getRenderScale();
+        float getAverageRenderScale();
+        MemoryStats getMemoryStats();
+        std::string getDeviceName();
 
 
         void cleanUp();
 
     private:
+        void writeVPSlice(uint32_t region);
+        uint32_t getUniformRegion(uint32_t imageIndex);
+        void createFrameCommands();
+        VkCommandBuffer recordFrame(uint32_t imageIndex);
+        void beginFrameCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkSubpassContents contents);
+        void endFrameCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+        void recordDrawState(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+        uint64_t recordDrawItems(VkCommandBuffer commandBuffer, uint32_t imageIndex, size_t first, size_t last);
+        void createDrawBounds();
+        void cullDraws();
+        bool isDeviceExtensionAvailable(const char* extensionName);
+        VkPipelineCache getPipelineCacheHandle();
+        VkShaderModule createShaderModule(const std::string &path);
+        VkPipeline buildGraphicsPipeline(const GraphicsVariant &variant);
+        bool isGraphicsVariantSupported(uint32_t variant);
+        void collectPipelines();
+        VkPipeline buildCullPipeline();
+        void reloadShaders(const std::vector<std::string> &changed);
+        void swapPendingPipelines();
+        void recordCommandBuffers();
+        void recordCulling(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+        void recordIndirectDraws(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+        void updateRenderExtent();
+        void recordUpscale(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+        void reserveGpuZones(uint32_t imageIndex);
+        bool recreateSwapchain();
+        void destroySwapchainResources();
+        //ring regions, cull output, timestamp slots and command buffers laid out per swapchain image
+        void resizePerImageState();
+        void updateProjection();
+        void createGeometryBuffer(VkBufferUsageFlags usage, const void* data, VkDeviceSize size, VkBuffer &buffer, Allocation &allocation);
+
         bool enableValidationLayers;
+        Settings settings;
 
         Scene* pScene;
 
@@ -71,6 +186,8 @@ class VulkanBase {
         struct uboVP{
             glm::mat4 view;
             glm::mat4 projection;
+            //per model colors for the compressed vertex layouts
+            glm::vec4 materials[MAX_MATERIALS];
         };
 
         uboVP VP = {};
@@ -80,34 +197,65 @@ class VulkanBase {
         std::vector<const char*> requiredDeviceExtensions = {"VK_KHR_swapchain"};
         uint32_t graphicsQueueIndex;
         uint32_t presentQueueIndex;
+        uint32_t transferQueueIndex;
         std::set<uint32_t> uniqueQueues;
 
-        std::vector<Vertex> vertices;
-        std::vector<uint32_t> indices;
  
         Window* pWindow;
         VkInstance instance;
         VkPhysicalDevice physicalDevice;
+        std::string deviceName;
         VkDevice device;
         VkSurfaceKHR surface;
         VkQueue graphicsQueue;
         VkQueue presentQueue;
-        VkSwapchainKHR swapchain;
+        VkQueue transferQueue;
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
         VkSurfaceFormatKHR surfaceFormat;
-
+        //size of the swapchain images, the depth buffer and the framebuffers. The requested size
+        //is the window's drawable size, or the offscreen size when headless; a surface with a
+        //fixed current extent overrides it.
+        VkExtent2D extent = {SCREEN_WIDTH, SCREEN_HEIGHT};
+        VkExtent2D requestedExtent = {SCREEN_WIDTH, SCREEN_HEIGHT};
+        //set by resize() or an out of date or suboptimal swapchain, handled at the start of draw()
+        bool resizePending = false;
+        uint32_t swapchainRecreations = 0;
+
+        //area the scene is drawn to. With --dynamic-resolution it is picked every frame from the GPU
+        //time, the scene goes into the top left of sceneImage, which has the output size, and is
+        //blitted up into the swapchain image. Otherwise it is the extent.
+        VkExtent2D renderExtent = {SCREEN_WIDTH, SCREEN_HEIGHT};
+        ResolutionScaler* resolutionScaler = nullptr;
+        VkImage sceneImage = VK_NULL_HANDLE;
+        Allocation sceneAllocation;
+        VkImageView sceneImageView = VK_NULL_HANDLE;
+        VkFilter upscaleFilter = VK_FILTER_LINEAR;
+        //frame zone samples already fed to the scaler
+        uint64_t scaledGpuSamples = 0;
+
+        //every buffer and image is sub-allocated from the allocator's blocks
+        VulkanMemoryBackend* memoryBackend = nullptr;
+        MemoryAllocator* allocator = nullptr;
+
+        //in headless mode these are offscreen images owned by the engine
         std::vector<VkImage> swapchainImages;
+        std::vector<Allocation> offscreenAllocations;
         std::vector<VkImageView> swapchainImageViews;
         VkCommandPool commandPool;
         std::vector<VkCommandBuffer> commandBuffers;
 
         VkImage depthImage;
         VkFormat depthFormat;
-        VkDeviceMemory depthMemory;
+        Allocation depthAllocation;
         VkImageView depthImageView;
 
         std::vector<VkBuffer> ubo;
-        std::vector<VkDeviceMemory> uboMemory;
+        std::vector<Allocation> uboAllocations;
         std::vector<void*> pUboData;
+        UniformRing* uniformRing = nullptr;
+        //where each ring region's VP lives, prerecorded command buffers keep reading it there
+        std::vector<uint32_t> vpOffsets;
+        std::vector<bool> vpSliceDirty;
 
         std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
         VkDescriptorPool descriptorPool;
@@ -116,21 +264,145 @@ class VulkanBase {
 
         VkRenderPass renderPass;
 
-        VkShaderModule vertShaderModule;
-        VkShaderModule fragShaderModule;
-
         std::vector<VkFramebuffer> framebuffers;
 
+        StagingRing* stagingRing = nullptr;
+        std::chrono::steady_clock::time_point uploadStart;
+
         VkBuffer vertBuffer;
-        VkDeviceMemory vertBufferMemory;
+        Allocation vertBufferAllocation;
+        //the vertex buffer's layout, picked by --vertex-layout
+        template<typename Layout>
+        void uploadVertices();
+        std::array<VkVertexInputAttributeDescription, 3> vertexAttributes;
+        uint32_t vertexStride = sizeof(Vertex);
+        //snorm16 positions are fractions of this, the largest coordinate in the scene
+        float positionScale = 1.f;
         VkBuffer indexBuffer;
-        VkDeviceMemory indexBufferMemory;
+        Allocation indexBufferAllocation;
+        //per instance model matrices, read through an instance rate vertex binding
+        VkBuffer instanceBuffer;
+        Allocation instanceBufferAllocation;
 
+        //the variant drawn with, one of graphicsPipelines
         VkPipeline pipeline;
-
-        VkSemaphore imageAvailableSemaphore;
-        VkSemaphore renderFinishedSemaphore;
-        
+        uint32_t drawVariant = GRAPHICS_VARIANT_DEFAULT;
+        //null until collected from the builder, or when the device does not support the variant
+        std::vector<VkPipeline> graphicsPipelines;
+        std::vector<uint32_t> graphicsPipelineIds;
+        PipelineBuilder* pipelineBuilder = nullptr;
+        bool fillModeNonSolidSupported = false;
+
+        //shared by every pipeline, null when --no-pipeline-cache is given
+        PipelineCache* pipelineCache = nullptr;
+        double pipelineCreateMs = 0.0;
+
+        //pipelines rebuilt by the watcher thread, swapped in by draw() between frames
+        ShaderWatcher* shaderWatcher = nullptr;
+        std::mutex pendingPipelineMutex;
+        std::vector<VkPipeline> pendingPipelines;
+        VkPipeline pendingCullPipeline = VK_NULL_HANDLE;
+        std::atomic<bool> pipelinesPending{false};
+
+        std::vector<VkSemaphore> imageAvailableSemaphores;
+        std::vector<VkSemaphore> renderFinishedSemaphores;
+        std::vector<VkFence> inFlightFences;
+        std::vector<VkFence> imagesInFlight;
+        uint32_t currentFrame = 0;
+
+        //null when the graphics queue has no timestamps. Zones are reserved when a command
+        //buffer starts recording, the draw zones are consecutive and follow visibleItems.
+        GpuProfiler* gpuProfiler = nullptr;
+        uint32_t timestampValidBits = 0;
+        struct GpuZones {
+            uint32_t frame = GpuProfiler::NO_ZONE;
+            uint32_t cull = GpuProfiler::NO_ZONE;
+            uint32_t renderPass = GpuProfiler::NO_ZONE;
+            uint32_t indirectDraws = GpuProfiler::NO_ZONE;
+            uint32_t firstDraw = GpuProfiler::NO_ZONE;
+            uint32_t upscale = GpuProfiler::NO_ZONE;
+        };
+        GpuZones gpuZones;
+
+        //GPU driven mode. Every instance of every model is an object; the cull pass writes
+        //one region per swapchain image: visible world matrices, draw commands and a count.
+        bool drawIndirectCountSupported = false;
+        bool multiDrawIndirectSupported = false;
+        PFN_vkCmdDrawIndexedIndirectCountKHR pfnCmdDrawIndexedIndirectCount = nullptr;
+        uint32_t objectCount = 0;
+        VkBuffer objectBuffer = VK_NULL_HANDLE;
+        Allocation objectBufferAllocation;
+        VkBuffer lodBuffer = VK_NULL_HANDLE;
+        Allocation lodBufferAllocation;
+        VkBuffer cullOutputBuffer = VK_NULL_HANDLE;
+        Allocation cullOutputAllocation;
+        VkDeviceSize cullRegionSize;
+        VkDeviceSize cullDrawsOffset;
+        VkDeviceSize cullCountOffset;
+        VkDescriptorSetLayout cullSetLayout;
+        VkDescriptorPool cullDescriptorPool;
+        VkDescriptorSet cullDescriptorSet;
+        VkPipelineLayout cullPipelineLayout;
+        VkPipeline cullPipeline;
+
+        struct DrawItem {
+            uint32_t model;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+            //world space sphere around all instances, and their largest scale for the LOD error
+            glm::vec4 sphere;
+            float errorScale;
+        };
+        std::vector<DrawItem> drawItems;
+        DrawItem makeDrawItem(uint32_t model, uint32_t firstInstance, uint32_t instanceCount);
+
+        //levels of detail are picked per draw from the projected error, see --lod-error
+        void updateLodParameters();
+        uint32_t selectLod(const DrawItem &item);
+        glm::vec3 lodCameraPos;
+        float lodScale = 0.f;
+        //the level of every draw item in the prerecorded command buffers, and the camera they were picked for
+        bool recordedLodsChanged();
+        std::vector<uint32_t> recordedLods;
+        glm::vec3 recordedLodCameraPos;
+        float recordedLodScale = 0.f;
+        uint64_t triangleCount = 0;
+
+        //the draw items recorded this frame, all of them unless --cpu-cull leaves some out.
+        //With --cpu-cull every draw item has a world space bounding sphere, an instanced draw
+        //one around all of its instances, tested against the frustum before recording.
+        std::vector<uint32_t> visibleItems;
+        size_t visibleCount = 0;
+        SphereSoA drawBounds;
+        //with --cull-bvh an instance is an object of the scene BVH, visible draws are the ones
+        //owning a visible object, stamped so a draw with several visible instances goes in once
+        Bvh sceneBvh;
+        std::vector<uint32_t> instanceModels;
+        std::vector<uint32_t> instanceDrawItems;
+        std::vector<uint32_t> visibleObjects;
+        std::vector<uint64_t> drawItemStamps;
+        CullPath cullPath = CULL_PATH_SCALAR;
+        double cullTimeMs = 0.0;
+        double cullTimeTotalMs = 0.0;
+        uint64_t cullSamples = 0;
+
+        //with rerecord every frame slot has a primary command buffer and one secondary per
+        //slice of the draw list, each from its own pool, reset once the slot's fence signals
+        struct FrameCommands {
+            VkCommandPool primaryPool;
+            VkCommandBuffer primary;
+            std::vector<VkCommandPool> slicePools;
+            std::vector<VkCommandBuffer> secondaries;
+        };
+        std::vector<FrameCommands> frameCommands;
+        ThreadPool* recordThreads = nullptr;
+        uint32_t sliceCount = 0;
+
+        //draws recorded into each command buffer and the (average) time it took to record one
+        uint32_t drawCount = 0;
+        double recordTimeMs = 0.0;
+        double recordTimeTotalMs = 0.0;
+        uint64_t recordSamples = 0;
 
 
 };
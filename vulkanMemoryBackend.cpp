@@ -0,0 +1,26 @@
+#include "vulkanMemoryBackend.hpp"
+
+
+VulkanMemoryBackend::VulkanMemoryBackend(VkDevice device) : device(device) {}
+
+VkResult VulkanMemoryBackend::allocate(uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceMemory* pMemory) {
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    return vkAllocateMemory(device, &allocInfo, nullptr, pMemory);
+}
+
+void VulkanMemoryBackend::free(VkDeviceMemory memory) {
+    vkFreeMemory(device, memory, nullptr);
+}
+
+VkResult VulkanMemoryBackend::map(VkDeviceMemory memory, void** ppData) {
+    return vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, ppData);
+}
+
+void VulkanMemoryBackend::unmap(VkDeviceMemory memory) {
+    vkUnmapMemory(device, memory);
+}
@@ -0,0 +1,22 @@
+#ifndef VULKANMEMORYBACKEND_HPP
+#define VULKANMEMORYBACKEND_HPP
+
+#include "memoryAllocator.hpp"
+
+
+//the allocator's device memory calls on a real device. Kept apart from the allocator so
+//the allocator builds and runs without libvulkan.
+class VulkanMemoryBackend : public DeviceMemoryBackend {
+    public:
+        VulkanMemoryBackend(VkDevice device);
+        VkResult allocate(uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceMemory* pMemory) override;
+        void free(VkDeviceMemory memory) override;
+        VkResult map(VkDeviceMemory memory, void** ppData) override;
+        void unmap(VkDeviceMemory memory) override;
+
+    private:
+        VkDevice device;
+};
+
+
+#endif
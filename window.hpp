@@ -7,6 +7,7 @@
 
 
 
+//size the window opens with, the swapchain follows it when it is resized
 #define SCREEN_WIDTH 1280
 #define SCREEN_HEIGHT 720
 